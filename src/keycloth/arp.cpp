@@ -0,0 +1,279 @@
+/* arp.cpp - Implementation of the clock-synchronized arpeggiator
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "arp.h"
+#include "keys.h"
+#include "midi.h"
+#include "layout.h"
+#include <Arduino.h>
+
+/**
+ * @brief Key indices sorted by pitch (position j in the arpeggio plays key order[j]).
+ */
+static uint8_t order[NUM_KEYS];
+
+static uint16_t heldKeys = 0;  // Touched keys (bit i = key i)
+static uint16_t latched = 0;   // Keys in the arpeggio (bit i = key i)
+static uint16_t ordered = 0;   // Keys in the arpeggio (bit j = position j)
+static uint8_t velocities[NUM_KEYS];
+
+static int8_t pos = -1;        // Current position in the arpeggio
+static int8_t dir = 1;         // Direction for ARP_UPDOWN
+static int sounding = -1;      // Pitch currently sounding, -1 if none
+static uint8_t pulseCount = 0; // Clock pulse within the current step
+
+static bool external = false;  // Locked to incoming MIDI clock
+static bool running = true;    // False after MIDI stop
+static unsigned long lastClockMs = 0;
+static unsigned long nextPulseUs = 0;
+static unsigned long pulseUs = 0;
+static float pulseBpm = 0;
+
+/**
+ * @brief Next set bit above position from, -1 if there is none.
+ */
+static int8_t above(uint16_t mask, int8_t from) {
+  for (int8_t i = from + 1; i < NUM_KEYS; i++) {
+    if (mask & _BV(i)) return i;
+  }
+  return -1;
+}
+
+/**
+ * @brief Next set bit below position from, -1 if there is none.
+ */
+static int8_t below(uint16_t mask, int8_t from) {
+  for (int8_t i = from - 1; i >= 0; i--) {
+    if (mask & _BV(i)) return i;
+  }
+  return -1;
+}
+
+/**
+ * @brief Choose the next arpeggio position according to arpMode.
+ */
+static int8_t nextPosition() {
+  int8_t n;
+  switch (arpMode) {
+    case ARP_DOWN:
+      n = below(ordered, pos);
+      return n >= 0 ? n : below(ordered, NUM_KEYS);
+    case ARP_UPDOWN:
+      n = dir > 0 ? above(ordered, pos) : below(ordered, pos);
+      if (n < 0) {
+        // Turn around at either end
+        dir = -dir;
+        n = dir > 0 ? above(ordered, pos) : below(ordered, pos);
+      }
+      if (n < 0) n = above(ordered, -1); // Single note
+      return n;
+    default:
+      n = above(ordered, pos);
+      return n >= 0 ? n : above(ordered, -1);
+  }
+}
+
+/**
+ * @brief End the sounding note, if any.
+ */
+static void release() {
+  if (sounding >= 0) {
+    noteOff(sounding);
+    sounding = -1;
+  }
+}
+
+/**
+ * @brief Advance to the next note of the arpeggio.
+ */
+static void step() {
+  release();
+  int8_t n = nextPosition();
+  if (n < 0) return;
+  pos = n;
+  uint8_t key = order[n];
+  sounding = noteTable[key];
+  noteOn(sounding, velocities[key]);
+}
+
+/**
+ * @brief Handle one clock pulse (internal or external).
+ */
+static void pulse() {
+  if (!running || arpMode == ARP_OFF) return;
+  uint8_t rate = arpRate < 1 ? 1 : arpRate;
+  if (pulseCount == 0) step();
+  else if (pulseCount == rate / 2) release(); // 50% gate
+  if (++pulseCount >= rate) pulseCount = 0;
+}
+
+/**
+ * @brief Sort keys by pitch (insertion sort, runs on layout changes).
+ */
+static void sortKeys() {
+  for (uint8_t i = 0; i < NUM_KEYS; i++) {
+    uint8_t j = i;
+    while (j > 0 && noteTable[order[j - 1]] > noteTable[i]) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+}
+
+/**
+ * @brief Positions of the latched keys in the pitch order.
+ */
+static void orderLatched() {
+  ordered = 0;
+  for (uint8_t j = 0; j < NUM_KEYS; j++) {
+    if (latched & _BV(order[j])) ordered |= _BV(j);
+  }
+}
+
+/**
+ * @brief Setup the arpeggiator.
+ */
+void setupArp() {
+  sortKeys();
+  nextPulseUs = micros();
+}
+
+/**
+ * @brief The key notes changed.
+ */
+void arpLayoutChanged() {
+  release();
+  sortKeys();
+  orderLatched();
+  pos = -1;
+  dir = 1;
+}
+
+/**
+ * @brief arpMode changed.
+ */
+void arpModeChanged() {
+  release();
+  if (arpMode == ARP_OFF) {
+    heldKeys = 0;
+    latched = 0;
+    ordered = 0;
+  }
+  pos = -1;
+  dir = 1;
+  pulseCount = 0;
+}
+
+/**
+ * @brief Update the set of keys the arpeggiator plays.
+ */
+void arpKeys(uint16_t held, const int velocity[]) {
+  if (arpMode == ARP_OFF) return;
+
+  uint16_t pressed = held & ~heldKeys;
+  for (uint8_t i = 0; i < NUM_KEYS; i++) {
+    if (pressed & _BV(i)) velocities[i] = velocity[i];
+  }
+
+  uint16_t next = held;
+  if (arpLatch) {
+    // A new chord replaces the latched one, added keys join it
+    if (!held) next = latched;
+    else if (heldKeys) next = latched | held;
+  }
+  if (held && !heldKeys) running = true;
+  heldKeys = held;
+
+  if (next == latched) return;
+  latched = next;
+  orderLatched();
+  if (!ordered) {
+    release();
+    pos = -1;
+    dir = 1;
+    pulseCount = 0;
+  }
+}
+
+/**
+ * @brief Run the internal clock and emit due notes.
+ */
+void arpService() {
+  if (arpMode == ARP_OFF) return;
+  unsigned long now = micros();
+  if (external) {
+    if (millis() - lastClockMs <= CLOCK_TIMEOUT_MS) return;
+    // Clock source disappeared, continue on the internal clock
+    external = false;
+    nextPulseUs = now;
+  }
+  if (arpBpm != pulseBpm) {
+    pulseBpm = arpBpm;
+    pulseUs = (unsigned long)(60000000.0 / (pulseBpm * CLOCK_PPQN));
+  }
+  if ((long)(now - nextPulseUs) < 0) return;
+
+  pulse();
+  flushMidi();
+  // Deadlines advance by whole pulses so the tempo does not drift
+  nextPulseUs += pulseUs;
+  // Resync instead of bursting if the loop was blocked for more than a pulse
+  if ((long)(now - nextPulseUs) >= 0) nextPulseUs = now + pulseUs;
+}
+
+/**
+ * @brief Incoming MIDI clock pulse (0xF8).
+ */
+void arpClock() {
+  lastClockMs = millis();
+  external = true;
+  pulse();
+}
+
+/**
+ * @brief Incoming MIDI start (0xFA) or continue (0xFB).
+ */
+void arpStart(bool restart) {
+  lastClockMs = millis();
+  external = true;
+  running = true;
+  if (restart) {
+    release();
+    pulseCount = 0;
+    pos = -1;
+    dir = 1;
+  }
+}
+
+/**
+ * @brief Whether the arpeggiator has notes to play.
+ */
+bool arpPlaying() {
+  return arpMode != ARP_OFF && (latched || sounding >= 0);
+}
+
+/**
+ * @brief Incoming MIDI stop (0xFC).
+ */
+void arpStop() {
+  running = false;
+  release();
+}
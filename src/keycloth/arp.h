@@ -0,0 +1,138 @@
+#ifndef ARP_H
+#define ARP_H
+
+/* arp.h - Clock-synchronized arpeggiator
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+
+/**
+ * @def ARP_OFF
+ * @brief Arpeggiator disabled, keys play their notes directly.
+ */
+#define ARP_OFF 0
+/**
+ * @def ARP_UP
+ * @brief Step through the held notes from lowest to highest pitch.
+ */
+#define ARP_UP 1
+/**
+ * @def ARP_DOWN
+ * @brief Step through the held notes from highest to lowest pitch.
+ */
+#define ARP_DOWN 2
+/**
+ * @def ARP_UPDOWN
+ * @brief Step up, then down again (end notes are not repeated).
+ */
+#define ARP_UPDOWN 3
+
+/**
+ * @def CLOCK_PPQN
+ * @brief MIDI clock resolution (pulses per quarter note).
+ */
+#define CLOCK_PPQN 24
+
+/**
+ * @def CLOCK_TIMEOUT_MS
+ * @brief Time without incoming MIDI clock before falling back to the internal clock.
+ */
+#define CLOCK_TIMEOUT_MS 500
+
+/**
+ * @brief Arpeggiator mode (ARP_OFF, ARP_UP, ARP_DOWN or ARP_UPDOWN).
+ */
+extern int arpMode;
+
+/**
+ * @brief Hold the last chord after all keys are released.
+ */
+extern bool arpLatch;
+
+/**
+ * @brief Clock pulses per arpeggio step (6 = 16th notes, 12 = 8th notes).
+ */
+extern int arpRate;
+
+/**
+ * @brief Internal clock tempo, used while no MIDI clock is received.
+ */
+extern float arpBpm;
+
+/**
+ * @brief Setup the arpeggiator.
+ */
+void setupArp();
+
+/**
+ * @brief The key notes changed (layout change).
+ *
+ * Releases the sounding note and orders the keys by their new pitch.
+ */
+void arpLayoutChanged();
+
+/**
+ * @brief arpMode changed.
+ *
+ * Releases the sounding note and starts the arpeggio over; turning the
+ * arpeggiator off also drops the held and latched keys, so it does not
+ * pick up a stale chord when it is turned on again.
+ */
+void arpModeChanged();
+
+/**
+ * @brief Update the set of keys the arpeggiator plays.
+ *
+ * @held: Bitmask of currently touched keys (bit i = key i).
+ * @velocity: Per key velocity of the current touch.
+ */
+void arpKeys(uint16_t held, const int velocity[]);
+
+/**
+ * @brief Run the internal clock and emit due notes.
+ *
+ * Non-blocking; call as often as possible from the loop, since the
+ * time between calls bounds the timing jitter.
+ */
+void arpService();
+
+/**
+ * @brief Whether the arpeggiator has notes to play.
+ */
+bool arpPlaying();
+
+/**
+ * @brief Incoming MIDI clock pulse (0xF8).
+ */
+void arpClock();
+
+/**
+ * @brief Incoming MIDI start (0xFA) or continue (0xFB).
+ *
+ * @restart: Start over from the first step (start) instead of resuming (continue).
+ */
+void arpStart(bool restart);
+
+/**
+ * @brief Incoming MIDI stop (0xFC).
+ */
+void arpStop();
+
+#endif
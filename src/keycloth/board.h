@@ -0,0 +1,101 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+/* board.h - Compile-time hardware description
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it 
+    under the terms of the GNU General Public License as published by the 
+    Free Software Foundation, either version 3 of the License, or (at your 
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT 
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+    more details.
+
+    You should have received a copy of the GNU General Public License along 
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>. 
+*/
+
+#include <Arduino.h>
+
+/**
+ * @def NO_PIN
+ * @brief Marks an optional pin as not connected.
+ */
+#define NO_PIN 0xFF
+
+/**
+ * @brief Compile-time list of board pins.
+ *
+ * PinList<A0, A1, A2>::at(1) folds to A1, so pin lookups cost no memory access.
+ */
+template <uint8_t... Pins>
+struct PinList;
+
+template <>
+struct PinList<> {
+    static constexpr uint8_t count = 0;
+    static constexpr uint8_t at(uint8_t) { return 0xFF; }
+};
+
+template <uint8_t First, uint8_t... Rest>
+struct PinList<First, Rest...> {
+    static constexpr uint8_t count = 1 + sizeof...(Rest);
+    static constexpr uint8_t at(uint8_t i) { return i == 0 ? First : PinList<Rest...>::at(i - 1); }
+};
+
+/**
+ * @brief Call f(0) .. f(N-1), fully unrolled at compile time.
+ */
+template <uint8_t N>
+struct Unroll {
+    template <typename F>
+    static inline __attribute__((always_inline)) void run(F f) {
+        Unroll<N - 1>::run(f);
+        f(N - 1);
+    }
+};
+
+template <>
+struct Unroll<0> {
+    template <typename F>
+    static inline __attribute__((always_inline)) void run(F) {}
+};
+
+/**
+ * @brief KeyCloth v1: Leonardo, 5V sensor supply, 1kΩ dividers.
+ *
+ * A board type describes everything that depends on the physical cloth.
+ * The sensor modules are specialized on it, so all of it folds into
+ * constants. To add a variant, copy this struct and select it below.
+ */
+struct ClothV1 {
+    typedef PinList<A0, A1, A2> BendPins; /**< Bend sensor pins (RIGHT, LEFT, MIDDLE) */
+    static constexpr uint8_t stretchPin = A3; /**< Stretch sensor pin */
+    static constexpr float sensorVin = 5.0; /**< Vin for DIY-ed sensors */
+    static constexpr float R0 = 1000.0; /**< Reference resistor of the voltage dividers */
+    static constexpr uint8_t numKeys = 12; /**< Keys wired to the MPR121 */
+    static constexpr uint8_t keypadAddr = 0x5A; /**< MPR121 I2C address */
+    static constexpr uint8_t keypadIrqPin = NO_PIN; /**< MPR121 IRQ, an external interrupt pin (e.g. 7) or NO_PIN */
+    static constexpr uint8_t midiChannel = 0; /**< Default MIDI output channel */
+};
+
+/**
+ * @brief KeyCloth v1 powered from the 3.3V pin with 10kΩ dividers.
+ */
+struct ClothV1Low : ClothV1 {
+    static constexpr float sensorVin = 3.3;
+    static constexpr float R0 = 10000.0;
+};
+
+/**
+ * @brief The cloth variant the firmware is built for.
+ */
+typedef ClothV1 Board;
+
+#endif
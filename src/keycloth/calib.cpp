@@ -0,0 +1,111 @@
+/* calib.cpp - Implementation of persisted sensor calibration
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "calib.h"
+#include "utils.h"
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <stddef.h>
+
+/**
+ * @brief Copy of the record currently stored in EEPROM.
+ */
+static CalibRecord stored;
+
+static unsigned long lastSaveMs = 0;
+
+/**
+ * @brief CRC of a record, excluding its crc field.
+ */
+static uint16_t recordCrc(const CalibRecord &rec) {
+  return crc16((const uint8_t *)&rec, offsetof(CalibRecord, crc));
+}
+
+/**
+ * @brief Fill a record from the current runtime calibration.
+ */
+static void fillRecord(CalibRecord &rec) {
+  rec.version = CALIB_VERSION;
+  rec.count = NUM_CALIB;
+  for (int i = 0; i < NUM_CALIB; i++) {
+    rec.minR[i] = sensors.minR[i] >> 16;
+    rec.maxR[i] = sensors.maxR[i] >> 16;
+    rec.baseline[i] = sensors.baseline[i] >> 16;
+  }
+  rec.crc = recordCrc(rec);
+}
+
+/**
+ * @brief Whether any value differs from the stored one by more than CALIB_TOLERANCE.
+ */
+static bool drifted(const CalibRecord &rec) {
+  for (int i = 0; i < NUM_CALIB; i++) {
+    if (abs((long)rec.minR[i] - stored.minR[i]) > CALIB_TOLERANCE) return true;
+    if (abs((long)rec.maxR[i] - stored.maxR[i]) > CALIB_TOLERANCE) return true;
+    if (abs((long)rec.baseline[i] - stored.baseline[i]) > CALIB_TOLERANCE) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Load the calibration record from EEPROM.
+ */
+bool loadCalibration() {
+  EEPROM.get(CALIB_EEPROM_ADDR, stored);  // Single block read
+  lastSaveMs = millis();
+
+  if (stored.version != CALIB_VERSION || stored.count != NUM_CALIB
+      || stored.crc != recordCrc(stored)) {
+    // Missing or stale record, keep defaults and save once calibrated
+    fillRecord(stored);
+    stored.version = 0;
+    return false;
+  }
+
+  for (int i = 0; i < NUM_CALIB; i++) {
+    sensors.minR[i] = sensorQ(stored.minR[i]);
+    sensors.maxR[i] = sensorQ(stored.maxR[i]);
+    sensors.baseline[i] = sensorQ(stored.baseline[i]);
+  }
+  return true;
+}
+
+/**
+ * @brief Save the calibration record if it drifted from the stored one.
+ */
+void serviceCalibration() {
+  if (millis() - lastSaveMs < CALIB_SAVE_INTERVAL_MS) return;
+  lastSaveMs = millis();
+
+  CalibRecord rec;
+  fillRecord(rec);
+  if (stored.version == CALIB_VERSION && !drifted(rec)) return;
+
+  EEPROM.put(CALIB_EEPROM_ADDR, rec);  // Only rewrites changed bytes
+  stored = rec;
+}
+
+/**
+ * @brief Invalidate the stored calibration record.
+ */
+void wipeCalibration() {
+  EEPROM.put(CALIB_EEPROM_ADDR, (uint8_t)0xFF);  // Unknown version
+  stored.version = 0;
+}
@@ -0,0 +1,95 @@
+#ifndef CALIB_H
+#define CALIB_H
+
+/* calib.h - Persisted sensor calibration
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include "keys.h"
+#include "sensors.h"
+
+/**
+ * @def CALIB_EEPROM_ADDR
+ * @brief EEPROM address of the calibration record (right after the minCap block).
+ */
+#define CALIB_EEPROM_ADDR (NUM_KEYS * sizeof(uint16_t))
+
+/**
+ * @def CALIB_VERSION
+ * @brief Layout version of the calibration record, bump when CalibRecord changes.
+ */
+#define CALIB_VERSION 1
+
+/**
+ * @def NUM_CALIB
+ * @brief Number of calibrated sensor channels (bend sensors + stretch sensor).
+ */
+#define NUM_CALIB NUM_SENSORS
+
+/**
+ * @def CALIB_SAVE_INTERVAL_MS
+ * @brief Minimum time between two EEPROM writes of the calibration record.
+ */
+#define CALIB_SAVE_INTERVAL_MS 300000UL
+
+/**
+ * @def CALIB_TOLERANCE
+ * @brief Drift (Ω) of any calibration value that makes the record worth saving.
+ */
+#define CALIB_TOLERANCE 5
+
+/**
+ * @brief Calibration record as stored in EEPROM.
+ *
+ * Indexed like the sensor channels.
+ */
+struct CalibRecord {
+    uint8_t version; /**< CALIB_VERSION */
+    uint8_t count; /**< NUM_CALIB */
+    uint16_t minR[NUM_CALIB]; /**< Minimum read resistance */
+    uint16_t maxR[NUM_CALIB]; /**< Maximum read resistance */
+    uint16_t baseline[NUM_CALIB]; /**< Rest state resistance */
+    uint16_t crc; /**< CRC-16/CCITT over all fields above */
+};
+
+/**
+ * @brief Load the calibration record from EEPROM.
+ *
+ * Reads the record in one block. If it is missing, from another layout
+ * version or fails its CRC, the defaults set up by setupSensors() are kept.
+ *
+ * @return True if a valid record was applied.
+ */
+bool loadCalibration();
+
+/**
+ * @brief Save the calibration record if it drifted from the stored one.
+ *
+ * Non-blocking check, call from the loop. Writes are deferred and coalesced
+ * to at most one every CALIB_SAVE_INTERVAL_MS.
+ */
+void serviceCalibration();
+
+/**
+ * @brief Invalidate the stored calibration record.
+ */
+void wipeCalibration();
+
+#endif
@@ -0,0 +1,222 @@
+/* capture.cpp - Implementation of the raw data capture
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "capture.h"
+#include "keys.h"
+#include "midi.h"
+#include "sysex.h"
+#include <Adafruit_MPR121.h>
+
+/**
+ * @def CAPTURE_CODE_BYTES
+ * @brief Code bytes of a group of @n values, three codes per byte.
+ */
+#define CAPTURE_CODE_BYTES(n) (((n) + 2) / 3)
+
+/**
+ * @def CAPTURE_RECORD_MAX
+ * @brief Longest record: a delta record with a 32-bit interval change and
+ * every value as a 2-byte delta (values and deltas fit 12 bits). Each group
+ * starts its codes on a byte of its own.
+ */
+#define CAPTURE_RECORD_MAX (7 + 2 * CAPTURE_CODE_BYTES(CAPTURE_ELECTRODES) + \
+                            CAPTURE_CODE_BYTES(NUM_SAMPLED) + 2 * CAPTURE_VALUES)
+
+/**
+ * @def CAPTURE_MESSAGE_MAX
+ * @brief Message buffer: header and seq, a batch, one more record, F7.
+ */
+#define CAPTURE_MESSAGE_MAX (5 + CAPTURE_BATCH_BYTES + CAPTURE_RECORD_MAX + 1)
+
+static_assert(CAPTURE_MESSAGE_MAX < 256, "Message length is a byte");
+
+/**
+ * @def CAPTURE_GROUPS
+ * @brief Value groups of a delta record (CAPTURE_GROUP_* bits).
+ */
+#define CAPTURE_GROUPS 3
+
+/**
+ * @brief First value of each delta record group, and the end.
+ */
+static constexpr uint8_t groupStart[CAPTURE_GROUPS + 1] = { 0, CAPTURE_ELECTRODES, 2 * CAPTURE_ELECTRODES, CAPTURE_VALUES };
+
+/**
+ * @brief Code bytes of the groups from @g on, as putGroup() writes them.
+ */
+static constexpr uint8_t codeBytes(uint8_t g) {
+  return g == CAPTURE_GROUPS ? 0
+       : CAPTURE_CODE_BYTES(groupStart[g + 1] - groupStart[g]) + codeBytes(g + 1);
+}
+
+static_assert(CAPTURE_RECORD_MAX == 7 + codeBytes(0) + 2 * CAPTURE_VALUES,
+              "CAPTURE_RECORD_MAX must follow the delta record groups");
+
+static bool enabled = false;
+static uint8_t seq = 0;
+static uint8_t untilKey = 0;  // Delta records before the next key record
+static uint32_t lastUs = 0;
+static uint32_t lastDt = 0;
+static uint16_t last[CAPTURE_VALUES];
+static uint8_t msg[CAPTURE_MESSAGE_MAX];
+static uint8_t msgLen = 0;  // 0: no record waiting
+
+/**
+ * @brief Append an unsigned value in 6-bit groups, least significant
+ * first, bit 6 set on all but the last byte.
+ */
+static uint8_t *putVarint(uint8_t *p, uint32_t v) {
+  while (v >= 0x40) {
+    *p++ = 0x40 | (v & 0x3F);
+    v >>= 6;
+  }
+  *p++ = v;
+  return p;
+}
+
+/**
+ * @brief Zigzag encoding, small magnitudes stay small (0, -1, 1 as 0, 1, 2).
+ */
+static uint32_t zigzag(int32_t d) {
+  return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+
+/**
+ * @brief Append the codes and deltas of @n values of a group.
+ */
+static uint8_t *putGroup(uint8_t *p, const uint16_t *v, const uint16_t *old, uint8_t n) {
+  uint8_t *codes = p;
+  uint8_t *deltas = p + CAPTURE_CODE_BYTES(n);
+  for (uint8_t i = 0; i < n; i += 3) {
+    uint8_t c = 0;
+    for (uint8_t j = 0; j < 3 && i + j < n; j++) {
+      int16_t d = v[i + j] - old[i + j];
+      uint8_t code = CAPTURE_CODE_VALUE;
+      if (!d) code = CAPTURE_CODE_SAME;
+      else if (d == 1) code = CAPTURE_CODE_UP;
+      else if (d == -1) code = CAPTURE_CODE_DOWN;
+      else deltas = putVarint(deltas, zigzag(d));
+      c |= code << (2 * j);
+    }
+    *codes++ = c;
+  }
+  return deltas;
+}
+
+/**
+ * @brief Whether any of @n values differs from @old.
+ */
+static bool changed(const uint16_t *v, const uint16_t *old, uint8_t n) {
+  for (uint8_t i = 0; i < n; i++)
+    if (v[i] != old[i]) return true;
+  return false;
+}
+
+/**
+ * @brief Send the waiting records.
+ */
+static void flush() {
+  msg[msgLen++] = 0xF7;
+  sendSysEx(msg, msgLen);
+  msgLen = 0;
+}
+
+/**
+ * @brief Current values of all captured channels.
+ */
+static void readValues(uint16_t *v) {
+  const uint8_t *regs = keypadRegisters();
+  for (uint8_t i = 0; i < CAPTURE_ELECTRODES; i++) {
+    v[i] = regs[MPR121_FILTDATA_0L + 2 * i] | (regs[MPR121_FILTDATA_0H + 2 * i] << 8);
+    v[CAPTURE_ELECTRODES + i] = regs[MPR121_BASELINE_0 + i];  // High 8 of 10 bits
+  }
+  for (uint8_t i = 0; i < NUM_SAMPLED; i++) v[2 * CAPTURE_ELECTRODES + i] = sampled[i];
+}
+
+/**
+ * @brief Start or stop streaming capture records.
+ *
+ * Records still waiting for their message are dropped.
+ */
+void setCapture(bool enable) {
+  enabled = enable;
+  untilKey = 0;
+  msgLen = 0;
+}
+
+/**
+ * @brief Whether capture records are streamed.
+ */
+bool capturing() {
+  return enabled;
+}
+
+/**
+ * @brief Record a full scan, if capturing.
+ *
+ * A scan with the usual count or two of noise costs a 2-bit code for each
+ * value of the groups that changed, and groups that did not (the
+ * baselines, mostly) cost nothing. Records are batched into messages of
+ * about CAPTURE_BATCH_BYTES to spread the SysEx header and the USB-MIDI
+ * packet padding over several scans.
+ */
+void serviceCapture(uint32_t nowUs) {
+  if (!enabled) return;
+  uint16_t v[CAPTURE_VALUES];
+  readValues(v);
+
+  if (!untilKey && msgLen) flush();  // Key records start a message for resyncing
+  if (!msgLen) {
+    msg[0] = 0xF0;
+    msg[1] = SYSEX_ID;
+    msg[2] = SYSEX_DEVICE;
+    msg[3] = SYSEX_FRAME;
+    msg[4] = seq;
+    seq = (seq + 1) & 0x7F;
+    msgLen = 5;
+  }
+  uint8_t *p = msg + msgLen;
+  uint32_t dt = nowUs - lastUs;
+  if (!untilKey) {
+    *p++ = CAPTURE_KEY;
+    for (uint8_t i = 0; i < 5; i++) *p++ = (nowUs >> (7 * i)) & 0x7F;
+    *p++ = CAPTURE_VALUES;
+    for (uint8_t i = 0; i < CAPTURE_VALUES; i++) p = putVarint(p, v[i]);
+    untilKey = CAPTURE_KEY_INTERVAL;
+    dt = 0;
+  } else {
+    uint8_t *groups = p++;
+    *groups = 0;
+    p = putVarint(p, zigzag(dt - lastDt));  // Steady scan rate: one byte
+    for (uint8_t g = 0; g < CAPTURE_GROUPS; g++) {
+      uint8_t n = groupStart[g + 1] - groupStart[g];
+      if (!changed(v + groupStart[g], last + groupStart[g], n)) continue;
+      *groups |= CAPTURE_GROUP_FILTERED << g;
+      p = putGroup(p, v + groupStart[g], last + groupStart[g], n);
+    }
+  }
+  untilKey--;
+  msgLen = p - msg;
+  if (msgLen >= 5 + CAPTURE_BATCH_BYTES) flush();
+
+  lastUs = nowUs;
+  lastDt = dt;
+  for (uint8_t i = 0; i < CAPTURE_VALUES; i++) last[i] = v[i];
+}
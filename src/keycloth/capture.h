@@ -0,0 +1,93 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+/* capture.h - Raw electrode and sensor data capture
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include "sampler.h"
+
+/**
+ * @def CAPTURE_ELECTRODES
+ * @brief Captured MPR121 electrodes (12 keys and the proximity channel).
+ */
+#define CAPTURE_ELECTRODES 13
+
+/**
+ * @def CAPTURE_VALUES
+ * @brief Values per frame: filtered data and baseline of every electrode,
+ * then the raw ADC code of every sampled input.
+ */
+#define CAPTURE_VALUES (2 * CAPTURE_ELECTRODES + NUM_SAMPLED)
+
+/**
+ * @def CAPTURE_KEY_INTERVAL
+ * @brief Scans between key records (a recorder resyncs after a lost message).
+ */
+#define CAPTURE_KEY_INTERVAL 64
+
+/**
+ * @def CAPTURE_BATCH_BYTES
+ * @brief A capture message is sent once its records fill this many bytes.
+ */
+#define CAPTURE_BATCH_BYTES 32
+
+/**
+ * Capture records, several per SYSEX_FRAME <seq> message:
+ *   key:   CAPTURE_KEY <time µs, 5 bytes> <count> <count values>
+ *   delta: <changed groups> <change of the scan interval (µs)>, then for
+ *          each changed group (filtered, baselines, ADC codes) a 2-bit
+ *          CAPTURE_CODE_* per value, three per byte, followed by the
+ *          deltas of its CAPTURE_CODE_VALUE values.
+ */
+#define CAPTURE_KEY 0x40            /**< Key record tag, delta records have the group bits */
+#define CAPTURE_GROUP_FILTERED 0x01 /**< Some filtered data changed (groups in value order) */
+#define CAPTURE_GROUP_BASELINE 0x02 /**< Some baseline changed */
+#define CAPTURE_GROUP_ADC 0x04      /**< Some ADC code changed */
+
+#define CAPTURE_CODE_SAME 0  /**< Value unchanged */
+#define CAPTURE_CODE_UP 1    /**< Value + 1 */
+#define CAPTURE_CODE_DOWN 2  /**< Value - 1 */
+#define CAPTURE_CODE_VALUE 3 /**< Delta follows */
+
+static_assert(CAPTURE_VALUES < 128, "Value count is sent as one 7-bit byte");
+
+/**
+ * @brief Start or stop streaming capture records.
+ *
+ * The first record after starting is a key record.
+ *
+ * @enable: True to capture.
+ */
+void setCapture(bool enable);
+
+/**
+ * @brief Whether capture records are streamed.
+ */
+bool capturing();
+
+/**
+ * @brief Record a full scan, if capturing.
+ *
+ * Call after keyHandler() with @nowUs the time of the scan.
+ */
+void serviceCapture(uint32_t nowUs);
+
+#endif
@@ -0,0 +1,97 @@
+/* gesture.cpp - Implementation of crumple/stretch gesture recognition
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "gesture.h"
+
+/**
+ * Sample classes (column of the transition table)
+ */
+#define IN 0   // Below enterR
+#define BAND 1 // Inside the hysteresis band
+#define OUT 2  // Above exitR
+#define ELAPSED 3 // Added when the state's timer has run out
+
+/**
+ * @brief Transition table: next state for [state][class (+ ELAPSED)].
+ */
+static const uint8_t transitions[NUM_GESTURE_STATES][6] = {
+  //                    IN                      BAND                    OUT                     IN+T                    BAND+T                  OUT+T
+  /* REST */           {GESTURE_ARMING,         GESTURE_REST,           GESTURE_REST,           GESTURE_ARMING,         GESTURE_REST,           GESTURE_REST},
+  /* ARMING */         {GESTURE_ARMING,         GESTURE_REST,           GESTURE_REST,           GESTURE_ACTIVE,         GESTURE_REST,           GESTURE_REST},
+  /* ACTIVE */         {GESTURE_ACTIVE,         GESTURE_ACTIVE,         GESTURE_RELEASING,      GESTURE_HELD,           GESTURE_HELD,           GESTURE_RELEASING},
+  /* HELD */           {GESTURE_HELD,           GESTURE_HELD,           GESTURE_RELEASING_HELD, GESTURE_HELD,           GESTURE_HELD,           GESTURE_RELEASING_HELD},
+  /* RELEASING */      {GESTURE_ACTIVE,         GESTURE_ACTIVE,         GESTURE_RELEASING,      GESTURE_ACTIVE,         GESTURE_ACTIVE,         GESTURE_REST},
+  /* RELEASING_HELD */ {GESTURE_HELD,           GESTURE_HELD,           GESTURE_RELEASING_HELD, GESTURE_HELD,           GESTURE_HELD,           GESTURE_REST},
+};
+
+/**
+ * @brief Map the resistance at engagement to a velocity (enterR = 1, fullR = 127).
+ */
+static uint8_t gestureVelocity(const GestureConfig &c, uint16_t r) {
+  if (r <= c.fullR) return 127;
+  if (r >= c.enterR) return 1;
+  return 1 + (uint8_t)((uint32_t)(c.enterR - r) * 126 / (c.enterR - c.fullR));
+}
+
+/**
+ * @brief Feed one sample into a gesture state machine.
+ */
+uint8_t stepGesture(GestureInfo &g, const GestureConfig &c, uint16_t r, uint16_t nowMs, bool blocked) {
+  uint8_t input = r < c.enterR ? IN : (r > c.exitR ? OUT : BAND);
+  if (input == IN && blocked && g.state == GESTURE_REST) return GESTURE_NONE;
+
+  switch (g.state) {
+    case GESTURE_ARMING:
+    case GESTURE_RELEASING:
+    case GESTURE_RELEASING_HELD:
+      if ((uint16_t)(nowMs - g.timerMs) >= c.dwellMs) input += ELAPSED;
+      break;
+    case GESTURE_ACTIVE:
+      if ((uint16_t)(nowMs - g.engagedMs) >= c.holdMs) input += ELAPSED;
+      break;
+  }
+
+  uint8_t next = transitions[g.state][input];
+  if (next == g.state) return GESTURE_NONE;
+
+  uint8_t prev = g.state;
+  g.state = next;
+  switch (next) {
+    case GESTURE_ARMING:
+    case GESTURE_RELEASING:
+    case GESTURE_RELEASING_HELD:
+      g.timerMs = nowMs;
+      break;
+    case GESTURE_ACTIVE:
+      if (prev == GESTURE_ARMING) {
+        g.engagedMs = nowMs;
+        g.velocity = gestureVelocity(c, r);
+        return GESTURE_ON;
+      }
+      break;
+    case GESTURE_HELD:
+      if (prev == GESTURE_ACTIVE) return GESTURE_HOLD;
+      break;
+    case GESTURE_REST:
+      if (prev == GESTURE_RELEASING || prev == GESTURE_RELEASING_HELD) return GESTURE_OFF;
+      break;
+  }
+  return GESTURE_NONE;
+}
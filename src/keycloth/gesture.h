@@ -0,0 +1,100 @@
+#ifndef GESTURE_H
+#define GESTURE_H
+
+/* gesture.h - Crumple/stretch gesture recognition
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+
+/**
+ * @def GESTURE_CRUMPLE
+ * @brief Gesture index of crumpling the middle bend sensor.
+ */
+#define GESTURE_CRUMPLE 0
+/**
+ * @def GESTURE_STRETCH
+ * @brief Gesture index of stretching the stretch sensor.
+ */
+#define GESTURE_STRETCH 1
+/**
+ * @def NUM_GESTURES
+ * @brief Number of recognized gestures.
+ */
+#define NUM_GESTURES 2
+
+/**
+ * Gesture states
+ */
+#define GESTURE_REST 0      /**< Sensor at rest */
+#define GESTURE_ARMING 1    /**< Past the enter threshold, waiting for the dwell time */
+#define GESTURE_ACTIVE 2    /**< Gesture recognized, note sounding */
+#define GESTURE_HELD 3      /**< Active for longer than the hold time */
+#define GESTURE_RELEASING 4 /**< Past the exit threshold, waiting for the dwell time */
+#define GESTURE_RELEASING_HELD 5 /**< Releasing from GESTURE_HELD, a bounce returns there */
+#define NUM_GESTURE_STATES 6
+
+/**
+ * Gesture events returned by stepGesture()
+ */
+#define GESTURE_NONE 0 /**< Nothing to emit */
+#define GESTURE_ON 1   /**< Gesture started: emit note on */
+#define GESTURE_OFF 2  /**< Gesture released: emit note off */
+#define GESTURE_HOLD 3 /**< Gesture held for holdMs */
+
+/**
+ * @brief Per-gesture parameters.
+ *
+ * Resistances drop when the sensor is crumpled/stretched, so a gesture
+ * engages below enterR and releases above exitR (exitR > enterR).
+ * The band in between is the hysteresis.
+ */
+struct GestureConfig {
+    uint16_t enterR; /**< Resistance below which the gesture engages */
+    uint16_t exitR; /**< Resistance above which the gesture releases */
+    uint16_t fullR; /**< Resistance mapped to full velocity */
+    uint16_t dwellMs; /**< Time a threshold must stay crossed */
+    uint16_t holdMs; /**< Active time after which the gesture counts as held */
+    uint8_t note; /**< Note triggered by the gesture */
+};
+
+/**
+ * @brief Per-gesture runtime state.
+ */
+struct GestureInfo {
+    uint8_t state; /**< One of the GESTURE_* states */
+    uint8_t velocity; /**< Velocity captured when the gesture engaged */
+    uint16_t timerMs; /**< Start of the current dwell */
+    uint16_t engagedMs; /**< Time the gesture engaged */
+};
+
+/**
+ * @brief Feed one sample into a gesture state machine.
+ *
+ * @g: Gesture state.
+ * @c: Gesture parameters.
+ * @r: Sensor resistance.
+ * @nowMs: Current time (wrapping 16-bit milliseconds).
+ * @blocked: Prevents the gesture from engaging (e.g. another gesture is active).
+ * @return GESTURE_ON/GESTURE_OFF exactly once per gesture, GESTURE_HOLD once
+ *         when it is held, otherwise GESTURE_NONE.
+ */
+uint8_t stepGesture(GestureInfo &g, const GestureConfig &c, uint16_t r, uint16_t nowMs, bool blocked);
+
+#endif
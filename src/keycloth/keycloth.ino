@@ -20,28 +20,43 @@
  */
 
 #include "keys.h"
-#include "pins.h"
-#include "bend.h"
-#include "stretch.h"
+#include "board.h"
+#include "sensors.h"
 #include "midi.h"
+#include "sampler.h"
+#include "arp.h"
+#include "calib.h"
+#include "utils.h"
+#include "power.h"
+#include "layout.h"
+#include "params.h"
+#include "capture.h"
 
 /**
  * SET FIXED VALUES
+ * (pins, sensor supply and divider values are set by the Board type in board.h)
  **/
-int* bendPins = new int[NUM_BEND] {A0, A1, A2}; // bend sensor pins
+int channel = Board::midiChannel; // Audio output channel
 
-int stretchPin = A3; // stretch sensor pin
+int layout = LAYOUT_CLOTH; // Key layout (LAYOUT_CLOTH, LAYOUT_WICKI_HAYDEN, LAYOUT_HARMONIC, LAYOUT_TONNETZ)
+uint16_t scale = SCALE_CHROMATIC; // Scale lock (SCALE_CHROMATIC = off)
+int scaleRoot = 0; // Root of the scale (0 = C)
+int transpose = 0; // Transposition in semitones
+int octaveShift = 0; // Octave shift
 
-float sensorVin = 5; // Vin for DIY-ed sensors
-float R0 = 1000; // Reference resistor of voltage divider (bend)
+int arpMode = ARP_OFF; // Arpeggiator mode (ARP_OFF, ARP_UP, ARP_DOWN, ARP_UPDOWN)
+bool arpLatch = false; // Keep arpeggiating the last chord after release
+int arpRate = 6; // MIDI clock pulses per arpeggio step (6 = 16th notes)
+float arpBpm = 120; // Internal tempo while no MIDI clock is received
 
-int channel = 0; // Audio output channel
+uint8_t stretchOutput = STRETCH_OUT_NONE; // Stretch expression output (STRETCH_OUT_NONE, STRETCH_OUT_CC, STRETCH_OUT_PITCHBEND, STRETCH_OUT_PRESSURE)
+uint8_t stretchSource = STRETCH_SRC_AMOUNT; // Stretch expression source (STRETCH_SRC_AMOUNT, STRETCH_SRC_RATE)
+uint8_t stretchCC = 11; // Controller of STRETCH_OUT_CC (11 = expression)
+uint16_t stretchRateFull = 2000; // Stretch rate (Ω/s) for full scale with STRETCH_SRC_RATE
 
-bool debug = true; // Flag to output to Serial
+bool debug = false; // Flag to output to Serial (slows the loop down, and the arpeggiator with it)
 
 KeyInfo k;
-BendInfo b;
-float sInfo[NUM_STRETCH_DATA];
 /** 
  * END 
  **/
@@ -49,23 +64,51 @@ float sInfo[NUM_STRETCH_DATA];
 void setup(){
   Serial.begin(9600);
   // wipeEEPROM(); // for debugging, TODO extra physical button to call at runtime
+  // Live parameters stored over SysEx (falls back to the values above)
+  loadParams();
   // Keys
   
   setupKeypad();
-  // Bend sensors
-  setupBend();
-  b = BendInfo();
-  // Stretch sensor
-  setupStretch();
+  // Background ADC sampling (no analogRead() past this point)
+  setupSampler();
+  // Bend and stretch sensors
+  setupSensors();
+  // Stored calibration (falls back to defaults)
+  loadCalibration();
+  // Key notes
+  applyLayout();
+  // Arpeggiator
+  setupArp();
+  // Idle governor
+  setupPower();
 }
 
 void loop(){
+  // Incoming MIDI (clock, transport)
+  pollMidiIn();
+  arpService();
+
+  // Sleeps while idle, until the next idle scan or a keypad IRQ
+  if (!scanDue()) return;
+
   // Read sensors
-  readBend(b);
-  readStretch(); // loads to global var
-  keyHandler(k);
+  drainSamples();
+  // While idle only the proximity status is read, full scans once a hand approaches
+  bool keyScan = !isIdle() || keypadNear();
+  if (keyScan) startKeyScan(); // keypad transfer overlaps the sensor math
+  readSensors(); // loads to global var
+  // The arpeggiator keeps time while the keypad transfer finishes, on its
+  // own clock or on the incoming MIDI clock
+  do {
+    pollMidiIn();
+    arpService();
+  } while (keyScan && keyScanPending());
+  if (keyScan) keyHandler(k);
+  if (keyScan && !k.errors) serviceCapture(micros()); // raw data frame, if capturing
 
-  handleSignals(k, b, sInfo);
+  handleSignals(k);
+  serviceIdle(k.touched || k.near || k.played || sensors.deflected || arpPlaying() || capturing());
+  serviceCalibration();
 
   // /**
   //  * MONITORING / DEBUGGING
@@ -79,13 +122,13 @@ void loop(){
   //   Serial.println(msg); 
   // }
 
-  // Bend
-  for (int i = 0; i < NUM_BEND; i++) {
-    msg = "raw("+ String(i) + ")=" + b.raw[i] + "\tVout("+ String(i) + ")=" + String(b.Vout[i], 2) + "\tR("+ String(i) + ")=" + String(b.R[i], 2);
+  // Bend and stretch (channel S)
+  for (int i = 0; i < NUM_SENSORS; i++) {
+    msg = "raw("+ String(i) + ")=" + sensors.raw[i] + "\tVout("+ String(i) + ")=" + String(rawToVout<Board>(sensors.raw[i]), 2) + "\tR("+ String(i) + ")=" + sensors.R[i] + "\tout("+ String(i) + ")=" + sensors.value[i];
     Serial.println(msg);  
   }
-  // Stretch
-  msg = "raw(s)=" + String((int)(sInfo[RAW_I])) + "\tVout(s)=" + String(sInfo[VOUT_I], 2) + "\tR(s)=" + String(sInfo[R_I], 2);
+  // Idle governor
+  msg = "idle=" + String(isIdle()) + "\twake(us)=" + String(wakeLatencyUs);
   Serial.println(msg);
 
   }
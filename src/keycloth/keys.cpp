@@ -1,8 +1,9 @@
 #include "keys.h"
 #include <Wire.h>
 #include <Adafruit_MPR121.h>
-#include "pitchToNote.h"
 #include <EEPROM.h>
+#include "calib.h"
+#include "tuning.h"
 
 /* keys.cpp - Implementation of keypad functionality
 
@@ -25,32 +26,75 @@
 */
 
 /**
- * @def TOUCH_THRESHOLD
- * @brief Sensitivity threshold for touch recognition (MPR121)
+ * @def KEYPAD_CONFIG2
+ * @brief MPR121 CONFIG2 without the sample interval (0.5us encoding, 4 samples).
  */
-#define TOUCH_THRESHOLD 12
+#define KEYPAD_CONFIG2 0x20
 
 /**
- * @def RELEASE_THRESHOLD
- * @brief Sensitivity threshold for release recognition (MPR121)
+ * @def MPR121_OVCF
+ * @brief Over current flag in the MPR121 touch status.
  */
-#define RELEASE_THRESHOLD 6
+#define MPR121_OVCF 0x8000
 
-uint16_t minCap[NUM_KEYS];
+/**
+ * @def KEYPAD_BLOCK_LEN
+ * @brief Registers read per scan: touch status, out of range status,
+ * filtered data and baselines of all 13 electrodes (0x00..0x2A).
+ */
+#define KEYPAD_BLOCK_LEN (MPR121_BASELINE_0 + 13)
 
 /**
- * @brief Keypad keys to notes
- *
- * Physical index map (hex numbering):
- *      0  1  2  3
- *    4  5  6  7
- *      8  9  A  B
+ * @def KEYPAD_I2C_CLOCK
+ * @brief I2C clock of the keypad bus (MPR121 fast mode).
  */
-const float keyMap[] = {
-  D3, G3b, B3, D4,
-  F3, A3, D4b, F4, 
-  C3, E3, A3b, C4
-};
+#define KEYPAD_I2C_CLOCK 400000UL
+
+/**
+ * @def KEYPAD_STEP_CYCLES
+ * @brief Period of the timer stepping the keypad transfer: one byte on the bus
+ * (9 clocks).
+ */
+#define KEYPAD_STEP_CYCLES (F_CPU / KEYPAD_I2C_CLOCK * 9)
+
+/**
+ * @def KEYPAD_STEP_LEAD
+ * @brief Cycles from the bus command issued in I2CAsync.step() to the timer
+ * reload after it. Too low only makes the next interrupt a little late.
+ */
+#define KEYPAD_STEP_LEAD 32
+
+/**
+ * @def KEYPAD_STEP_RETRY
+ * @brief Cycles to the next interrupt when the bus event was not there yet.
+ */
+#define KEYPAD_STEP_RETRY 48
+
+/**
+ * @def KEYPAD_PROX_SETTLE_MS
+ * @brief Wait for the first proximity conversions after enabling the channel.
+ */
+#define KEYPAD_PROX_SETTLE_MS 20
+
+/**
+ * @def KEYPAD_PROX_DATA_MIN
+ * @brief Lowest usable proximity reading. The combined electrodes charge with
+ * the settings of a single key, too many of them drive filteredData(12)
+ * towards 0, where an approaching hand cannot lower it any further.
+ */
+#define KEYPAD_PROX_DATA_MIN 64
+
+/**
+ * @def KEYPAD_PROX_DATA_MAX
+ * @brief Highest usable proximity reading (the 10-bit ADC saturates at 1023,
+ * bus errors read 0xFFFF).
+ */
+#define KEYPAD_PROX_DATA_MAX 1000
+
+uint8_t touchThreshold = TOUCH_THRESHOLD;
+uint8_t releaseThreshold = RELEASE_THRESHOLD;
+
+uint16_t minCap[NUM_KEYS];
 
 /**
  * @brief Hardcoded minimum capacitance values in case of uninitialized/wiped EEPROM.
@@ -65,7 +109,7 @@ Adafruit_MPR121 cap = Adafruit_MPR121();
 /**
  * @brief KeyInfo constructor.
  */
-KeyInfo::KeyInfo() {}
+KeyInfo::KeyInfo() : touched(0), played(0), errors(0), near(false) {}
 
 /**
  * @brief Load minimum capacitance values from EEPROM.
@@ -99,36 +143,185 @@ void updateMinCap(int keyIndex, uint16_t capVal) {
 }
 
 /**
- * @brief Wipe capacitance values from EEPROM.
+ * @brief Wipe capacitance values and sensor calibration from EEPROM.
  */
 void wipeEEPROM() {
   uint16_t resetValue = 0xFFFF;
   for (int i = 0; i < NUM_KEYS; i++) {
       EEPROM.put(i * sizeof(uint16_t), resetValue); 
   }
+  wipeCalibration();
+}
+
+#ifdef BUSIO_HAS_I2C_ASYNC
+/**
+ * @brief Bus event of the keypad transfer (timer 3 compare match).
+ *
+ * Wire owns the TWI interrupt, so timer 3 stands in for it while the bus
+ * is busy: the transfer runs in the background instead of inside
+ * cap.wait(). After an event the next interrupt comes one byte after the
+ * command just issued; if it came too early (a START is shorter than a
+ * byte), it tries again shortly.
+ */
+ISR(TIMER3_COMPA_vect) {
+  TCNT3 = I2CAsync.step() ? KEYPAD_STEP_LEAD : KEYPAD_STEP_CYCLES - KEYPAD_STEP_RETRY;
+}
+
+/**
+ * @brief Start or stop the stepping timer, called by I2CAsync.
+ */
+static void keypadStepper(bool run) {
+  if (run) {
+    TCNT3 = KEYPAD_STEP_CYCLES - KEYPAD_STEP_RETRY;  // Just after the START
+    TIFR3 = _BV(OCF3A);
+    TIMSK3 = _BV(OCIE3A);
+  } else {
+    TIMSK3 = 0;
+  }
+}
+
+/**
+ * @brief Run timer 3 at the stepping period (takes it from PWM on pin 5).
+ */
+static void setupKeypadStepper() {
+  TIMSK3 = 0;
+  TCCR3A = 0;
+  TCCR3B = _BV(WGM32) | _BV(CS30);  // CTC, no prescaler
+  OCR3A = KEYPAD_STEP_CYCLES - 1;
+  I2CAsync.setStepper(keypadStepper);
+}
+#endif
+
+/**
+ * @brief Enable the proximity channel with the largest electrode group that
+ * reads in range.
+ *
+ * Tries KEYPAD_PROX_ELECTRODES, then KEYPAD_PROX_FALLBACK. If neither reads
+ * in range the channel stays off and the idle scans wake on the key status
+ * alone.
+ */
+static void setupProximity() {
+  static const mpr121_proximity_t groups[] = {KEYPAD_PROX_ELECTRODES, KEYPAD_PROX_FALLBACK};
+  for (mpr121_proximity_t electrodes : groups) {
+    cap.setProximity(electrodes, PROX_TOUCH_THRESHOLD, PROX_RELEASE_THRESHOLD);
+    delay(KEYPAD_PROX_SETTLE_MS);
+    uint16_t data = cap.filteredData(MPR121_PROXIMITY_CHANNEL);
+    if (data >= KEYPAD_PROX_DATA_MIN && data <= KEYPAD_PROX_DATA_MAX) {
+      return;
+    }
+    Serial.print("MPR121 proximity reading out of range: ");
+    Serial.println(data);
+  }
+  cap.setProximity(MPR121_PROX_OFF, PROX_TOUCH_THRESHOLD, PROX_RELEASE_THRESHOLD);
 }
 
 /**
  * @brief Setup the keypad.
  */
 void setupKeypad() {
+#ifdef BUSIO_HAS_I2C_ASYNC
+  setupKeypadStepper();
+#endif
   // Default address is 0x5A, if tied to 3.3V its 0x5B
   // If tied to SDA its 0x5C and if SCL then 0x5D
-  if (!cap.begin(0x5A)) {
+  if (!cap.begin(Board::keypadAddr)) {
     Serial.println("MPR121 not found, check wiring?");
     while (1);
   }
+  Wire.setClock(KEYPAD_I2C_CLOCK);
   // Calibrate sensitivity 
-  cap.setThresholds(TOUCH_THRESHOLD, RELEASE_THRESHOLD);
+  applyKeypadThresholds();
+  // Hover detection, the idle scans only read its status
+  setupProximity();
   loadMinCap();
 }
 
+/**
+ * @brief Send touchThreshold and releaseThreshold to the MPR121.
+ */
+void applyKeypadThresholds() {
+  cap.setThresholds(touchThreshold, releaseThreshold);
+}
+
+/**
+ * @brief Set the MPR121 electrode sample interval.
+ *
+ * Keeps the baselines across the stop mode the write needs: reloaded, they
+ * would swallow the touch (or the hovering hand) that woke the device.
+ */
+void setKeypadSamplePeriod(uint8_t esi) {
+  cap.writeRegister(MPR121_CONFIG2, KEYPAD_CONFIG2 | (esi & 0x07), true);
+}
+
+/**
+ * @brief Read the filtered data of an MPR121 electrode.
+ */
+uint16_t readElectrode(uint8_t e) {
+  return cap.filteredData(e);
+}
+
+/**
+ * @brief Read only the keypad touch status (idle scan).
+ */
+bool keypadNear() {
+  uint16_t status = cap.readRegister16(MPR121_TOUCHSTATUS_L);  // 0xFFFF on bus errors
+  return status & (KEY_MASK | MPR121_PROXIMITY_BIT);
+}
+
+/**
+ * @brief Keypad register block read, in flight between startKeyScan() and keyHandler().
+ *
+ * One transaction streams the whole block into keypadBlock instead of a
+ * status read plus two register reads per touched key.
+ */
+static Adafruit_I2CTransaction blockRead;
+static uint8_t keypadBlock[KEYPAD_BLOCK_LEN];
+static unsigned long blockReadUs;  // Start of blockRead
+
+/**
+ * @brief Start reading the keypad registers in the background.
+ */
+void startKeyScan() {
+  if (blockRead.state != I2C_ASYNC_IDLE) return;  // Already in flight
+  blockReadUs = micros();
+  if (!cap.readRegistersAsync(MPR121_TOUCHSTATUS_L, keypadBlock, KEYPAD_BLOCK_LEN, blockRead)) {
+    blockRead.state = I2C_ASYNC_FAILED;
+  }
+}
+
+/**
+ * @brief Whether the keypad read is still running in the background.
+ */
+bool keyScanPending() {
+  if (blockRead.state == I2C_ASYNC_IDLE || blockRead.finished()) return false;
+  // A hung bus is left to keyHandler() to abort
+  return micros() - blockReadUs < I2C_ASYNC_TIMEOUT_US;
+}
+
+/**
+ * @brief MPR121 registers of the last full scan.
+ */
+const uint8_t *keypadRegisters() {
+  return keypadBlock;
+}
+
 /**
  * @brief Key interaction handler
  */
 void keyHandler(KeyInfo &k) {
   // Get the currently touched pads
-  uint16_t currtouched = cap.touched();
+  startKeyScan();  // In case it was not started early
+  bool ok = cap.wait(blockRead);
+  blockRead.state = I2C_ASYNC_IDLE;
+  uint16_t status = ok ? keypadBlock[MPR121_TOUCHSTATUS_L] | (keypadBlock[MPR121_TOUCHSTATUS_L + 1] << 8) : 0xFFFF;
+  if (status == 0xFFFF || (status & MPR121_OVCF)) {
+    // Bus error (reads as all ones) or over current: keep the last touch state
+    if (k.errors < 255) k.errors++;
+    return;
+  }
+  k.errors = 0;
+  uint16_t currtouched = status;
+  k.near = status & MPR121_PROXIMITY_BIT;
 
   // debugging info (copied from Adafruit MPR121 example)
   // Serial.print("\t\t\t\t\t\t\t\t\t\t\t\t\t 0x"); 
@@ -145,17 +338,17 @@ void keyHandler(KeyInfo &k) {
   // Serial.println();
 
   // KEY ACTIVATION
-  for (uint8_t i=0; i < NUM_KEYS; i++) {
-    // Touch recognition according to thresholds
-    k.active[i] = currtouched & _BV(i);
-    k.baseline[i] = cap.baselineData(i);
-    if (k.active[i]) { // if touched
-      // Extract and store filtered capacitance
-      k.filtered[i] = cap.filteredData(i); ;
-      // If applicable, update minimum capacitance value for key in EEPROM.
-      if (k.filtered[i] < minCap[i]) updateMinCap(i, k.filtered[i]);
-    }
-    else k.filtered[i] = 0;
+  // Touch recognition according to thresholds
+  k.touched = currtouched & KEY_MASK;
+  // Only touched keys need their capacitance
+  for (uint16_t pending = k.touched; pending; pending &= pending - 1) {
+    uint8_t i = __builtin_ctz(pending);
+    // Extract and store filtered capacitance (baselines hold the high 8 of 10 bits)
+    const uint8_t *filtered = &keypadBlock[MPR121_FILTDATA_0L + i * 2];
+    k.baseline[i] = keypadBlock[MPR121_BASELINE_0 + i] << 2;
+    k.filtered[i] = filtered[0] | (filtered[1] << 8);
+    // If applicable, update minimum capacitance value for key in EEPROM.
+    if (k.filtered[i] < minCap[i]) updateMinCap(i, k.filtered[i]);
   }
 }
 
@@ -24,6 +24,7 @@
 #include <Wire.h>
 #include "bend.h"
 #include "stretch.h"
+#include "board.h"
 
 #ifndef _BV
 #define _BV(bit) (1 << (bit))
@@ -33,17 +34,56 @@
  * @def NUM_KEYS
  * @brief Number of keys (12 pads on MPR121)
  */
-#define NUM_KEYS 12
+#define NUM_KEYS (Board::numKeys)
 
 /**
- * @brief Keypad keys to notes
- *
- * Physical index map (hex numbering):
- *      0  1  2  3
- *    4  5  6  7
- *      8  9  A  B
+ * @def KEY_MASK
+ * @brief Bits of all keys in a key mask.
+ */
+#define KEY_MASK ((uint16_t)((1UL << NUM_KEYS) - 1))
+
+/**
+ * @def KEY_ERROR_PANIC
+ * @brief Consecutive failed keypad reads that release all notes.
+ */
+#define KEY_ERROR_PANIC 3
+
+/**
+ * @def KEYPAD_PROX_ELECTRODES
+ * @brief Keys combined into the MPR121 proximity channel (hover detection).
+ */
+#define KEYPAD_PROX_ELECTRODES MPR121_PROX_ELE0_11
+
+/**
+ * @def KEYPAD_PROX_FALLBACK
+ * @brief Smaller proximity group used when KEYPAD_PROX_ELECTRODES saturates
+ * the proximity reading.
+ */
+#define KEYPAD_PROX_FALLBACK MPR121_PROX_ELE0_3
+
+/**
+ * @def PROX_TOUCH_THRESHOLD
+ * @brief Proximity threshold for a hand over the keypad (MPR121)
  */
-extern const float keyMap[NUM_KEYS];
+#define PROX_TOUCH_THRESHOLD 6
+
+/**
+ * @def PROX_RELEASE_THRESHOLD
+ * @brief Proximity threshold for the hand leaving (MPR121)
+ */
+#define PROX_RELEASE_THRESHOLD 3
+
+static_assert(NUM_KEYS <= 16, "Key masks hold 16 keys");
+
+/**
+ * @brief Sensitivity threshold for touch recognition (MPR121)
+ */
+extern uint8_t touchThreshold;
+
+/**
+ * @brief Sensitivity threshold for release recognition (MPR121)
+ */
+extern uint8_t releaseThreshold;
 
 /**
  * @brief Minimum capacity readings
@@ -70,10 +110,12 @@ extern uint16_t minCap[NUM_KEYS];
  * @brief Structure for storing keypad data.
  */
 struct KeyInfo {
-    bool active[NUM_KEYS]; /**< Active (pressed) keys*/
-    int filtered[NUM_KEYS]; /**< Key filtered capacitance*/
-    int baseline[NUM_KEYS]; /**< Key baseline capacitance */
-    bool notePlayed[NUM_KEYS]; /**< For tracking playing status of notes */
+    uint16_t touched; /**< Active (pressed) keys, bit i = key i */
+    uint16_t played; /**< Keys with a pending or sounding note, bit i = key i */
+    uint8_t errors; /**< Consecutive failed keypad reads */
+    bool near; /**< A hand is over the keypad (proximity channel) */
+    uint16_t filtered[NUM_KEYS]; /**< Key filtered capacitance (valid while touched) */
+    uint16_t baseline[NUM_KEYS]; /**< Key baseline capacitance (valid while touched) */
 
     
     /**
@@ -83,7 +125,7 @@ struct KeyInfo {
 };
 
 /**
- * @brief Wipe capacitance values from EEPROM.
+ * @brief Wipe capacitance values and sensor calibration from EEPROM.
  */
 void wipeEEPROM();
 
@@ -92,9 +134,63 @@ void wipeEEPROM();
  */
 void setupKeypad();
 
+/**
+ * @brief Send touchThreshold and releaseThreshold to the MPR121.
+ */
+void applyKeypadThresholds();
+
+/**
+ * @brief Set the MPR121 electrode sample interval.
+ *
+ * Longer intervals save power but delay touch detection.
+ *
+ * @esi: Sample interval as 2^esi ms (0..7).
+ */
+void setKeypadSamplePeriod(uint8_t esi);
+
+/**
+ * @brief Read the filtered data of an MPR121 electrode.
+ *
+ * @e: Electrode index.
+ */
+uint16_t readElectrode(uint8_t e);
+
+/**
+ * @brief Read only the keypad touch status (idle scan).
+ *
+ * One register pair instead of the full block: returns true if a hand is
+ * near the proximity electrode, a key is touched or the read failed, i.e.
+ * when a full scan is due.
+ */
+bool keypadNear();
+
+/**
+ * @brief Start reading the keypad registers in the background.
+ *
+ * The I2C transfer (touch status, filtered data and baselines in one
+ * block) runs while the caller does other work, keyHandler() collects it.
+ */
+void startKeyScan();
+
+/**
+ * @brief Whether the read started by startKeyScan() is still running.
+ *
+ * Turns false once the read finished or took longer than it may, so the
+ * caller can do other work until then instead of blocking in keyHandler().
+ */
+bool keyScanPending();
+
+/**
+ * @brief MPR121 registers of the last full scan (touch status to the last baseline, 0x00..0x2A).
+ *
+ * Valid after keyHandler() returned without a read error.
+ */
+const uint8_t *keypadRegisters();
+
 /**
  * @brief Key interaction handler
  *
+ * Waits for the read started by startKeyScan() (starts it if needed).
  */
 void keyHandler(KeyInfo &k); 
 
@@ -0,0 +1,101 @@
+/* layout.cpp - Implementation of key to note layouts
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "layout.h"
+#include "pitchToNote.h"
+
+static_assert(NUM_KEYS == 12, "Key geometry describes the 12 key cloth");
+
+uint8_t noteTable[NUM_KEYS];
+
+static bool pending = false;
+
+/**
+ * @brief The original KeyCloth notes
+ *
+ * Physical index map (hex numbering):
+ *      0  1  2  3
+ *    4  5  6  7
+ *      8  9  A  B
+ */
+static const uint8_t clothNotes[NUM_KEYS] = {
+  D3, G3b, B3, D4,
+  F3, A3, D4b, F4,
+  C3, E3, A3b, C4
+};
+
+/**
+ * @brief Hex grid position of each key as (steps right, steps up-right) from key 8.
+ */
+static const int8_t keyRight[NUM_KEYS] = {-1, 0, 1, 2, -1, 0, 1, 2, 0, 1, 2, 3};
+static const int8_t keyUpRight[NUM_KEYS] = {2, 2, 2, 2, 1, 1, 1, 1, 0, 0, 0, 0};
+
+/**
+ * @brief Intervals (semitones) of the isomorphic layouts, indexed by layout.
+ */
+static const int8_t stepRight[NUM_LAYOUTS] = {0, 2, 1, 7};
+static const int8_t stepUpRight[NUM_LAYOUTS] = {0, 7, 4, 4};
+
+/**
+ * @brief Snap a note down to the scale.
+ */
+static int lockToScale(int note) {
+  uint16_t mask = scale & SCALE_CHROMATIC;
+  if (!mask) return note;
+  while (!(mask & _BV(((note - scaleRoot) % 12 + 12) % 12))) note--;
+  return note;
+}
+
+/**
+ * @brief Resolve the layout parameters into noteTable.
+ */
+void applyLayout() {
+  if (layout < 0 || layout >= NUM_LAYOUTS) layout = LAYOUT_CLOTH;
+  for (uint8_t i = 0; i < NUM_KEYS; i++) {
+    int note = layout == LAYOUT_CLOTH
+        ? clothNotes[i]
+        : LAYOUT_BASE_NOTE + keyRight[i] * stepRight[layout] + keyUpRight[i] * stepUpRight[layout];
+    note = lockToScale(note + transpose + 12 * octaveShift);
+    noteTable[i] = note < 0 ? 0 : (note > 127 ? 127 : note);
+  }
+  pending = false;
+}
+
+/**
+ * @brief Request a layout change.
+ */
+void selectLayout(uint8_t index) {
+  layout = index % NUM_LAYOUTS;
+  pending = true;
+}
+
+/**
+ * @brief Request noteTable to be rebuilt after a parameter change.
+ */
+void requestLayout() {
+  pending = true;
+}
+
+/**
+ * @brief Whether a layout change is waiting to be applied.
+ */
+bool layoutPending() {
+  return pending;
+}
@@ -0,0 +1,116 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+/* layout.h - Key to note layouts
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include "keys.h"
+
+/**
+ * Layouts (selectable by MIDI program change, program = layout)
+ */
+#define LAYOUT_CLOTH 0        /**< The original hand-made KeyCloth table */
+#define LAYOUT_WICKI_HAYDEN 1 /**< Right +2, up-right +7 semitones */
+#define LAYOUT_HARMONIC 2     /**< Harmonic table: right +1, up-right +4 semitones */
+#define LAYOUT_TONNETZ 3      /**< Right +7, up-right +4 semitones */
+#define NUM_LAYOUTS 4
+
+/**
+ * Scales as 12-bit pitch class masks relative to the root (bit 0 = root)
+ */
+#define SCALE_CHROMATIC 0xFFF
+#define SCALE_MAJOR 0xAB5
+#define SCALE_MINOR 0x5AD
+#define SCALE_PENTATONIC 0x295
+#define SCALE_BLUES 0x4E9
+
+/**
+ * @def LAYOUT_GESTURE
+ * @brief Gesture that steps to the next layout when held.
+ */
+#define LAYOUT_GESTURE GESTURE_STRETCH
+
+/**
+ * @def LAYOUT_BASE_NOTE
+ * @brief Note of the bottom left key (8) in the isomorphic layouts.
+ */
+#define LAYOUT_BASE_NOTE 48
+
+/**
+ * @brief Layout (LAYOUT_*).
+ */
+extern int layout;
+
+/**
+ * @brief Scale the notes are locked to (SCALE_* or any pitch class mask).
+ *
+ * Out of scale notes snap down to the next scale note.
+ */
+extern uint16_t scale;
+
+/**
+ * @brief Root pitch class of the scale (0 = C .. 11 = B).
+ */
+extern int scaleRoot;
+
+/**
+ * @brief Transposition in semitones.
+ */
+extern int transpose;
+
+/**
+ * @brief Octave shift.
+ */
+extern int octaveShift;
+
+/**
+ * @brief Resolved note per key.
+ *
+ * Rebuilt by applyLayout(), the note path only does a byte lookup.
+ */
+extern uint8_t noteTable[NUM_KEYS];
+
+/**
+ * @brief Resolve the layout parameters into noteTable.
+ */
+void applyLayout();
+
+/**
+ * @brief Request a layout change.
+ *
+ * The change is applied by the MIDI layer between two scans, after the
+ * notes of the old layout are released.
+ *
+ * @index: Layout (LAYOUT_*), wraps around.
+ */
+void selectLayout(uint8_t index);
+
+/**
+ * @brief Request noteTable to be rebuilt after a parameter change.
+ */
+void requestLayout();
+
+/**
+ * @brief Whether a layout change is waiting to be applied.
+ */
+bool layoutPending();
+
+#endif
@@ -2,6 +2,14 @@
 #include "MIDIUSB.h"
 #include "stretch.h"
 #include "pitchToNote.h"
+#include "arp.h"
+#include "gesture.h"
+#include "layout.h"
+#include "sysex.h"
+#include "voice.h"
+#include "power.h"
+#include "tuning.h"
+#include <string.h>
 
 /* midi.cpp - Implementation of MIDI driver
 
@@ -23,125 +31,473 @@
     with KeyCloth. If not, see <https://www.gnu.org/licenses/>. 
 */
 
-#define MIDDLE_THRESHOLD 70
+/**
+ * @def MIDI_IN_BATCH
+ * @brief Number of incoming MIDI events read per USB access.
+ */
+#define MIDI_IN_BATCH 8
+
+/**
+ * @def OUT_CHANNEL_SLOTS
+ * @brief Number of (cable, channel) pairs whose sounding notes are tracked.
+ */
+#define OUT_CHANNEL_SLOTS 4
+
+/**
+ * @def OUT_CC_SLOTS
+ * @brief Number of (channel, CC) pairs whose last value is tracked.
+ */
+#define OUT_CC_SLOTS 8
+
+/**
+ * @brief Last CC value sent per sensor + 1, 0 until the first one.
+ */
+static uint8_t lastValue[NUM_SENSORS];
+
+/**
+ * @brief Gesture parameters, indexed by GESTURE_CRUMPLE / GESTURE_STRETCH.
+ */
+GestureConfig gestureConfig[NUM_GESTURES] = {
+  // enterR, exitR, fullR, dwellMs, holdMs, note
+  {CRUMPLE_ENTER_R, CRUMPLE_EXIT_R, MIDDLE_THRESHOLD, 15, 500, C2}, // Crumple (drum hit)
+  {STRETCH_ENTER_R, STRETCH_EXIT_R, MIDDLE_THRESHOLD, 15, 500, C2}, // Stretch (drum hit)
+};
+
+static GestureInfo gestures[NUM_GESTURES];
+
+/**
+ * @brief Sounding notes of one channel of a cable.
+ */
+struct NoteState {
+  uint8_t cable; /**< Virtual cable */
+  uint8_t chan; /**< Channel + 1, 0 marks an unused slot */
+  uint8_t on[16]; /**< Bit (n & 7) of on[n >> 3] is set while note n sounds */
+};
 
-static int lastBend[NUM_BEND] = {-1, -1 ,-1};  
-bool isCrumpled = false;
-bool isStretched = false;
+/**
+ * @brief Last sent and pending value of one controller.
+ */
+struct CCState {
+  uint8_t chan; /**< Channel + 1, 0 marks an unused slot */
+  uint8_t cc; /**< Controller number */
+  uint8_t sent; /**< Last sent value, 0xFF if none yet */
+  uint8_t pending; /**< Latest value requested during this scan */
+};
+
+static NoteState noteState[OUT_CHANNEL_SLOTS];
+static CCState ccState[OUT_CC_SLOTS];
+static bool unflushed = false;
+static uint8_t sysexCable = MIDI_CABLE_TELEMETRY;
+
+/**
+ * @brief Announce the virtual cables to the host (overrides the MIDIUSB default of one).
+ */
+uint8_t MIDI_cableCount(void) {
+  return MIDI_CABLES;
+}
+
+/**
+ * @brief Queue a USB-MIDI event, it is sent with the next flushMidi().
+ *
+ * @cable: Virtual cable, high nibble of the USB-MIDI header.
+ * @cin: Code index number, low nibble of the header.
+ */
+static void sendEvent(uint8_t cable, uint8_t cin, uint8_t status, uint8_t data1, uint8_t data2) {
+  MidiUSB.sendMIDI({(uint8_t)(cable << 4 | cin), status, data1, data2});
+  unflushed = true;
+}
+
+/**
+ * @brief Sounding notes of the channel on a cable, NULL if untracked.
+ *
+ * @claim: Take a free slot if the channel has none (note on).
+ */
+static NoteState *noteSlot(uint8_t cable, uint8_t ch, bool claim) {
+  NoteState *free = NULL;
+  for (uint8_t i = 0; i < OUT_CHANNEL_SLOTS; i++) {
+    if (noteState[i].chan == ch + 1 && noteState[i].cable == cable) return &noteState[i];
+    if (!free && !noteState[i].chan) free = &noteState[i];
+  }
+  if (!claim || !free) return NULL; // Untracked, messages pass through unfiltered
+  free->cable = cable;
+  free->chan = ch + 1;
+  return free;
+}
 
 /**
  * @brief Send MIDI note on signal
  *
+ * Dropped if the note is already sounding on the cable.
+ *
  * @pitch: Note MIDI pitch
  * @velocity: Note velocity
+ * @cable: Virtual cable
  */
-void noteOn(int pitch, int velocity) {
-  MidiUSB.sendMIDI({NOTE_ON, 0x90 | channel, pitch, velocity});
-  MidiUSB.flush();
+void noteOn(int pitch, int velocity, uint8_t cable) {
+  pitch &= 0x7F;
+  NoteState *s = noteSlot(cable, channel, true);
+  if (s) {
+    if (s->on[pitch >> 3] & _BV(pitch & 7)) return;
+    s->on[pitch >> 3] |= _BV(pitch & 7);
+  }
+  sendEvent(cable, NOTE_ON, 0x90 | channel, pitch, velocity);
+  notePlayed();
 }
 
 /**
  * @brief Send MIDI note off signal
  *
+ * Dropped if the note is not sounding on the cable.
+ *
  * @pitch: Note MIDI pitch
+ * @cable: Virtual cable
  */
-void noteOff(int pitch) {
-  MidiUSB.sendMIDI({NOTE_OFF, 0x80 | channel, pitch, 0});
-  MidiUSB.flush();
+void noteOff(int pitch, uint8_t cable) {
+  pitch &= 0x7F;
+  // Notes sent while all slots were taken have none, their note off passes
+  NoteState *s = noteSlot(cable, channel, false);
+  if (s) {
+    if (!(s->on[pitch >> 3] & _BV(pitch & 7))) return;
+    s->on[pitch >> 3] &= ~_BV(pitch & 7);
+    // The last note of the channel ended, free the slot
+    uint8_t any = 0;
+    for (uint8_t i = 0; i < sizeof(s->on); i++) any |= s->on[i];
+    if (!any) s->chan = 0;
+  }
+  sendEvent(cable, NOTE_OFF, 0x80 | channel, pitch, 0);
 }
 
 /**
- * @brief Consolidate input signals and send out MIDI data.
+ * @brief Request a MIDI control change.
+ *
+ * Only the latest value per controller is sent at the next flushMidi(),
+ * and only if it differs from the last sent one.
+ *
+ * @cc: Controller number
+ * @value: Controller value
+ */
+void sendCC(uint8_t cc, uint8_t value) {
+  CCState *slot = NULL;
+  for (uint8_t i = 0; i < OUT_CC_SLOTS; i++) {
+    if (ccState[i].chan == channel + 1 && ccState[i].cc == cc) {
+      slot = &ccState[i];
+      break;
+    }
+    if (!slot && !ccState[i].chan) slot = &ccState[i];
+  }
+  if (!slot) {
+    // Untracked, send right away
+    sendEvent(MIDI_CABLE_EXPRESSION, 0x0B, 0xB0 | channel, cc, value);
+    return;
+  }
+  if (!slot->chan) {
+    slot->chan = channel + 1;
+    slot->cc = cc;
+    slot->sent = 0xFF;
+  }
+  slot->pending = value;
+}
+
+/**
+ * @brief Send a MIDI pitch bend.
  *
- * @sensorValue: Numeric output after reading sensor input.
- * @sensorIndex: Sensor identifier
+ * @value: Bend value (0..16383, 8192 = center)
  */
-void controlChange(float sensorValue, int sensorIndex) {
-    uint8_t midiCC = -1;
+void sendPitchBend(uint16_t value) {
+  sendEvent(MIDI_CABLE_EXPRESSION, CIN_PITCH_BEND, 0xE0 | channel, value & 0x7F, (value >> 7) & 0x7F);
+}
 
-    switch (sensorIndex) {
-      case LEFT: {
-        midiCC = 1;
-      }
-      case RIGHT: {
-        midiCC = 1;
-        // Reverse mapping: Highest resistance (flat) = 0, Lowest resistance (bent) = 127
-        uint8_t midiValue = map((int)floor(sensorValue), (int)floor(minR[sensorIndex]), (int)maxR[sensorIndex], 127, 0);
-        midiValue = constrain(midiValue, 0, 127);  // Ensure valid MIDI range
-
-        // Only send MIDI if the value has changed significantly
-        if (abs(midiValue - lastBend[sensorIndex]) > 2) {  
-          midiEventPacket_t event = {0x0B, 0xB0 | channel, midiCC, midiValue};
-          MidiUSB.sendMIDI(event);
-          MidiUSB.flush();  // Ensure MIDI data is sent immediately
-          lastBend[sensorIndex] = midiValue;  // Update last sent value
-        }
-        break;
+/**
+ * @brief Send a MIDI channel pressure.
+ *
+ * @value: Pressure value
+ */
+void sendChannelPressure(uint8_t value) {
+  sendEvent(MIDI_CABLE_EXPRESSION, CIN_CHANNEL_PRESSURE, 0xD0 | channel, value & 0x7F, 0);
+}
+
+/**
+ * @brief Send a SysEx message on the cable of the last request.
+ */
+void sendSysEx(const uint8_t *msg, uint8_t len) {
+  while (len > 3) {
+    sendEvent(sysexCable, CIN_SYSEX, msg[0], msg[1], msg[2]);
+    msg += 3;
+    len -= 3;
+  }
+  // The last packet ends the message with 1, 2 or 3 bytes
+  sendEvent(sysexCable, CIN_SYSEX_END_1 + len - 1, msg[0], len > 1 ? msg[1] : 0, len > 2 ? msg[2] : 0);
+}
+
+/**
+ * @brief Release every sounding note on every channel and cable.
+ */
+void allNotesOff() {
+  for (uint8_t i = 0; i < OUT_CHANNEL_SLOTS; i++) {
+    NoteState &s = noteState[i];
+    if (!s.chan) continue;
+    for (uint8_t pitch = 0; pitch < 128; pitch++) {
+      if (s.on[pitch >> 3] & _BV(pitch & 7)) {
+        sendEvent(s.cable, NOTE_OFF, 0x80 | (s.chan - 1), pitch, 0);
       }
-      case MIDDLE:
-        if (sensorValue < 100.0 && !isStretched) {
-          int velocity = map((int)floor(sensorValue), MIDDLE_THRESHOLD, minR[sensorIndex], 1, 127);
-          if (!isCrumpled) {
-            noteOn(C2, velocity);  // Trigger drum hit
-            delay(50);  // Prevent retriggering too fast
-          } else {
-            noteOff(C2);
-            isCrumpled = false;
-          }
-        }
-        break;
-      case S: {
-        isStretched = sensorValue < 250.0;
-        if (isStretched) {
-          if (sensorValue < 100.0 && !isCrumpled) {
-          int velocity = map((int)floor(sensorValue), MIDDLE_THRESHOLD, minR[sensorIndex], 1, 127);
-          if (!isCrumpled) {
-            noteOn(C2, velocity);  // Trigger drum hit
-            delay(50);  // Prevent retriggering too fast
-          } else {
-            noteOff(C2);
-            isStretched = false;
-          }
-        }
-        }
-        break;
+    }
+    memset(s.on, 0, sizeof(s.on));
+    s.chan = 0;
+  }
+}
+
+/**
+ * @brief Send coalesced control changes and flush queued MIDI data.
+ */
+void flushMidi() {
+  for (uint8_t i = 0; i < OUT_CC_SLOTS; i++) {
+    CCState &c = ccState[i];
+    if (c.chan && c.pending != c.sent) {
+      sendEvent(MIDI_CABLE_EXPRESSION, 0x0B, 0xB0 | (c.chan - 1), c.cc, c.pending);
+      c.sent = c.pending;
+    }
+    // Controllers of a previous channel are retired once their last value is out
+    if (c.chan != channel + 1) c.chan = 0;
+  }
+  if (unflushed) {
+    MidiUSB.flush();
+    unflushed = false;
+  }
+}
+
+/**
+ * @brief Run a gesture recognizer and emit its note on/off.
+ *
+ * Gestures exclude each other: one can only engage while all others rest.
+ *
+ * @i: Gesture index.
+ * @r: Sensor resistance.
+ */
+static void handleGesture(uint8_t i, uint16_t r) {
+  bool blocked = false;
+  for (uint8_t j = 0; j < NUM_GESTURES; j++) {
+    if (j != i && gestures[j].state != GESTURE_REST) blocked = true;
+  }
+  switch (stepGesture(gestures[i], gestureConfig[i], r, (uint16_t)millis(), blocked)) {
+    case GESTURE_ON:
+      noteOn(gestureConfig[i].note, gestures[i].velocity, MIDI_CABLE_DRUMS);
+      break;
+    case GESTURE_OFF:
+      noteOff(gestureConfig[i].note, MIDI_CABLE_DRUMS);
+      break;
+    case GESTURE_HOLD:
+      if (i == LAYOUT_GESTURE) selectLayout(layout + 1);
+      break;
+  }
+}
+
+/**
+ * @brief Emit stage of a sensor channel.
+ *
+ * @i: Sensor channel.
+ */
+static void emitSensor(uint8_t i) {
+  const SensorConfig &c = sensorConfig[i];
+  switch (c.emit) {
+    case EMIT_CC: {
+      uint8_t midiValue = sensors.value[i];
+      // Only send MIDI if the value has changed significantly (or was never sent)
+      if (!lastValue[i] || abs(midiValue - (lastValue[i] - 1)) > 2) {
+        sendCC(c.param, midiValue);  // Coalesced, sent by flushMidi()
+        lastValue[i] = midiValue + 1;  // Update last sent value
       }
+      break;
     }
+    case EMIT_GESTURE:
+      handleGesture(c.param, sensors.R[i]);
+      break;
+  }
+}
+
+static VoiceState voices;
+static bool panicRequested = false;
+static bool usbConfigured = false;
+
+/**
+ * @brief Keys of a mask that play a note.
+ *
+ * Keys can share a note (scale lock snapping, clamping at the ends of the
+ * MIDI range), which sounds until the last of them is released.
+ *
+ * @keys: Keys to look at.
+ * @note: MIDI pitch.
+ */
+static uint16_t keysOnNote(uint16_t keys, uint8_t note) {
+  uint16_t found = 0;
+  for (; keys; keys &= keys - 1) {
+    uint8_t i = __builtin_ctz(keys);
+    if (noteTable[i] == note) found |= _BV(i);
+  }
+  return found;
+}
+
+/**
+ * @brief Send note offs for the sounding voices and return them to idle.
+ */
+static void releaseVoices() {
+  for (uint16_t sounding = voices.sounding; sounding; sounding &= sounding - 1) {
+    uint8_t note = noteTable[__builtin_ctz(sounding)];
+    if (!keysOnNote(sounding & (sounding - 1), note)) noteOff(note);  // Once per shared note
+  }
+  resetVoices(voices);
+}
+
+/**
+ * @brief Release all notes and voices with the next handleSignals().
+ */
+void midiPanic() {
+  panicRequested = true;
+}
+
+static uint8_t sysexBuffer[SYSEX_MAX];
+static uint8_t sysexLength = 0;
+static bool sysexOverflow = false;
+static uint8_t sysexInCable = MIDI_CABLE_TELEMETRY;
+
+/**
+ * @brief Collect the bytes of an incoming SysEx message and dispatch it when complete.
+ *
+ * @e: USB-MIDI event packet (CIN_SYSEX .. CIN_SYSEX_END_1 + 2).
+ */
+static void receiveSysEx(const midiEventPacket_t &e) {
+  uint8_t cin = e.header & 0x0F;
+  uint8_t count = cin == CIN_SYSEX ? 3 : cin - CIN_SYSEX_END_1 + 1;
+  const uint8_t bytes[3] = {e.byte1, e.byte2, e.byte3};
+  for (uint8_t i = 0; i < count; i++) {
+    if (bytes[i] == 0xF0) {
+      sysexLength = 0;
+      sysexOverflow = false;
+      sysexInCable = e.header >> 4;
+    }
+    if (sysexLength < SYSEX_MAX) sysexBuffer[sysexLength++] = bytes[i];
+    else sysexOverflow = true;
+  }
+  if (cin != CIN_SYSEX) {
+    if (!sysexOverflow && sysexLength >= 2 && sysexBuffer[0] == 0xF0) {
+      sysexCable = sysexInCable;  // Reply on the port the host talks on
+      handleSysEx(sysexBuffer, sysexLength);
+    }
+    sysexLength = 0;
+    sysexOverflow = false;
+  }
+}
+
+/**
+ * @brief Dispatch one incoming MIDI event, whatever cable it came in on.
+ *
+ * @e: USB-MIDI event packet.
+ */
+static void handleMidiIn(const midiEventPacket_t &e) {
+  uint8_t cin = e.header & 0x0F;
+  if (cin >= CIN_SYSEX && cin <= CIN_SYSEX_END_1 + 2) {
+    receiveSysEx(e);
+    return;
+  }
+  if (cin == CIN_PROGRAM_CHANGE) {
+    if (e.byte1 == (0xC0 | channel) && e.byte2 < NUM_LAYOUTS) selectLayout(e.byte2);
+    return;
+  }
+  if (cin != CIN_SINGLE_BYTE) return;
+  switch (e.byte1) {
+    case 0xF8: arpClock(); break;     // Timing clock
+    case 0xFA: arpStart(true); break; // Start
+    case 0xFB: arpStart(false); break; // Continue
+    case 0xFC: arpStop(); break;      // Stop
+  }
+}
+
+/**
+ * @brief Read and dispatch incoming MIDI messages (clock, transport, program change, SysEx).
+ */
+void pollMidiIn() {
+  // The host forgets sounding notes when the device (re)connects
+  bool configured = USBDevice.configured();
+  if (configured != usbConfigured) {
+    usbConfigured = configured;
+    if (configured) midiPanic();
+  }
+
+  midiEventPacket_t rx[MIDI_IN_BATCH];
+  uint8_t n;
+  while ((n = MidiUSB.readMany(rx, MIDI_IN_BATCH)) > 0) {
+    for (uint8_t i = 0; i < n; i++) {
+      handleMidiIn(rx[i]);
+    }
+  }
+  flushMidi();
 }
 
 /**
  * @brief Consolidate input signals and send out MIDI data.
  *
  * @k: Key input data.
- * @b: Bend sensor input data.
- * @stretch: Stretch sensor input data.
  */
-void handleSignals(KeyInfo &k, BendInfo &b, float sInfo[]) {
-  // BEND MOD
-  for (int i = 0; i < NUM_BEND; i++) { 
-    controlChange(b.R[i], i);
+void handleSignals(KeyInfo &k) {
+  // PANIC
+  if (k.errors == KEY_ERROR_PANIC) panicRequested = true;  // Keypad stopped answering
+  if (panicRequested) {
+    panicRequested = false;
+    allNotesOff();
+    // All notes off, for notes we lost track of
+    sendEvent(MIDI_CABLE_KEYS, 0x0B, 0xB0 | channel, 123, 0);
+    sendEvent(MIDI_CABLE_DRUMS, 0x0B, 0xB0 | channel, 123, 0);
+    resetVoices(voices);
+    k.touched = 0;  // Stale while the keypad fails, keys attack again once it answers
   }
-  // STRETCH MOD
-  controlChange(sInfo[R_I], S);
 
-  // PLAY NOTE 
-  for (int i = 0; i < NUM_KEYS; i++) {
-    if (k.active[i]) {  
-      // PRESSURE MOD
-      // Map capacitance drop to velocity
-      int velocity = map(k.filtered[i], k.baseline[i], minCap[i], 1, 127);
-      if (!k.notePlayed[i]) {  // If the note hasn't been played yet
-          noteOn(keyMap[i], velocity);  // Play the note
-          k.notePlayed[i] = true;    // Mark the note as played
-          delay(100);
-      }
-    } else {
-      if (k.notePlayed[i]) {  // If the note was previously played and key is now released
-          noteOff(keyMap[i]);  // Stop the note
-          k.notePlayed[i] = false;  // Reset the note as not played
-      }
+  // LAYOUT CHANGE
+  if (layoutPending()) {
+    // Release the notes of the old layout, held keys retrigger below
+    releaseVoices();
+    applyLayout();
+    arpLayoutChanged();
+  }
+
+  // BEND / STRETCH MOD
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    emitSensor(i);
+  }
+  serviceStretch((uint16_t)millis());
+
+  // ARPEGGIATOR
+  if (arpMode != ARP_OFF) {
+    // Notes played before the arpeggiator was turned on
+    if (voices.sounding | voices.attack) releaseVoices();
+    int velocity[NUM_KEYS];
+    for (uint16_t pending = k.touched; pending; pending &= pending - 1) {
+      uint8_t i = __builtin_ctz(pending);
+      velocity[i] = map(k.filtered[i], k.baseline[i], minCap[i], 1, 127);
     }
+    arpKeys(k.touched, velocity);
+    arpService();
+    flushMidi();
+    return;
+  }
+
+  // PLAY NOTE 
+  // Only keys with a touch edge or a pending attack/release need work
+  uint16_t on, off;
+  stepVoices(voices, k.touched, (uint16_t)millis(), on, off);
+  for (; off; off &= off - 1) {
+    // Stop the note, by the last key that holds it (still sounding, or stopping with it)
+    uint8_t note = noteTable[__builtin_ctz(off)];
+    if (!keysOnNote(voices.sounding | (off & (off - 1)), note)) noteOff(note);
+  }
+  for (; on; on &= on - 1) {
+    uint8_t i = __builtin_ctz(on);
+    // PRESSURE MOD
+    // Map capacitance drop to velocity
+    int velocity = map(k.filtered[i], k.baseline[i], minCap[i], 1, 127);
+    noteOn(noteTable[i], velocity);  // Play the note
   }
+  k.played = voices.sounding | voices.attack;
+  // Send everything collected during this scan in one go
+  flushMidi();
 }
 
 
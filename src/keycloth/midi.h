@@ -22,7 +22,8 @@
 */
 
 #include "keys.h"
-#include "bend.h"
+#include "sensors.h"
+#include "gesture.h"
 
 /**
  * @def NOTE_ON
@@ -35,33 +36,166 @@
  */
 #define NOTE_OFF 0x08
 
+/**
+ * @def CIN_SINGLE_BYTE
+ * @brief USB-MIDI code index number of single byte messages (system real-time)
+ */
+#define CIN_SINGLE_BYTE 0x0F
+
+/**
+ * @def CIN_PROGRAM_CHANGE
+ * @brief USB-MIDI code index number of program change messages
+ */
+#define CIN_PROGRAM_CHANGE 0x0C
+
+/**
+ * @def CIN_CHANNEL_PRESSURE
+ * @brief USB-MIDI code index number of channel pressure messages
+ */
+#define CIN_CHANNEL_PRESSURE 0x0D
+
+/**
+ * @def CIN_PITCH_BEND
+ * @brief USB-MIDI code index number of pitch bend messages
+ */
+#define CIN_PITCH_BEND 0x0E
+
+/**
+ * @def CIN_SYSEX
+ * @brief USB-MIDI code index number of a SysEx start or continuation (3 bytes)
+ */
+#define CIN_SYSEX 0x04
+
+/**
+ * @def CIN_SYSEX_END_1
+ * @brief USB-MIDI code index number of a SysEx end with 1 byte (2 and 3 bytes follow)
+ */
+#define CIN_SYSEX_END_1 0x05
+
+/**
+ * @def MIDI_CABLES
+ * @brief Number of virtual cables (MIDI ports) announced to the host.
+ *
+ * Every event carries its cable in the high nibble of the USB-MIDI
+ * header, all cables share the same USB endpoints and flushes.
+ */
+#define MIDI_CABLES 4
+
+#define MIDI_CABLE_KEYS 0       /**< Key and arpeggiator notes */
+#define MIDI_CABLE_DRUMS 1      /**< Gesture (drum) notes */
+#define MIDI_CABLE_EXPRESSION 2 /**< Bend CCs and stretch expression */
+#define MIDI_CABLE_TELEMETRY 3  /**< SysEx replies and capture records, until a request arrives on another cable */
+
+/**
+ * @def SYSEX_MAX
+ * @brief Longest incoming SysEx message (including F0 and F7), longer ones are dropped.
+ */
+#define SYSEX_MAX 16
+
 /**
  * @brief MIDI channel to be used
  */
 extern int channel;
 
+/**
+ * @brief Gesture parameters, indexed by GESTURE_CRUMPLE / GESTURE_STRETCH.
+ */
+extern GestureConfig gestureConfig[NUM_GESTURES];
+
 /**
  * @brief Send MIDI note on signal
  *
+ * Dropped if the note is already sounding on the cable. Sent with the
+ * next flushMidi().
+ *
  * @pitch: Note MIDI pitch
  * @velocity: Note velocity
+ * @cable: Virtual cable, MIDI_CABLE_*
  */
-void noteOn(int pitch, int velocity);
+void noteOn(int pitch, int velocity, uint8_t cable = MIDI_CABLE_KEYS);
 
 /**
  * @brief Send MIDI note off signal
  *
+ * Dropped if the note is not sounding on the cable. Sent with the next
+ * flushMidi().
+ *
  * @pitch: Note MIDI pitch
+ * @cable: Virtual cable, MIDI_CABLE_*
+ */
+void noteOff(int pitch, uint8_t cable = MIDI_CABLE_KEYS);
+
+/**
+ * @brief Request a MIDI control change on the expression cable
+ *
+ * Requests are coalesced per controller until flushMidi().
+ *
+ * @cc: Controller number
+ * @value: Controller value
  */
-void noteOff(int pitch);
+void sendCC(uint8_t cc, uint8_t value);
+
+/**
+ * @brief Send a MIDI pitch bend on the expression cable
+ *
+ * Sent with the next flushMidi().
+ *
+ * @value: Bend value (0..16383, 8192 = center)
+ */
+void sendPitchBend(uint16_t value);
+
+/**
+ * @brief Send a MIDI channel pressure on the expression cable
+ *
+ * Sent with the next flushMidi().
+ *
+ * @value: Pressure value
+ */
+void sendChannelPressure(uint8_t value);
+
+/**
+ * @brief Send a SysEx message.
+ *
+ * Goes out on the cable the last SysEx request came in on, so replies
+ * reach the port the host talks on. Sent with the next flushMidi().
+ *
+ * @msg: Complete message, F0 to F7.
+ * @len: Message length.
+ */
+void sendSysEx(const uint8_t *msg, uint8_t len);
+
+/**
+ * @brief Release every sounding note on every channel and cable.
+ */
+void allNotesOff();
+
+/**
+ * @brief Release all notes and voices with the next handleSignals().
+ *
+ * Sends note offs for every tracked note plus All Notes Off (CC 123).
+ * Triggered on USB (re)connection and when the keypad stops answering.
+ */
+void midiPanic();
+
+/**
+ * @brief Send coalesced control changes and flush queued MIDI data.
+ */
+void flushMidi();
+
+/**
+ * @brief Read and dispatch incoming MIDI messages (clock, transport, program change, SysEx).
+ *
+ * Non-blocking, only drains what the host has already sent.
+ */
+void pollMidiIn();
 
 /**
  * @brief Consolidate input signals and send out MIDI data.
  *
+ * Sensor channels are read from the global sensors data.
+ *
  * @k: Key input data.
- * @b: Bend sensor input data.
- * @stretch: Stretch sensor input data.
  */
-void handleSignals(KeyInfo &k, BendInfo &b, float stretch[]);
+void handleSignals(KeyInfo &k);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,168 @@
+/* params.cpp - Implementation of the live parameter table and store
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "params.h"
+#include "keys.h"
+#include "midi.h"
+#include "sensors.h"
+#include "layout.h"
+#include "arp.h"
+#include "utils.h"
+#include <EEPROM.h>
+#include <avr/pgmspace.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief Parameter table, indexed by id (kept in flash).
+ */
+static const ParamInfo params[NUM_PARAMS] PROGMEM = {
+  // type, variable, min, max, apply
+  {PARAM_INT, &channel, 0, 15, allNotesOff},
+  {PARAM_U8, &touchThreshold, 1, 255, applyKeypadThresholds},
+  {PARAM_U8, &releaseThreshold, 1, 255, applyKeypadThresholds},
+  {PARAM_U16, &gestureConfig[GESTURE_CRUMPLE].enterR, 0, 32767, NULL},
+  {PARAM_U16, &gestureConfig[GESTURE_CRUMPLE].exitR, 0, 32767, NULL},
+  {PARAM_U16, &gestureConfig[GESTURE_CRUMPLE].fullR, 0, 32767, NULL},
+  {PARAM_U16, &gestureConfig[GESTURE_STRETCH].enterR, 0, 32767, NULL},
+  {PARAM_U16, &gestureConfig[GESTURE_STRETCH].exitR, 0, 32767, NULL},
+  {PARAM_U16, &gestureConfig[GESTURE_STRETCH].fullR, 0, 32767, NULL},
+  {PARAM_U8, &sensorConfig[RIGHT].param, 0, 119, NULL},
+  {PARAM_U8, &sensorConfig[LEFT].param, 0, 119, NULL},
+  {PARAM_INT, &layout, 0, NUM_LAYOUTS - 1, requestLayout},
+  {PARAM_U16, &scale, 0, SCALE_CHROMATIC, requestLayout},
+  {PARAM_INT, &scaleRoot, 0, 11, requestLayout},
+  {PARAM_INT, &transpose, -48, 48, requestLayout},
+  {PARAM_INT, &octaveShift, -4, 4, requestLayout},
+  {PARAM_INT, &arpMode, ARP_OFF, ARP_UPDOWN, arpModeChanged},
+  {PARAM_BOOL, &arpLatch, 0, 1, NULL},
+  {PARAM_INT, &arpRate, 1, 96, NULL},
+  {PARAM_FLOAT, &arpBpm, 20, 300, NULL},
+  {PARAM_U8, &stretchOutput, STRETCH_OUT_NONE, STRETCH_OUT_PRESSURE, NULL},
+  {PARAM_U8, &stretchSource, STRETCH_SRC_AMOUNT, STRETCH_SRC_RATE, NULL},
+  {PARAM_U8, &stretchCC, 0, 119, NULL},
+  {PARAM_U16, &stretchRateFull, 1, 32767, NULL},
+};
+
+/**
+ * @brief Description of a parameter.
+ */
+bool paramInfo(uint8_t id, ParamInfo &info) {
+  if (id >= NUM_PARAMS) return false;
+  memcpy_P(&info, &params[id], sizeof(ParamInfo));
+  return true;
+}
+
+/**
+ * @brief Read a parameter.
+ */
+int16_t getParam(uint8_t id) {
+  ParamInfo p;
+  paramInfo(id, p);
+  switch (p.type) {
+    case PARAM_U8: return *(uint8_t *)p.ptr;
+    case PARAM_U16: return *(uint16_t *)p.ptr;
+    case PARAM_INT: return *(int *)p.ptr;
+    case PARAM_BOOL: return *(bool *)p.ptr;
+    case PARAM_FLOAT: return (int16_t)(*(float *)p.ptr + 0.5);
+  }
+  return 0;
+}
+
+/**
+ * @brief Write a parameter.
+ */
+int16_t setParam(uint8_t id, int16_t value) {
+  ParamInfo p;
+  paramInfo(id, p);
+  if (p.type == PARAM_U16) {
+    // Compare unsigned so the full 16-bit range is usable
+    uint16_t v = value;
+    if (v < (uint16_t)p.min) v = p.min;
+    if (v > (uint16_t)p.max) v = p.max;
+    value = v;
+  } else {
+    if (value < p.min) value = p.min;
+    if (value > p.max) value = p.max;
+  }
+  if (getParam(id) == value) return value;
+
+  switch (p.type) {
+    case PARAM_U8: *(uint8_t *)p.ptr = value; break;
+    case PARAM_U16: *(uint16_t *)p.ptr = value; break;
+    case PARAM_INT: *(int *)p.ptr = value; break;
+    case PARAM_BOOL: *(bool *)p.ptr = value; break;
+    case PARAM_FLOAT: *(float *)p.ptr = value; break;
+  }
+  if (p.apply) p.apply();
+  return value;
+}
+
+/**
+ * @brief CRC of a record, excluding its crc field.
+ */
+static uint16_t recordCrc(const ParamsRecord &rec) {
+  return crc16((const uint8_t *)&rec, offsetof(ParamsRecord, crc));
+}
+
+/**
+ * @brief Load the stored parameters from EEPROM.
+ */
+bool loadParams() {
+  ParamsRecord rec;
+  EEPROM.get(PARAMS_EEPROM_ADDR, rec);  // Single block read
+  if (rec.version != PARAMS_VERSION || rec.count != NUM_PARAMS || rec.crc != recordCrc(rec)) {
+    return false;
+  }
+  for (uint8_t id = 0; id < NUM_PARAMS; id++) {
+    ParamInfo p;
+    paramInfo(id, p);
+    // Set directly, the modules are not set up yet and apply the values themselves
+    switch (p.type) {
+      case PARAM_U8: *(uint8_t *)p.ptr = rec.values[id]; break;
+      case PARAM_U16: *(uint16_t *)p.ptr = rec.values[id]; break;
+      case PARAM_INT: *(int *)p.ptr = rec.values[id]; break;
+      case PARAM_BOOL: *(bool *)p.ptr = rec.values[id]; break;
+      case PARAM_FLOAT: *(float *)p.ptr = rec.values[id]; break;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Store the current parameters in EEPROM.
+ */
+void saveParams() {
+  ParamsRecord rec;
+  rec.version = PARAMS_VERSION;
+  rec.count = NUM_PARAMS;
+  for (uint8_t id = 0; id < NUM_PARAMS; id++) {
+    rec.values[id] = getParam(id);
+  }
+  rec.crc = recordCrc(rec);
+  EEPROM.put(PARAMS_EEPROM_ADDR, rec);  // Only rewrites changed bytes
+}
+
+/**
+ * @brief Invalidate the stored parameters.
+ */
+void wipeParams() {
+  EEPROM.put(PARAMS_EEPROM_ADDR, (uint8_t)0xFF);  // Unknown version
+}
@@ -0,0 +1,149 @@
+#ifndef PARAMS_H
+#define PARAMS_H
+
+/* params.h - Live parameter table and store
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include "calib.h"
+
+/**
+ * Parameter types
+ */
+#define PARAM_U8 0    /**< uint8_t */
+#define PARAM_U16 1   /**< uint16_t */
+#define PARAM_INT 2   /**< int */
+#define PARAM_BOOL 3  /**< bool */
+#define PARAM_FLOAT 4 /**< float, exchanged as a whole number */
+
+/**
+ * Parameter ids (stable, they are used by the SysEx protocol and the store)
+ */
+#define P_CHANNEL 0
+#define P_TOUCH_THRESHOLD 1
+#define P_RELEASE_THRESHOLD 2
+#define P_CRUMPLE_ENTER 3
+#define P_CRUMPLE_EXIT 4
+#define P_CRUMPLE_FULL 5
+#define P_STRETCH_ENTER 6
+#define P_STRETCH_EXIT 7
+#define P_STRETCH_FULL 8
+#define P_CC_RIGHT 9
+#define P_CC_LEFT 10
+#define P_LAYOUT 11
+#define P_SCALE 12
+#define P_SCALE_ROOT 13
+#define P_TRANSPOSE 14
+#define P_OCTAVE_SHIFT 15
+#define P_ARP_MODE 16
+#define P_ARP_LATCH 17
+#define P_ARP_RATE 18
+#define P_ARP_BPM 19
+#define P_STRETCH_OUTPUT 20
+#define P_STRETCH_SOURCE 21
+#define P_STRETCH_CC 22
+#define P_STRETCH_RATE_FULL 23
+#define NUM_PARAMS 24
+
+/**
+ * @def PARAMS_EEPROM_ADDR
+ * @brief EEPROM address of the parameter record (right after the calibration record).
+ */
+#define PARAMS_EEPROM_ADDR (CALIB_EEPROM_ADDR + sizeof(CalibRecord))
+
+/**
+ * @def PARAMS_VERSION
+ * @brief Layout version of the parameter record, bump when ids change meaning.
+ */
+#define PARAMS_VERSION 1
+
+/**
+ * @brief Description of one parameter.
+ *
+ * The table points at the variables the firmware uses anyway, so reading
+ * a parameter in the hot path stays a plain load.
+ */
+struct ParamInfo {
+    uint8_t type; /**< PARAM_* */
+    void *ptr; /**< Variable holding the value */
+    int16_t min; /**< Lowest allowed value */
+    int16_t max; /**< Highest allowed value (as uint16_t for PARAM_U16) */
+    void (*apply)(); /**< Called after the value changed, may be NULL */
+};
+
+/**
+ * @brief Parameter record as stored in EEPROM.
+ */
+struct ParamsRecord {
+    uint8_t version; /**< PARAMS_VERSION */
+    uint8_t count; /**< NUM_PARAMS */
+    int16_t values[NUM_PARAMS]; /**< Values by id */
+    uint16_t crc; /**< CRC-16/CCITT over all fields above */
+};
+
+/**
+ * @brief Description of a parameter.
+ *
+ * @id: Parameter id.
+ * @info: Receives the description.
+ * @return False for an unknown id.
+ */
+bool paramInfo(uint8_t id, ParamInfo &info);
+
+/**
+ * @brief Read a parameter.
+ *
+ * @id: Parameter id (must be valid).
+ * @return Value as 16 bits (two's complement for signed types).
+ */
+int16_t getParam(uint8_t id);
+
+/**
+ * @brief Write a parameter.
+ *
+ * The value is clamped to the parameter range, then its apply hook runs.
+ *
+ * @id: Parameter id (must be valid).
+ * @value: New value.
+ * @return The value actually set.
+ */
+int16_t setParam(uint8_t id, int16_t value);
+
+/**
+ * @brief Load the stored parameters from EEPROM.
+ *
+ * Call before the modules using them are set up. Keeps the compiled-in
+ * defaults if there is no valid record.
+ *
+ * @return True if a valid record was applied.
+ */
+bool loadParams();
+
+/**
+ * @brief Store the current parameters in EEPROM.
+ */
+void saveParams();
+
+/**
+ * @brief Invalidate the stored parameters (defaults apply after a reset).
+ */
+void wipeParams();
+
+#endif
@@ -0,0 +1,128 @@
+/* power.cpp - Implementation of the idle power-down governor
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "power.h"
+#include "board.h"
+#include "keys.h"
+#include <Arduino.h>
+#include <avr/sleep.h>
+
+uint32_t wakeLatencyUs = 0;
+
+static bool idle = false;
+static unsigned long lastActiveMs = 0;
+static unsigned long lastScanMs = 0;
+static unsigned long scanStartUs = 0;
+static unsigned long wakeStartUs = 0;
+static bool wakeTiming = false;  // Woke up, waiting for the first note on
+static volatile bool keypadIrq = false;
+static volatile unsigned long keypadIrqUs = 0;
+
+/**
+ * @brief MPR121 IRQ (touch status changed).
+ */
+static void onKeypadIrq() {
+  if (!keypadIrq) keypadIrqUs = micros();
+  keypadIrq = true;
+}
+
+/**
+ * @brief Sleep until the next interrupt, unless the keypad IRQ is pending.
+ */
+static void sleepUntilInterrupt() {
+  set_sleep_mode(SLEEP_MODE_IDLE);  // Keeps USB and timer 0 running
+  noInterrupts();
+  if (keypadIrq) {
+    interrupts();
+    return;
+  }
+  sleep_enable();
+  interrupts();  // The instruction after sei always runs, so no wake-up is lost
+  sleep_cpu();
+  sleep_disable();
+}
+
+/**
+ * @brief Setup the idle governor.
+ */
+void setupPower() {
+  if (Board::keypadIrqPin != NO_PIN) {
+    pinMode(Board::keypadIrqPin, INPUT_PULLUP);  // Open drain output
+    attachInterrupt(digitalPinToInterrupt(Board::keypadIrqPin), onKeypadIrq, FALLING);
+  }
+  lastActiveMs = millis();
+}
+
+/**
+ * @brief Whether the device is idle.
+ */
+bool isIdle() {
+  return idle;
+}
+
+/**
+ * @brief Wait for the next sensor scan.
+ */
+bool scanDue() {
+  if (idle) {
+    if (!keypadIrq && millis() - lastScanMs < IDLE_POLL_MS) {
+      sleepUntilInterrupt();
+      if (!keypadIrq && millis() - lastScanMs < IDLE_POLL_MS) return false;
+    }
+    lastScanMs = millis();
+  }
+  scanStartUs = micros();
+  return true;
+}
+
+/**
+ * @brief Report the outcome of a scan.
+ */
+void serviceIdle(bool active) {
+  unsigned long now = millis();
+  if (active) {
+    lastActiveMs = now;
+    if (idle) {
+      // Wake up: full scan rate and keypad sample period
+      idle = false;
+      noInterrupts();
+      wakeStartUs = keypadIrq ? keypadIrqUs : scanStartUs;
+      interrupts();
+      wakeTiming = true;
+      setKeypadSamplePeriod(KEYPAD_ESI);
+    }
+  } else if (!idle && now - lastActiveMs >= IDLE_TIMEOUT_MS) {
+    // Go idle: slow keypad sampling, scans every IDLE_POLL_MS
+    idle = true;
+    wakeTiming = false;
+    lastScanMs = now;
+    setKeypadSamplePeriod(IDLE_KEYPAD_ESI);
+  }
+  keypadIrq = false;  // Touch status was read by this scan
+}
+
+/**
+ * @brief Report a note on.
+ */
+void notePlayed() {
+  if (!wakeTiming) return;
+  wakeLatencyUs = micros() - wakeStartUs;
+  wakeTiming = false;
+}
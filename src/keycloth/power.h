@@ -0,0 +1,96 @@
+#ifndef POWER_H
+#define POWER_H
+
+/* power.h - Idle power-down governor
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+
+/**
+ * @def IDLE_TIMEOUT_MS
+ * @brief Time without activity before the device goes idle.
+ */
+#define IDLE_TIMEOUT_MS 30000UL
+
+/**
+ * @def IDLE_POLL_MS
+ * @brief Time between sensor scans while idle.
+ *
+ * Together with the idle keypad sample period this bounds the wake-to-note
+ * latency (a keypad IRQ, if wired, cuts it short).
+ */
+#define IDLE_POLL_MS 16
+
+/**
+ * @def KEYPAD_ESI
+ * @brief MPR121 electrode sample interval while awake (2^ESI ms, 1ms).
+ */
+#define KEYPAD_ESI 0
+
+/**
+ * @def IDLE_KEYPAD_ESI
+ * @brief MPR121 electrode sample interval while idle (2^ESI ms, 8ms).
+ */
+#define IDLE_KEYPAD_ESI 3
+
+/**
+ * @brief Wake latency of the last wake-up (µs).
+ *
+ * Measured from the keypad IRQ (or the idle scan that noticed the activity)
+ * to the first note on after it, so it includes VOICE_ATTACK_MS. Wake-ups
+ * without a note leave it unchanged.
+ */
+extern uint32_t wakeLatencyUs;
+
+/**
+ * @brief Setup the idle governor (attaches the keypad IRQ if the board has one).
+ */
+void setupPower();
+
+/**
+ * @brief Whether the device is idle.
+ */
+bool isIdle();
+
+/**
+ * @brief Wait for the next sensor scan.
+ *
+ * Returns true at once while awake. While idle, sleeps the CPU until the
+ * next interrupt and returns true only when an idle scan is due or the
+ * keypad IRQ fired. MIDI and the arpeggiator keep running in between, as
+ * the timer and USB interrupts wake the CPU.
+ */
+bool scanDue();
+
+/**
+ * @brief Report the outcome of a scan.
+ *
+ * Goes idle after IDLE_TIMEOUT_MS without activity and wakes on activity.
+ *
+ * @active: Whether anything is touched, deflected or sounding.
+ */
+void serviceIdle(bool active);
+
+/**
+ * @brief Report a note on (ends the wake latency measurement).
+ */
+void notePlayed();
+
+#endif
@@ -0,0 +1,108 @@
+/* sampler.cpp - Implementation of interrupt-driven analog sampling
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sampler.h"
+#include "board.h"
+#include "MIDIUSB_Ring.h"
+#include <Arduino.h>
+#include <avr/interrupt.h>
+
+uint16_t sampled[NUM_SAMPLED];
+
+/**
+ * @brief ISR -> loop sample queue (one full sweep always fits).
+ */
+static SPSCRing<AdcSample, 8> samples;
+
+/**
+ * @brief ADC multiplexer channel per sample slot.
+ */
+static uint8_t muxChannel[NUM_SAMPLED];
+
+static volatile uint8_t sweepSlot = 0;
+static volatile bool sweepBusy = false;
+
+/**
+ * @brief Map an Arduino analog pin to its ADC multiplexer channel.
+ */
+static uint8_t pinToChannel(int pin) {
+  if (pin >= A0) pin -= A0;
+#if defined(analogPinToChannel)
+  return analogPinToChannel(pin);
+#else
+  return pin;
+#endif
+}
+
+/**
+ * @brief Select the slot's input (AVcc reference) and start its conversion.
+ */
+static inline void startConversion(uint8_t slot) {
+  uint8_t ch = muxChannel[slot];
+#if defined(MUX5)
+  ADCSRB = (ADCSRB & ~_BV(MUX5)) | (((ch >> 3) & 0x01) << MUX5);
+#endif
+  ADMUX = _BV(REFS0) | (ch & 0x07);
+  ADCSRA |= _BV(ADSC);
+}
+
+ISR(ADC_vect) {
+  AdcSample s = {sweepSlot, ADC};
+  samples.push(s);
+  uint8_t next = sweepSlot + 1;
+  if (next < NUM_SAMPLED) {
+    sweepSlot = next;
+    startConversion(next);
+  } else {
+    sweepBusy = false;
+  }
+}
+
+/**
+ * @brief Setup interrupt-driven sampling of the bend and stretch pins.
+ */
+void setupSampler() {
+  for (int i = 0; i < NUM_BEND; i++) {
+    pinMode(Board::BendPins::at(i), INPUT);
+    muxChannel[i] = pinToChannel(Board::BendPins::at(i));
+    sampled[i] = analogRead(Board::BendPins::at(i));
+  }
+  pinMode(Board::stretchPin, INPUT);
+  muxChannel[STRETCH_SLOT] = pinToChannel(Board::stretchPin);
+  sampled[STRETCH_SLOT] = analogRead(Board::stretchPin);
+
+  // Enable the conversion complete interrupt (prescaler 128 as set by the core)
+  ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+/**
+ * @brief Collect the samples converted since the last call and start the next sweep.
+ */
+void drainSamples() {
+  AdcSample s;
+  while (samples.pop(s)) {
+    sampled[s.slot] = s.value;
+  }
+  if (!sweepBusy) {
+    sweepSlot = 0;
+    sweepBusy = true;
+    startConversion(0);
+  }
+}
@@ -0,0 +1,70 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+/* sampler.h - Interrupt-driven analog sampling
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include "bend.h"
+
+/**
+ * @def NUM_SAMPLED
+ * @brief Number of sampled analog inputs (bend sensors + stretch sensor).
+ */
+#define NUM_SAMPLED (NUM_BEND + 1)
+
+/**
+ * @def STRETCH_SLOT
+ * @brief Sample slot of the stretch sensor (bend sensors use slots 0..NUM_BEND-1).
+ */
+#define STRETCH_SLOT NUM_BEND
+
+/**
+ * @brief Sample handed from the ADC interrupt to the main loop.
+ */
+struct AdcSample {
+    uint8_t slot; /**< Sample slot (index into sampled[]) */
+    uint16_t value; /**< Raw ADC code */
+};
+
+/**
+ * @brief Latest raw ADC code per sample slot.
+ *
+ * Only written by drainSamples(), so it can be read freely from the loop.
+ */
+extern uint16_t sampled[NUM_SAMPLED];
+
+/**
+ * @brief Setup interrupt-driven sampling of the bend and stretch pins.
+ *
+ * Sets up the pins and takes a first reading of every slot. Afterwards
+ * analogRead() must no longer be used, as it would race the ADC interrupt.
+ */
+void setupSampler();
+
+/**
+ * @brief Collect the samples converted since the last call and start the next sweep.
+ *
+ * A sweep converts every slot once in the background, so the ADC runs
+ * while the loop is busy with I2C and MIDI instead of blocking in analogRead().
+ */
+void drainSamples();
+
+#endif
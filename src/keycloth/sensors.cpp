@@ -0,0 +1,210 @@
+/* sensors.cpp - Implementation of the sensor channel pipeline
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sensors.h"
+#include "board.h"
+#include "utils.h"
+#include "sampler.h"
+#include "gesture.h"
+#include "keys.h"
+#include <Arduino.h>
+
+/**
+ * @brief Stage configuration per channel.
+ *
+ * To add a sensor, give it a sampler slot or electrode and a row here.
+ */
+SensorConfig sensorConfig[NUM_SENSORS] = {
+  // acquire, source, convert, filter, map, emit, param, limit, restR
+  {ACQUIRE_ADC, RIGHT, CONVERT_DIVIDER, FILTER_SMOOTH, MAP_RANGE, EMIT_CC, 1, MAXR, INIT_MAXR},
+  {ACQUIRE_ADC, LEFT, CONVERT_DIVIDER, FILTER_SMOOTH, MAP_RANGE, EMIT_CC, 1, MAXR, INIT_MAXR},
+  {ACQUIRE_ADC, MIDDLE, CONVERT_DIVIDER, FILTER_SMOOTH, MAP_RANGE, EMIT_GESTURE, GESTURE_CRUMPLE, MAXR, INIT_MAXR},
+  {ACQUIRE_ADC, STRETCH_SLOT, CONVERT_DIVIDER, FILTER_NONE, MAP_RANGE, EMIT_GESTURE, GESTURE_STRETCH, 0xFFFF, 0},
+};
+
+SensorChannels sensors;
+
+/**
+ * @brief Range the mapping was last computed for, and its scale (16.16).
+ *
+ * Only refreshed when minR/maxR moved by more than MAPPING_EPSILON, so
+ * mapping a sample is a subtraction and a multiplication.
+ */
+static uint16_t mapLow[NUM_SENSORS], mapHigh[NUM_SENSORS];
+static uint32_t mapScale[NUM_SENSORS];
+
+/**
+ * @brief Acquire stage.
+ */
+static void acquire() {
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    const SensorConfig &c = sensorConfig[i];
+    sensors.raw[i] = c.acquire == ACQUIRE_CAP ? readElectrode(c.source) : sampled[c.source];
+  }
+}
+
+/**
+ * @brief Convert stage.
+ */
+static void convert() {
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    const SensorConfig &c = sensorConfig[i];
+    uint32_t r = c.convert == CONVERT_DIVIDER ? rawToOhms<Board>(sensors.raw[i]) : sensors.raw[i];
+    sensors.R[i] = r < c.limit ? r : c.limit;
+  }
+}
+
+static uint16_t spikeR[NUM_SENSORS]; // Reading held back as a spike
+static uint16_t spiking = 0;         // Bit i set while channel i holds one back
+
+/**
+ * @brief Smooth a value, ignoring spikes and tiny fluctuations.
+ *
+ * A jump of SPIKE_THRESHOLD or more is held back for one sample. If the
+ * next reading agrees with it, the jump was a real step and the output
+ * follows it at once, so it cannot stay behind for good.
+ *
+ * @i: Sensor channel.
+ */
+static uint16_t smooth(uint8_t i, uint16_t r, uint16_t prev) {
+  int32_t d = (int32_t)r - prev;
+  if (d <= -SPIKE_THRESHOLD || d >= SPIKE_THRESHOLD) {
+    int32_t e = (int32_t)r - spikeR[i];
+    if ((spiking & _BV(i)) && e > -SPIKE_THRESHOLD && e < SPIKE_THRESHOLD) {
+      spiking &= ~_BV(i);
+      return r;
+    }
+    spiking |= _BV(i);
+    spikeR[i] = r;
+    return prev;
+  }
+  spiking &= ~_BV(i);
+  if (d >= -DEAD_ZONE && d <= DEAD_ZONE) return prev;
+  return prev + (int16_t)(d * SMOOTH_ALPHA / 256);
+}
+
+/**
+ * @brief Filter stage.
+ */
+static void filter() {
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    sensors.out[i] = sensorConfig[i].filter == FILTER_SMOOTH
+        ? smooth(i, sensors.R[i], sensors.out[i]) : sensors.R[i];
+  }
+}
+
+/**
+ * @brief Move a 16.16 value toward a target by 2^-shift of the distance.
+ */
+static inline void approach(uint32_t &v, uint32_t target, uint8_t shift) {
+  if (target > v) v += (target - v) >> shift;
+  else v -= (v - target) >> shift;
+}
+
+/**
+ * @brief Track the rest baseline of a channel.
+ *
+ * Exponential moving average of the filtered output, frozen while
+ * deflected (below 85% of the baseline).
+ */
+static void updateBaseline(uint8_t i) {
+  uint16_t base = sensors.baseline[i] >> 16;
+  if ((uint32_t)sensors.out[i] * 20 >= (uint32_t)base * 17) {
+    approach(sensors.baseline[i], sensorQ(sensors.out[i]), CALIBRATION_SHIFT);
+    sensors.deflected &= ~_BV(i);
+  } else {
+    sensors.deflected |= _BV(i);
+  }
+}
+
+/**
+ * @brief Adapt the range of a channel.
+ *
+ * New extremes widen the range at once. Otherwise maxR relaxes toward the
+ * baseline and, while deflected, minR relaxes toward the current value, so
+ * a single extreme reading does not compress the range for good.
+ */
+static void updateRange(uint8_t i) {
+  uint32_t r = sensorQ(sensors.R[i]);
+  if (r < sensors.minR[i]) sensors.minR[i] = r;
+  else if (sensors.deflected & _BV(i)) approach(sensors.minR[i], r, RANGE_DECAY_SHIFT);
+  if (r > sensors.maxR[i]) sensors.maxR[i] = r;
+  else approach(sensors.maxR[i], sensors.baseline[i], RANGE_DECAY_SHIFT);
+
+  uint16_t low = sensors.minR[i] >> 16;
+  uint16_t high = sensors.maxR[i] >> 16;
+  if (high < low + MIN_RANGE) {
+    low = high > MIN_RANGE ? high - MIN_RANGE : 0;
+    sensors.minR[i] = sensorQ(low);
+  }
+
+  // Refresh the mapping only when the range moved noticeably
+  if (abs((int32_t)low - mapLow[i]) > MAPPING_EPSILON || abs((int32_t)high - mapHigh[i]) > MAPPING_EPSILON) {
+    mapLow[i] = low;
+    mapHigh[i] = high > low ? high : low + 1;
+    mapScale[i] = (127UL << 16) / (mapHigh[i] - mapLow[i]);
+  }
+}
+
+/**
+ * @brief Map stage.
+ */
+static void mapValues() {
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    if (sensorConfig[i].map != MAP_RANGE) continue;
+    updateBaseline(i);
+    updateRange(i);
+    // Reverse mapping: highest value (rest) = 0, lowest value (deflected) = 127
+    uint16_t r = sensors.R[i];
+    if (r >= mapHigh[i]) sensors.value[i] = 0;
+    else if (r <= mapLow[i]) sensors.value[i] = 127;
+    else sensors.value[i] = ((uint32_t)(mapHigh[i] - r) * mapScale[i]) >> 16;
+  }
+}
+
+/**
+ * @brief Setup the sensor channels from their first readings.
+ */
+void setupSensors() {
+  acquire();
+  convert();
+  for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+    const SensorConfig &c = sensorConfig[i];
+    sensors.out[i] = sensors.R[i];
+    // The device might be initialized with deflected sensors,
+    // so the baseline starts at least at the rest value
+    // (it is calibrated at runtime)
+    sensors.baseline[i] = sensorQ(sensors.R[i] > c.restR ? sensors.R[i] : c.restR);
+    sensors.minR[i] = sensorQ(c.limit);
+    sensors.maxR[i] = sensorQ(c.restR);
+  }
+  sensors.deflected = 0;
+  spiking = 0;
+}
+
+/**
+ * @brief Run every channel through acquire, convert, filter and map.
+ */
+void readSensors() {
+  acquire();
+  convert();
+  filter();
+  mapValues();
+}
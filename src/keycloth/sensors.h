@@ -0,0 +1,136 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+
+/* sensors.h - Uniform sensor channel pipeline
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include "bend.h"
+#include "stretch.h"
+#include "tuning.h"
+
+/**
+ * @def NUM_SENSORS
+ * @brief Number of sensor channels (bend sensors 0..NUM_BEND-1, then the stretch sensor S).
+ */
+#define NUM_SENSORS (NUM_BEND + 1)
+
+/**
+ * Acquire stage: where a channel's raw value comes from
+ */
+#define ACQUIRE_ADC 0 /**< Sampler slot (resistive sensor in a voltage divider) */
+#define ACQUIRE_CAP 1 /**< Filtered data of an MPR121 electrode (capacitive sensor) */
+
+/**
+ * Convert stage
+ */
+#define CONVERT_NONE 0    /**< Use the raw value */
+#define CONVERT_DIVIDER 1 /**< Voltage divider code to resistance (Ω) */
+
+/**
+ * Filter stage
+ */
+#define FILTER_NONE 0   /**< Pass through */
+#define FILTER_SMOOTH 1 /**< Spike rejection, dead zone and exponential smoothing */
+
+/**
+ * Map stage
+ */
+#define MAP_NONE 0  /**< No mapped value */
+#define MAP_RANGE 1 /**< Adaptive baseline and range, rest = 0, full deflection = 127 */
+
+/**
+ * Emit stage: how the MIDI layer uses the channel
+ */
+#define EMIT_NONE 0    /**< Not sent */
+#define EMIT_CC 1      /**< Mapped value as control change, param = controller */
+#define EMIT_GESTURE 2 /**< Converted value drives a gesture, param = gesture index */
+
+#define CALIBRATION_SHIFT 7   // Baseline EMA factor 2^-7 (~0.01)
+#define RANGE_DECAY_SHIFT 12  // Per-sample relaxation of minR/maxR 2^-12 (~0.0002)
+#define MIN_RANGE 50          // Smallest maxR - minR span (Ω)
+#define MAPPING_EPSILON 2     // Range drift (Ω) before the mapping is refreshed
+
+/**
+ * @brief Stage configuration of one sensor channel.
+ */
+struct SensorConfig {
+    uint8_t acquire; /**< ACQUIRE_* */
+    uint8_t source; /**< Sampler slot or electrode */
+    uint8_t convert; /**< CONVERT_* */
+    uint8_t filter; /**< FILTER_* */
+    uint8_t map; /**< MAP_* */
+    uint8_t emit; /**< EMIT_* */
+    uint8_t param; /**< Controller number or gesture index */
+    uint16_t limit; /**< Converted values are clamped to this */
+    uint16_t restR; /**< Lowest plausible rest value (initial baseline and maxR) */
+};
+
+/**
+ * @brief Stage configuration per channel, indexed like SensorChannels.
+ *
+ * Writable so parameters (e.g. CC numbers) can be changed live.
+ */
+extern SensorConfig sensorConfig[NUM_SENSORS];
+
+/**
+ * @brief Sensor channel data, one array per pipeline stage.
+ *
+ * Baselines and ranges are 16.16 fixed point so slow averages keep their
+ * fraction; use sensorQ() to convert a whole value.
+ */
+struct SensorChannels {
+    uint16_t raw[NUM_SENSORS]; /**< Acquired values */
+    uint16_t R[NUM_SENSORS]; /**< Converted values (Ω for dividers) */
+    uint16_t out[NUM_SENSORS]; /**< Filtered values */
+    uint8_t value[NUM_SENSORS]; /**< Mapped values (0..127) */
+    uint32_t baseline[NUM_SENSORS]; /**< Rest state value (16.16) */
+    uint32_t minR[NUM_SENSORS]; /**< Minimum read value (16.16) */
+    uint32_t maxR[NUM_SENSORS]; /**< Maximum read value (16.16) */
+    uint16_t deflected; /**< Bit i set while channel i is away from rest (baseline frozen) */
+};
+
+static_assert(NUM_SENSORS <= 16, "SensorChannels::deflected holds 16 channels");
+
+/**
+ * @brief Sensor channel data.
+ */
+extern SensorChannels sensors;
+
+/**
+ * @brief Convert a whole value to 16.16 fixed point.
+ */
+inline uint32_t sensorQ(uint16_t v) { return (uint32_t)v << 16; }
+
+/**
+ * @brief Setup the sensor channels from their first readings.
+ *
+ * Must be called after setupSampler().
+ */
+void setupSensors();
+
+/**
+ * @brief Run every channel through acquire, convert, filter and map.
+ *
+ * Each stage runs over all channels before the next one starts.
+ */
+void readSensors();
+
+#endif
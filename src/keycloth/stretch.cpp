@@ -1,44 +1,121 @@
-/* stretch.cpp - Implementation of stretch sensor functionality
+/* stretch.cpp - Implementation of the stretch expression
 
    Copyright (C) 2025 Alexia Pagkopoulou
 
     This file is part of KeyCloth.
 
-    KeyCloth is free software: you can redistribute it and/or modify it 
-    under the terms of the GNU General Public License as published by the 
-    Free Software Foundation, either version 3 of the License, or (at your 
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
     option) any later version.
 
-    KeyCloth is distributed in the hope that it will be useful, but WITHOUT 
-    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or 
-    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for 
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
     more details.
 
-    You should have received a copy of the GNU General Public License along 
-    with KeyCloth. If not, see <https://www.gnu.org/licenses/>. 
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
 */
 
-#include "pins.h"
 #include "stretch.h"
-#include "utils.h"
-#include <Arduino.h>
+#include "sensors.h"
+#include "midi.h"
 
-#define STRETCH 3
+static StretchState stretch;
 
 /**
- * @brief Setup the stretch sensor.
+ * @brief Filter a stretch reading and estimate its rate of change.
  */
-void setupStretch() {
-  // Set pin mode
-  pinMode(stretchPin, INPUT);
+void stepStretch(StretchState &s, uint16_t r, uint16_t low, uint16_t high, uint16_t nowMs) {
+  uint32_t target = (uint32_t)r << STRETCH_FRAC_BITS;
+  if (!s.level) {
+    // First reading
+    s.level = target;
+    s.rateLevel = target;
+    s.rateMs = nowMs;
+    return;
+  }
+  // Rounded away from the level, so it settles on the target exactly
+  if (target > s.level) s.level += (target - s.level + (1 << STRETCH_FILTER_SHIFT) - 1) >> STRETCH_FILTER_SHIFT;
+  else s.level -= (s.level - target + (1 << STRETCH_FILTER_SHIFT) - 1) >> STRETCH_FILTER_SHIFT;
+
+  // Derivative of the filtered level over STRETCH_RATE_MS, smoothed again (Ω/s)
+  uint16_t dt = nowMs - s.rateMs;
+  if (dt >= STRETCH_RATE_MS) {
+    int32_t d = ((int32_t)(s.level - s.rateLevel) * 1000 / dt) >> STRETCH_FRAC_BITS;
+    if (d > 32767) d = 32767;
+    if (d < -32767) d = -32767;
+    s.rate += (int16_t)((d - s.rate) / (1 << STRETCH_RATE_SHIFT));
+    s.rateLevel = s.level;
+    s.rateMs = nowMs;
+  }
+
+  // Resistance drops while stretched: rest (high) = 0, full stretch (low) = 16383
+  uint16_t level = s.level >> STRETCH_FRAC_BITS;
+  if (level >= high || high <= low) s.amount = 0;
+  else if (level <= low) s.amount = 16383;
+  else s.amount = (uint32_t)(high - level) * 16383 / (high - low);
+}
+
+/**
+ * @brief Rest value of an output.
+ */
+static uint16_t restValue(uint8_t output) {
+  return output == STRETCH_OUT_PITCHBEND ? STRETCH_BEND_CENTER : 0;
+}
+
+/**
+ * @brief Value of the selected output and source.
+ */
+uint16_t stretchValue(const StretchState &s) {
+  bool bend = stretchOutput == STRETCH_OUT_PITCHBEND;
+  if (stretchSource == STRETCH_SRC_AMOUNT) {
+    // Stretching bends up from the center
+    return bend ? STRETCH_BEND_CENTER + (s.amount >> 1) : s.amount >> 7;
+  }
+  // Still below the dead zone, which also covers where the rate EMA stalls
+  int16_t still = (stretchRateFull >> STRETCH_RATE_DEAD_SHIFT) | ((1 << STRETCH_RATE_SHIFT) - 1);
+  if (s.rate >= -still && s.rate <= still) return restValue(stretchOutput);
+  int32_t v = -(int32_t)s.rate * STRETCH_BEND_CENTER / (stretchRateFull ? stretchRateFull : 1);
+  if (v > STRETCH_BEND_CENTER - 1) v = STRETCH_BEND_CENTER - 1;
+  if (v < -STRETCH_BEND_CENTER) v = -STRETCH_BEND_CENTER;
+  if (bend) return STRETCH_BEND_CENTER + v;  // Stretching bends up, releasing down
+  v = (v < 0 ? -v : v) >> 6;  // Speed in either direction
+  return v > 127 ? 127 : v;
+}
+
+/**
+ * @brief Send a value to an output.
+ */
+static void sendStretch(uint8_t output, uint16_t value) {
+  switch (output) {
+    case STRETCH_OUT_CC: sendCC(stretchCC, value); break;
+    case STRETCH_OUT_PITCHBEND: sendPitchBend(value); break;
+    case STRETCH_OUT_PRESSURE: sendChannelPressure(value); break;
+  }
 }
 
 /**
- * @brief Read from the sensor.
+ * @brief Run the stretch expression on the stretch channel and send its output.
  */
-void readStretch() {
-  // Read analog
-  sInfo[RAW_I] = analogRead(stretchPin);
-  sInfo[VOUT_I] = calcVout(sensorVin, sInfo[RAW_I]);
-  sInfo[R_I] = determineRes(sensorVin, sInfo[VOUT_I], R0);
+void serviceStretch(uint16_t nowMs) {
+  if (stretch.output != stretchOutput) {
+    if (stretch.sent != restValue(stretch.output)) sendStretch(stretch.output, restValue(stretch.output));
+    stretch.output = stretchOutput;
+    stretch.sent = restValue(stretchOutput);
+  }
+  if (stretchOutput == STRETCH_OUT_NONE) return;
+
+  stepStretch(stretch, sensors.R[S], sensors.minR[S] >> 16, sensors.maxR[S] >> 16, nowMs);
+
+  uint16_t value = stretchValue(stretch);
+  uint16_t rest = restValue(stretchOutput);
+  int32_t d = (int32_t)value - stretch.sent;
+  int16_t delta = stretchOutput == STRETCH_OUT_PITCHBEND ? STRETCH_BEND_DELTA : STRETCH_CC_DELTA;
+  // Rest is always reached exactly, other values need a noticeable change
+  if (d <= -delta || d >= delta || (value == rest && stretch.sent != rest)) {
+    sendStretch(stretchOutput, value);
+    stretch.sent = value;
+  }
 }
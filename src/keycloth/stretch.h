@@ -21,64 +21,101 @@
     with KeyCloth. If not, see <https://www.gnu.org/licenses/>. 
 */
 
-#define S 3
+#include "bend.h"
 
 /**
- * @def RAW_I
- * @brief Stretch sensor read value index for raw value.
+ * @def S
+ * @brief Sensor channel of the stretch sensor (after the bend sensors).
  */
-#define RAW_I 0
+#define S NUM_BEND
+
 /**
- * @def VOUT_I
- * @brief Stretch sensor read value index for Vout.
+ * Stretch expression outputs
  */
-#define VOUT_I 1
+#define STRETCH_OUT_NONE 0      /**< Expression not sent */
+#define STRETCH_OUT_CC 1        /**< Control change, controller stretchCC */
+#define STRETCH_OUT_PITCHBEND 2 /**< Pitch bend (14 bit) */
+#define STRETCH_OUT_PRESSURE 3  /**< Channel pressure */
+
 /**
- * @def R_I
- * @brief Stretch sensor read value index for R.
+ * Stretch expression sources
  */
-#define R_I 3
+#define STRETCH_SRC_AMOUNT 0 /**< How far the sensor is stretched */
+#define STRETCH_SRC_RATE 1   /**< How fast it is stretched or released */
+
+#define STRETCH_FILTER_SHIFT 2 // Level EMA factor 2^-2 (0.25)
+#define STRETCH_RATE_MS 16     // Shortest time the rate is measured over (steps of noise cancel out)
+#define STRETCH_RATE_SHIFT 2   // Rate EMA factor 2^-2 (0.25)
+#define STRETCH_RATE_DEAD_SHIFT 3 // Rates up to stretchRateFull / 2^3 count as still
+#define STRETCH_FRAC_BITS 4    // Fraction bits of the filtered level
+#define STRETCH_CC_DELTA 2     // Smallest 7-bit change that is sent
+#define STRETCH_BEND_DELTA 64  // Smallest pitch bend change that is sent
+#define STRETCH_BEND_CENTER 8192
 
 /**
- * @def NUM_STRETCH_DATA
- * @brief Number of stretch sensor relevant data.
+ * @brief Expression output (STRETCH_OUT_*).
  */
-#define NUM_STRETCH_DATA 3
+extern uint8_t stretchOutput;
 
 /**
- * @brief Stretch sensor read information.
- * 
- * Float array containing relevant information. 
- *          [RAW_I]: raw read value
- *          [VOUT_I]: Vout
- *          [R_I]: R
+ * @brief Expression source (STRETCH_SRC_*).
  */
-extern float sInfo[NUM_STRETCH_DATA];
+extern uint8_t stretchSource;
 
 /**
- * @brief Input voltage for sensor pin(s).
- *
- * This is the input voltage applied to the sensor circuit(s).
- * It should be set according to the used voltage pin (e.g., 3.3V).
+ * @brief Controller number of STRETCH_OUT_CC.
  */
-extern float sensorVin;
+extern uint8_t stretchCC;
 
 /**
- * @brief Reference resistance for determining sensor resistance.
+ * @brief Rate (Ω/s) that gives full scale with STRETCH_SRC_RATE.
+ */
+extern uint16_t stretchRateFull;
+
+/**
+ * @brief Filter and derivative state of the stretch expression.
+ */
+struct StretchState {
+    uint32_t level; /**< Filtered resistance, STRETCH_FRAC_BITS fraction bits */
+    int16_t rate; /**< Smoothed change of the level (Ω/s, negative while stretching) */
+    uint16_t amount; /**< Stretch amount in the channel's range, 0 (rest) to 16383 */
+    uint32_t rateLevel; /**< Level at the start of the rate measurement */
+    uint16_t rateMs; /**< Start of the rate measurement */
+    uint8_t output; /**< Output the last value was sent to */
+    uint16_t sent; /**< Last sent value (7 or 14 bit) */
+};
+
+/**
+ * @brief Filter a stretch reading and estimate its rate of change.
  *
- * This value represents the known resistance (R0) of the voltage divider
- * used to determine the sensor resistance. 
+ * Integer only, one division each for the amount and the rate.
+ *
+ * @s: Expression state.
+ * @r: Converted reading (Ω).
+ * @low: Reading at full stretch.
+ * @high: Reading at rest.
+ * @nowMs: Current time (ms, wraps).
  */
-extern float R0;
+void stepStretch(StretchState &s, uint16_t r, uint16_t low, uint16_t high, uint16_t nowMs);
 
 /**
- * @brief Setup the stretch sensor.
+ * @brief Value of the selected output and source.
+ *
+ * 14 bit (center 8192) for STRETCH_OUT_PITCHBEND, 7 bit otherwise.
+ *
+ * @s: Expression state.
  */
-void setupStretch();
+uint16_t stretchValue(const StretchState &s);
 
 /**
- * @brief Read from the sensor.
+ * @brief Run the stretch expression on the stretch channel and send its output.
+ *
+ * Values are only sent when they moved by the output's change threshold,
+ * or when they return to rest. Changing stretchOutput returns the previous
+ * output to rest first.
+ *
+ * @nowMs: Current time (ms, wraps).
  */
-void readStretch();
+void serviceStretch(uint16_t nowMs);
 
 #endif
@@ -0,0 +1,164 @@
+/* sysex.cpp - Implementation of the SysEx configuration protocol
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sysex.h"
+#include "params.h"
+#include "midi.h"
+#include "capture.h"
+#include <Adafruit_BusTrace.h>
+
+/**
+ * @def SYSEX_HEADER
+ * @brief Bytes before the payload (F0, id, device, command).
+ */
+#define SYSEX_HEADER 4
+
+/**
+ * @def SYSEX_REPLY_MAX
+ * @brief Longest reply (a trace entry).
+ */
+#define SYSEX_REPLY_MAX 28
+
+/**
+ * @brief Append a 16-bit value as three 7-bit bytes.
+ */
+static uint8_t *putValue(uint8_t *p, int16_t value) {
+  uint16_t v = value;
+  *p++ = v & 0x7F;
+  *p++ = (v >> 7) & 0x7F;
+  *p++ = v >> 14;
+  return p;
+}
+
+/**
+ * @brief Read a 16-bit value from three 7-bit bytes.
+ */
+static int16_t getValue(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 7) | ((uint16_t)p[2] << 14));
+}
+
+/**
+ * @brief Append 8-bit bytes as groups of a high-bit byte and seven 7-bit bytes.
+ */
+static uint8_t *putBytes(uint8_t *p, const uint8_t *data, uint8_t len) {
+  for (uint8_t i = 0; i < len; i += 7) {
+    uint8_t *high = p++;
+    *high = 0;
+    for (uint8_t j = 0; j < 7 && i + j < len; j++) {
+      if (data[i + j] & 0x80) *high |= 1 << j;
+      *p++ = data[i + j] & 0x7F;
+    }
+  }
+  return p;
+}
+
+/**
+ * @brief Queue a reply: header, command | SYSEX_REPLY, payload, F7.
+ */
+static void reply(uint8_t command, const uint8_t *payload, uint8_t len) {
+  uint8_t msg[SYSEX_REPLY_MAX];
+  uint8_t n = 0;
+  msg[n++] = 0xF0;
+  msg[n++] = SYSEX_ID;
+  msg[n++] = SYSEX_DEVICE;
+  msg[n++] = command;
+  for (uint8_t i = 0; i < len; i++) msg[n++] = payload[i];
+  msg[n++] = 0xF7;
+  sendSysEx(msg, n);
+}
+
+/**
+ * @brief Queue an error reply.
+ */
+static void replyError(uint8_t command, uint8_t error) {
+  uint8_t payload[2] = {command, error};
+  reply(SYSEX_ERROR, payload, 2);
+}
+
+/**
+ * @brief Handle an incoming SysEx message and queue the reply.
+ */
+void handleSysEx(const uint8_t *msg, uint8_t len) {
+  if (len < SYSEX_HEADER + 1 || msg[1] != SYSEX_ID || msg[2] != SYSEX_DEVICE) return;
+  uint8_t command = msg[3];
+  const uint8_t *payload = msg + SYSEX_HEADER;
+  uint8_t payloadLen = len - SYSEX_HEADER - 1;  // Without F7
+
+  uint8_t out[SYSEX_REPLY_MAX - SYSEX_HEADER - 1];
+  uint8_t *p = out;
+  ParamInfo info;
+  switch (command) {
+    case SYSEX_GET:
+    case SYSEX_DESCRIBE:
+      if (payloadLen != 1) return replyError(command, SYSEX_ERR_LENGTH);
+      if (!paramInfo(payload[0], info)) return replyError(command, SYSEX_ERR_PARAM);
+      *p++ = payload[0];
+      if (command == SYSEX_GET) {
+        p = putValue(p, getParam(payload[0]));
+      } else {
+        *p++ = info.type;
+        p = putValue(p, info.min);
+        p = putValue(p, info.max);
+      }
+      break;
+    case SYSEX_SET:
+      if (payloadLen != 4) return replyError(command, SYSEX_ERR_LENGTH);
+      if (!paramInfo(payload[0], info)) return replyError(command, SYSEX_ERR_PARAM);
+      *p++ = payload[0];
+      p = putValue(p, setParam(payload[0], getValue(payload + 1)));
+      break;
+    case SYSEX_SAVE:
+      saveParams();
+      break;
+    case SYSEX_RESET:
+      wipeParams();
+      break;
+    case SYSEX_TRACE:
+#ifdef BUSIO_HAS_TRACE
+      if (payloadLen == 0) {
+        BusTrace.clear();
+        BusTrace.enable(true);
+        break;
+      }
+      if (payloadLen != 1) return replyError(command, SYSEX_ERR_LENGTH);
+      BusTrace.enable(false);
+      *p++ = payload[0];
+      *p++ = BusTrace.count();
+      p = putValue(p, BusTrace.total());
+      {
+        uint8_t entry[BUSIO_TRACE_ENTRY_SIZE];
+        if (BusTrace.pack(payload[0], entry)) p = putBytes(p, entry, sizeof(entry));
+      }
+      break;
+#else
+      return replyError(command, SYSEX_ERR_COMMAND);
+#endif
+    case SYSEX_CAPTURE:
+      if (payloadLen != 1) return replyError(command, SYSEX_ERR_LENGTH);
+      setCapture(payload[0]);
+      *p++ = capturing();
+      *p++ = CAPTURE_ELECTRODES;
+      *p++ = NUM_SAMPLED;
+      break;
+    default:
+      return replyError(command, SYSEX_ERR_COMMAND);
+  }
+  reply(command | SYSEX_REPLY, out, p - out);
+}
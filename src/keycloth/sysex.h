@@ -0,0 +1,88 @@
+#ifndef SYSEX_H
+#define SYSEX_H
+
+/* sysex.h - SysEx configuration protocol
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+
+/**
+ * Message header: F0 SYSEX_ID SYSEX_DEVICE <command> <payload> F7
+ */
+#define SYSEX_ID 0x7D     /**< Non-commercial manufacturer id */
+#define SYSEX_DEVICE 0x4B /**< 'K' for KeyCloth */
+
+/**
+ * Commands (host to device)
+ */
+#define SYSEX_GET 0x01      /**< <id>: read a parameter */
+#define SYSEX_SET 0x02      /**< <id> <value>: write a parameter */
+#define SYSEX_SAVE 0x03     /**< Store all parameters in EEPROM */
+#define SYSEX_DESCRIBE 0x04 /**< <id>: type and range of a parameter */
+#define SYSEX_RESET 0x05    /**< Drop the stored parameters (defaults after a reset) */
+#define SYSEX_TRACE 0x06    /**< <index>: read a bus trace entry, no payload: resume tracing */
+#define SYSEX_CAPTURE 0x07  /**< <0|1>: stop or start streaming capture records */
+
+/**
+ * Replies (device to host) are the command | SYSEX_REPLY:
+ *   GET/SET:  <id> <value>
+ *   SAVE/RESET: no payload
+ *   DESCRIBE: <id> <type> <min> <max>
+ *   TRACE:    <index> <count> <total> <entry>, entry only if index < count;
+ *             no payload when resuming
+ *   CAPTURE:  <enabled> <electrodes> <sampled inputs>
+ * Errors are SYSEX_ERROR <command> <SYSEX_ERR_*>.
+ *
+ * Values are 16 bits (two's complement for signed types) sent as three
+ * 7-bit bytes, least significant first.
+ *
+ * Reading a trace entry pauses the BusIO trace, so the ring keeps the I2C
+ * transactions from before the first read (index 0 is the oldest). A trace
+ * entry is BUSIO_TRACE_ENTRY_SIZE bytes (see Adafruit_BusTrace::pack()) in
+ * groups of up to seven: one byte with the high bits (bit 0 = first byte),
+ * then the bytes' low seven bits. Resuming clears the trace.
+ */
+#define SYSEX_REPLY 0x40
+#define SYSEX_ERROR 0x7F
+
+/**
+ * While capturing, the records of full scans are sent unrequested as
+ * SYSEX_FRAME <seq> <record>... (see capture.h), seq counting messages.
+ * Values are unsigned varints of 6-bit groups, least significant first,
+ * with bit 6 set on all but the last byte; deltas are zigzag encoded (0,
+ * -1, 1, -2, ... as 0, 1, 2, 3, ...). Codes are packed from bit 0, the
+ * code of the lowest value index first.
+ */
+#define SYSEX_FRAME 0x20
+#define SYSEX_ERR_COMMAND 0x01 /**< Unknown command */
+#define SYSEX_ERR_LENGTH 0x02  /**< Wrong payload length */
+#define SYSEX_ERR_PARAM 0x03   /**< Unknown parameter id */
+
+/**
+ * @brief Handle an incoming SysEx message and queue the reply.
+ *
+ * Messages for other devices are ignored.
+ *
+ * @msg: Complete message, F0 to F7.
+ * @len: Message length.
+ */
+void handleSysEx(const uint8_t *msg, uint8_t len);
+
+#endif
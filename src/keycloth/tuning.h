@@ -0,0 +1,52 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+/* tuning.h - Signal thresholds and filter constants
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Defaults of the values tools/keycloth_tune.py searches on captured
+ * data. The tool rewrites the numbers of this file with --header, the
+ * live parameters among them can also be set over SysEx.
+ */
+
+/**
+ * @def TOUCH_THRESHOLD
+ * @brief Default sensitivity threshold for touch recognition (MPR121)
+ */
+#define TOUCH_THRESHOLD 12
+
+/**
+ * @def RELEASE_THRESHOLD
+ * @brief Default sensitivity threshold for release recognition (MPR121)
+ */
+#define RELEASE_THRESHOLD 6
+
+#define CRUMPLE_ENTER_R 100 // Crumple engages below this resistance (Ω)
+#define CRUMPLE_EXIT_R 130  // Crumple releases above this resistance (Ω)
+#define STRETCH_ENTER_R 100 // Stretch engages below this resistance (Ω)
+#define STRETCH_EXIT_R 250  // Stretch releases above this resistance (Ω)
+#define MIDDLE_THRESHOLD 70 // Resistance of a full velocity gesture (Ω)
+
+#define SMOOTH_ALPHA 77       // Smoothing factor in 1/256
+#define SPIKE_THRESHOLD 100   // Ignore sudden jumps at bending event (Ω)
+#define DEAD_ZONE 5           // Ignore tiny fluctuations (Ω)
+
+#endif
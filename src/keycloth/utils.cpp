@@ -22,11 +22,6 @@
     with KeyCloth. If not, see <https://www.gnu.org/licenses/>. 
 */
 
-/**
- * @brief Analog signal input resolution
- */
-int analogResolution = 1024;
-
 /**
  * @brief Calculate Vout from analog signal and fixed Vin.
  *
@@ -61,4 +56,18 @@ float avg(float values[], int size) {
       sum += values[i];
   }
   return sum / size;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief CRC-16/CCITT (poly 0x1021, init 0xFFFF) over a byte buffer.
+ */
+uint16_t crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
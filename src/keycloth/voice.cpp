@@ -0,0 +1,66 @@
+/* voice.cpp - Implementation of per-key note voices
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "voice.h"
+
+/**
+ * @brief Advance the voices with a new touch mask.
+ */
+void stepVoices(VoiceState &v, uint16_t touched, uint16_t nowMs, uint16_t &noteOn, uint16_t &noteOff) {
+  uint16_t rise = touched & ~v.touched;
+  uint16_t fall = v.touched & ~touched;
+  v.touched = touched;
+
+  // Idle -> attack pending
+  uint16_t attack = rise & ~v.sounding;
+  // Sounding -> release pending
+  uint16_t release = fall & v.sounding;
+  for (uint16_t started = attack | release; started; started &= started - 1) {
+    v.since[__builtin_ctz(started)] = nowMs;
+  }
+  v.attack = (v.attack & ~fall) | attack;  // Attack pending -> idle on a short glitch
+  v.release = (v.release & ~rise) | release;  // Release pending -> sounding on a bounce
+
+  // Pending transitions whose debounce time ran out
+  noteOn = 0;
+  noteOff = 0;
+  for (uint16_t pending = v.attack | v.release; pending; pending &= pending - 1) {
+    uint8_t i = __builtin_ctz(pending);
+    uint16_t elapsed = nowMs - v.since[i];
+    if (v.attack & _BV(i)) {
+      if (elapsed >= VOICE_ATTACK_MS) noteOn |= _BV(i);
+    } else if (elapsed >= VOICE_RELEASE_MS) {
+      noteOff |= _BV(i);
+    }
+  }
+  v.attack &= ~noteOn;
+  v.release &= ~noteOff;
+  v.sounding = (v.sounding | noteOn) & ~noteOff;
+}
+
+/**
+ * @brief Return all voices to idle.
+ */
+void resetVoices(VoiceState &v) {
+  v.touched = 0;
+  v.attack = 0;
+  v.sounding = 0;
+  v.release = 0;
+}
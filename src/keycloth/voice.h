@@ -0,0 +1,78 @@
+#ifndef VOICE_H
+#define VOICE_H
+
+/* voice.h - Per-key note voices
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+#include "keys.h"
+
+/**
+ * @def VOICE_ATTACK_MS
+ * @brief Time a touch must last before its note starts.
+ */
+#define VOICE_ATTACK_MS 4
+
+/**
+ * @def VOICE_RELEASE_MS
+ * @brief Time a release must last before its note stops.
+ *
+ * Together with VOICE_ATTACK_MS well below the 25ms half period of a
+ * 20 Hz trill.
+ */
+#define VOICE_RELEASE_MS 8
+
+/**
+ * @brief Voice state of all keys (bit i = key i).
+ *
+ * A key is idle, attack pending (attack), sounding (sounding) or
+ * release pending (sounding and release).
+ */
+struct VoiceState {
+    uint16_t touched; /**< Touch mask of the previous step */
+    uint16_t attack; /**< Touched, waiting for VOICE_ATTACK_MS */
+    uint16_t sounding; /**< Note on sent */
+    uint16_t release; /**< Released while sounding, waiting for VOICE_RELEASE_MS */
+    uint16_t since[NUM_KEYS]; /**< Start of the pending attack or release (ms) */
+};
+
+/**
+ * @brief Advance the voices with a new touch mask.
+ *
+ * Only keys with an edge or a pending transition are visited.
+ *
+ * @v: Voice state.
+ * @touched: Current touch mask.
+ * @nowMs: Current time (wrapping 16-bit milliseconds).
+ * @noteOn: Receives the keys whose note must start.
+ * @noteOff: Receives the keys whose note must stop.
+ */
+void stepVoices(VoiceState &v, uint16_t touched, uint16_t nowMs, uint16_t &noteOn, uint16_t &noteOff);
+
+/**
+ * @brief Return all voices to idle (after their notes were released).
+ *
+ * Keys that are still touched attack again.
+ *
+ * @v: Voice state.
+ */
+void resetVoices(VoiceState &v);
+
+#endif
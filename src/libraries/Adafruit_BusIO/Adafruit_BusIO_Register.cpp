@@ -1,4 +1,4 @@
-#include <Adafruit_BusIO_Register.h>
+#include <Adafruit_BusIO_RegisterT.h>
 
 #if !defined(SPI_INTERFACES_COUNT) ||                                          \
     (defined(SPI_INTERFACES_COUNT) && (SPI_INTERFACES_COUNT > 0))
@@ -116,37 +116,32 @@ Adafruit_BusIO_Register::Adafruit_BusIO_Register(
  * uncheckable)
  */
 bool Adafruit_BusIO_Register::write(uint8_t *buffer, uint8_t len) {
-  uint8_t addrbuffer[2] = {(uint8_t)(_address & 0xFF),
-                           (uint8_t)(_address >> 8)};
+  _cacheValid = false; // Raw data, write(uint32_t) sets the shadow itself
   if (_i2cdevice) {
-    return _i2cdevice->write(buffer, len, true, addrbuffer, _addrwidth);
+    return Adafruit_I2CTransport(_i2cdevice)
+        .writeRegister(_address, _addrwidth, buffer, len);
   }
   if (_spidevice) {
-    if (_spiregtype == ADDRESSED_OPCODE_BIT0_LOW_TO_WRITE) {
-      // very special case!
-      // pass the special opcode address which we set as the high byte of the
-      // regaddr
-      addrbuffer[0] =
-          (uint8_t)(_address >> 8) & ~0x01; // set bottom bit low to write
-      // the 'actual' reg addr is the second byte then
-      addrbuffer[1] = (uint8_t)(_address & 0xFF);
-      // the address appears to be a byte longer
-      return _spidevice->write(buffer, len, addrbuffer, _addrwidth + 1);
+    switch (_spiregtype) {
+    case ADDRBIT8_HIGH_TOREAD:
+      return Adafruit_SPITransport<ADDRBIT8_HIGH_TOREAD>(_spidevice)
+          .writeRegister(_address, _addrwidth, buffer, len);
+    case AD8_HIGH_TOREAD_AD7_HIGH_TOINC:
+      return Adafruit_SPITransport<AD8_HIGH_TOREAD_AD7_HIGH_TOINC>(_spidevice)
+          .writeRegister(_address, _addrwidth, buffer, len);
+    case ADDRBIT8_HIGH_TOWRITE:
+      return Adafruit_SPITransport<ADDRBIT8_HIGH_TOWRITE>(_spidevice)
+          .writeRegister(_address, _addrwidth, buffer, len);
+    case ADDRESSED_OPCODE_BIT0_LOW_TO_WRITE:
+      return Adafruit_SPITransport<ADDRESSED_OPCODE_BIT0_LOW_TO_WRITE>(
+                 _spidevice)
+          .writeRegister(_address, _addrwidth, buffer, len);
     }
-    if (_spiregtype == ADDRBIT8_HIGH_TOREAD) {
-      addrbuffer[0] &= ~0x80;
-    }
-    if (_spiregtype == ADDRBIT8_HIGH_TOWRITE) {
-      addrbuffer[0] |= 0x80;
-    }
-    if (_spiregtype == AD8_HIGH_TOREAD_AD7_HIGH_TOINC) {
-      addrbuffer[0] &= ~0x80;
-      addrbuffer[0] |= 0x40;
-    }
-    return _spidevice->write(buffer, len, addrbuffer, _addrwidth);
+    return false;
   }
   if (_genericdevice) {
-    return _genericdevice->writeRegister(addrbuffer, _addrwidth, buffer, len);
+    return Adafruit_GenericTransport(_genericdevice)
+        .writeRegister(_address, _addrwidth, buffer, len);
   }
   return false;
 }
@@ -177,7 +172,10 @@ bool Adafruit_BusIO_Register::write(uint32_t value, uint8_t numbytes) {
     }
     value >>= 8;
   }
-  return write(_buffer, numbytes);
+  bool ok = write(_buffer, numbytes);
+  // A partial write leaves the other bytes unknown
+  _cacheValid = ok && numbytes == _width;
+  return ok;
 }
 
 /*!
@@ -201,6 +199,10 @@ uint32_t Adafruit_BusIO_Register::read(void) {
     }
   }
 
+  if (_shadow) {
+    _cached = value;
+    _cacheValid = true;
+  }
   return value;
 }
 
@@ -210,6 +212,35 @@ uint32_t Adafruit_BusIO_Register::read(void) {
  */
 uint32_t Adafruit_BusIO_Register::readCached(void) { return _cached; }
 
+/*!
+ *    @brief  Read the register for a read-modify-write. In shadow mode this
+ *    is the cached value once it is known, with no bus access.
+ *    @return Returns 0xFFFFFFFF on failure, value otherwise
+ */
+uint32_t Adafruit_BusIO_Register::readShadow(void) {
+  if (_shadow && _cacheValid) {
+    return _cached;
+  }
+  return read(); // Seeds the shadow on success
+}
+
+/*!
+ *    @brief  Enable or disable write-through shadow mode. Only use it for
+ *    registers that nothing but the MCU changes: bitfield writes then update
+ *    the cached value and skip the bus read. Disabling drops the cache.
+ *    @param  enable True to shadow the register
+ */
+void Adafruit_BusIO_Register::setShadow(bool enable) {
+  _shadow = enable;
+  _cacheValid = false;
+}
+
+/*!
+ *    @brief  Forget the shadowed value, e.g. after the device reset or
+ *    changed the register itself. The next bitfield write reads it again.
+ */
+void Adafruit_BusIO_Register::invalidate(void) { _cacheValid = false; }
+
 /*!
    @brief Read a number of bytes from a register into a buffer
    @param buffer Buffer to read data into
@@ -217,37 +248,31 @@ uint32_t Adafruit_BusIO_Register::readCached(void) { return _cached; }
    @return true on successful read, otherwise false
 */
 bool Adafruit_BusIO_Register::read(uint8_t *buffer, uint8_t len) {
-  uint8_t addrbuffer[2] = {(uint8_t)(_address & 0xFF),
-                           (uint8_t)(_address >> 8)};
   if (_i2cdevice) {
-    return _i2cdevice->write_then_read(addrbuffer, _addrwidth, buffer, len);
+    return Adafruit_I2CTransport(_i2cdevice)
+        .readRegister(_address, _addrwidth, buffer, len);
   }
   if (_spidevice) {
-    if (_spiregtype == ADDRESSED_OPCODE_BIT0_LOW_TO_WRITE) {
-      // very special case!
-      // pass the special opcode address which we set as the high byte of the
-      // regaddr
-      addrbuffer[0] =
-          (uint8_t)(_address >> 8) | 0x01; // set bottom bit high to read
-      // the 'actual' reg addr is the second byte then
-      addrbuffer[1] = (uint8_t)(_address & 0xFF);
-      // the address appears to be a byte longer
-      return _spidevice->write_then_read(addrbuffer, _addrwidth + 1, buffer,
-                                         len);
+    switch (_spiregtype) {
+    case ADDRBIT8_HIGH_TOREAD:
+      return Adafruit_SPITransport<ADDRBIT8_HIGH_TOREAD>(_spidevice)
+          .readRegister(_address, _addrwidth, buffer, len);
+    case AD8_HIGH_TOREAD_AD7_HIGH_TOINC:
+      return Adafruit_SPITransport<AD8_HIGH_TOREAD_AD7_HIGH_TOINC>(_spidevice)
+          .readRegister(_address, _addrwidth, buffer, len);
+    case ADDRBIT8_HIGH_TOWRITE:
+      return Adafruit_SPITransport<ADDRBIT8_HIGH_TOWRITE>(_spidevice)
+          .readRegister(_address, _addrwidth, buffer, len);
+    case ADDRESSED_OPCODE_BIT0_LOW_TO_WRITE:
+      return Adafruit_SPITransport<ADDRESSED_OPCODE_BIT0_LOW_TO_WRITE>(
+                 _spidevice)
+          .readRegister(_address, _addrwidth, buffer, len);
     }
-    if (_spiregtype == ADDRBIT8_HIGH_TOREAD) {
-      addrbuffer[0] |= 0x80;
-    }
-    if (_spiregtype == ADDRBIT8_HIGH_TOWRITE) {
-      addrbuffer[0] &= ~0x80;
-    }
-    if (_spiregtype == AD8_HIGH_TOREAD_AD7_HIGH_TOINC) {
-      addrbuffer[0] |= 0x80 | 0x40;
-    }
-    return _spidevice->write_then_read(addrbuffer, _addrwidth, buffer, len);
+    return false;
   }
   if (_genericdevice) {
-    return _genericdevice->readRegister(addrbuffer, _addrwidth, buffer, len);
+    return Adafruit_GenericTransport(_genericdevice)
+        .readRegister(_address, _addrwidth, buffer, len);
   }
   return false;
 }
@@ -340,7 +365,7 @@ uint32_t Adafruit_BusIO_RegisterBits::read(void) {
  * uncheckable)
  */
 bool Adafruit_BusIO_RegisterBits::write(uint32_t data) {
-  uint32_t val = _register->read();
+  uint32_t val = _register->readShadow();
 
   // mask off the data before writing
   uint32_t mask = (1 << (_bits)) - 1;
@@ -371,6 +396,7 @@ void Adafruit_BusIO_Register::setWidth(uint8_t width) { _width = width; }
  */
 void Adafruit_BusIO_Register::setAddress(uint16_t address) {
   _address = address;
+  _cacheValid = false;
 }
 
 /*!
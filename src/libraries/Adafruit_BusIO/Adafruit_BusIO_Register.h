@@ -68,6 +68,7 @@ public:
   bool read(uint16_t *value);
   uint32_t read(void);
   uint32_t readCached(void);
+  uint32_t readShadow(void);
   bool write(uint8_t *buffer, uint8_t len);
   bool write(uint32_t value, uint8_t numbytes = 0);
 
@@ -77,6 +78,9 @@ public:
   void setAddress(uint16_t address);
   void setAddressWidth(uint16_t address_width);
 
+  void setShadow(bool enable);
+  void invalidate(void);
+
   void print(Stream *s = &Serial);
   void println(Stream *s = &Serial);
 
@@ -90,6 +94,8 @@ private:
   uint8_t _buffer[4]; // we won't support anything larger than uint32 for
                       // non-buffered read
   uint32_t _cached = 0;
+  bool _shadow = false;     // _cached mirrors the device register
+  bool _cacheValid = false; // _cached holds a read or fully written value
 };
 
 /*!
@@ -0,0 +1,363 @@
+#ifndef Adafruit_BusIO_RegisterT_h
+#define Adafruit_BusIO_RegisterT_h
+
+#include <Adafruit_BusIO_Register.h>
+
+#if !defined(SPI_INTERFACES_COUNT) ||                                          \
+    (defined(SPI_INTERFACES_COUNT) && (SPI_INTERFACES_COUNT > 0))
+
+/*
+ * Statically dispatched registers.
+ *
+ * Adafruit_BusIO_Register picks the bus at run time from three device
+ * pointers, the SPI address scheme from a stored enum and the width and byte
+ * order from members, on every access. Adafruit_BusIO_RegisterT takes the
+ * bus as a type parameter instead: a transport is any copyable type with
+ *
+ *   bool readRegister(uint16_t address, uint8_t address_width,
+ *                     uint8_t *buffer, size_t len);
+ *   bool writeRegister(uint16_t address, uint8_t address_width,
+ *                      const uint8_t *buffer, size_t len);
+ *
+ * and everything above the transport call is resolved by the compiler. A
+ * driver with its own bus code can pass itself (or a small wrapper) as the
+ * transport instead of going through Adafruit_GenericDevice's function
+ * pointers. Adafruit_BusIO_Register uses the transports below, so both
+ * layers share the address handling.
+ */
+
+/*!
+ * @brief Transport for registers on an Adafruit_I2CDevice
+ */
+struct Adafruit_I2CTransport {
+  Adafruit_I2CDevice *dev; ///< Device the registers live on
+
+  /*! @brief Bind to a device
+   *  @param d The I2C device */
+  explicit Adafruit_I2CTransport(Adafruit_I2CDevice *d) : dev(d) {}
+
+  /*! @brief Read a register
+   *  @param address Register address
+   *  @param address_width Address bytes (1 or 2), sent LSB first
+   *  @param buffer Destination
+   *  @param len Bytes to read
+   *  @return True on success */
+  inline bool readRegister(uint16_t address, uint8_t address_width,
+                           uint8_t *buffer, size_t len) const {
+    uint8_t addrbuffer[2] = {(uint8_t)(address & 0xFF),
+                             (uint8_t)(address >> 8)};
+    return dev->write_then_read(addrbuffer, address_width, buffer, len);
+  }
+
+  /*! @brief Write a register
+   *  @param address Register address
+   *  @param address_width Address bytes (1 or 2), sent LSB first
+   *  @param buffer Data to write
+   *  @param len Bytes to write
+   *  @return True on success */
+  inline bool writeRegister(uint16_t address, uint8_t address_width,
+                            const uint8_t *buffer, size_t len) const {
+    uint8_t addrbuffer[2] = {(uint8_t)(address & 0xFF),
+                             (uint8_t)(address >> 8)};
+    return dev->write(buffer, len, true, addrbuffer, address_width);
+  }
+};
+
+/*!
+ * @brief Transport for registers on an Adafruit_SPIDevice, with the read and
+ * write address encoding fixed at compile time
+ * @tparam Type How the device marks reads and writes in the address
+ */
+template <Adafruit_BusIO_SPIRegType Type> struct Adafruit_SPITransport {
+  Adafruit_SPIDevice *dev; ///< Device the registers live on
+
+  /*! @brief Bind to a device
+   *  @param d The SPI device */
+  explicit Adafruit_SPITransport(Adafruit_SPIDevice *d) : dev(d) {}
+
+  /*! @brief Read a register
+   *  @param address Register address (opcode in the high byte for
+   *  ADDRESSED_OPCODE_BIT0_LOW_TO_WRITE)
+   *  @param address_width Address bytes
+   *  @param buffer Destination
+   *  @param len Bytes to read
+   *  @return True on success */
+  inline bool readRegister(uint16_t address, uint8_t address_width,
+                           uint8_t *buffer, size_t len) const {
+    uint8_t addrbuffer[2];
+    uint8_t n = encode(address, address_width, true, addrbuffer);
+    return dev->write_then_read(addrbuffer, n, buffer, len);
+  }
+
+  /*! @brief Write a register
+   *  @param address Register address (opcode in the high byte for
+   *  ADDRESSED_OPCODE_BIT0_LOW_TO_WRITE)
+   *  @param address_width Address bytes
+   *  @param buffer Data to write
+   *  @param len Bytes to write
+   *  @return True on success */
+  inline bool writeRegister(uint16_t address, uint8_t address_width,
+                            const uint8_t *buffer, size_t len) const {
+    uint8_t addrbuffer[2];
+    uint8_t n = encode(address, address_width, false, addrbuffer);
+    return dev->write(buffer, len, addrbuffer, n);
+  }
+
+private:
+  static inline uint8_t encode(uint16_t address, uint8_t address_width,
+                               bool read, uint8_t *addrbuffer) {
+    if (Type == ADDRESSED_OPCODE_BIT0_LOW_TO_WRITE) {
+      // The opcode is the high byte of the address, bit 0 low to write, and
+      // the 'actual' register address follows it
+      addrbuffer[0] = read ? (uint8_t)(address >> 8) | 0x01
+                           : (uint8_t)(address >> 8) & ~0x01;
+      addrbuffer[1] = (uint8_t)(address & 0xFF);
+      return address_width + 1;
+    }
+    addrbuffer[0] = (uint8_t)(address & 0xFF);
+    addrbuffer[1] = (uint8_t)(address >> 8);
+    if (Type == ADDRBIT8_HIGH_TOREAD) {
+      if (read)
+        addrbuffer[0] |= 0x80;
+      else
+        addrbuffer[0] &= ~0x80;
+    }
+    if (Type == ADDRBIT8_HIGH_TOWRITE) {
+      if (read)
+        addrbuffer[0] &= ~0x80;
+      else
+        addrbuffer[0] |= 0x80;
+    }
+    if (Type == AD8_HIGH_TOREAD_AD7_HIGH_TOINC) {
+      if (read)
+        addrbuffer[0] |= 0x80 | 0x40;
+      else
+        addrbuffer[0] = (addrbuffer[0] & ~0x80) | 0x40;
+    }
+    return address_width;
+  }
+};
+
+/*!
+ * @brief Transport for registers on an Adafruit_GenericDevice
+ */
+struct Adafruit_GenericTransport {
+  Adafruit_GenericDevice *dev; ///< Device the registers live on
+
+  /*! @brief Bind to a device
+   *  @param d The generic device */
+  explicit Adafruit_GenericTransport(Adafruit_GenericDevice *d) : dev(d) {}
+
+  /*! @brief Read a register
+   *  @param address Register address
+   *  @param address_width Address bytes (1 or 2), passed LSB first
+   *  @param buffer Destination
+   *  @param len Bytes to read
+   *  @return True on success */
+  inline bool readRegister(uint16_t address, uint8_t address_width,
+                           uint8_t *buffer, size_t len) const {
+    uint8_t addrbuffer[2] = {(uint8_t)(address & 0xFF),
+                             (uint8_t)(address >> 8)};
+    return dev->readRegister(addrbuffer, address_width, buffer, len);
+  }
+
+  /*! @brief Write a register
+   *  @param address Register address
+   *  @param address_width Address bytes (1 or 2), passed LSB first
+   *  @param buffer Data to write
+   *  @param len Bytes to write
+   *  @return True on success */
+  inline bool writeRegister(uint16_t address, uint8_t address_width,
+                            const uint8_t *buffer, size_t len) const {
+    uint8_t addrbuffer[2] = {(uint8_t)(address & 0xFF),
+                             (uint8_t)(address >> 8)};
+    return dev->writeRegister(addrbuffer, address_width, buffer, len);
+  }
+};
+
+/*!
+ * @brief Value storage of a shadowed Adafruit_BusIO_RegisterT: the last value
+ * read from or fully written to the device register
+ */
+template <bool Shadow> class Adafruit_BusIO_RegisterShadow {
+protected:
+  /*! @brief Remember the device register value
+   *  @param value The value */
+  inline void keep(uint32_t value) {
+    _cached = value;
+    _cacheValid = true;
+  }
+
+  /*! @brief Get the remembered value
+   *  @param value Set to the value if one is known
+   *  @return True if a value is known */
+  inline bool kept(uint32_t &value) const {
+    value = _cached;
+    return _cacheValid;
+  }
+
+  /*! @brief Forget the remembered value */
+  inline void forget(void) { _cacheValid = false; }
+
+private:
+  uint32_t _cached = 0;
+  bool _cacheValid = false;
+};
+
+/*!
+ * @brief No storage when the register is not shadowed, every
+ * read-modify-write reads the bus
+ */
+template <> class Adafruit_BusIO_RegisterShadow<false> {
+protected:
+  inline void keep(uint32_t) {}
+  inline bool kept(uint32_t &) const { return false; }
+  inline void forget(void) {}
+};
+
+/*!
+ * @brief A device register with the bus, width, byte order and address width
+ * known at compile time. Reads and writes inline down to the transport call.
+ *
+ * With Shadow set the register mirrors the device register the way
+ * Adafruit_BusIO_Register::setShadow(true) does: a successful read or
+ * full-width write updates the mirror, a raw buffer write, a failure or
+ * setAddress() drops it, and writeBits() then skips the bus read. Only
+ * shadow registers that nothing but the MCU changes, or call invalidate()
+ * when the device may have. The choice is a template parameter like the
+ * rest, so an unshadowed register carries no cache.
+ * @tparam Bus Transport type (see above)
+ * @tparam Width Register width in bytes (1-4)
+ * @tparam ByteOrder LSBFIRST or MSBFIRST
+ * @tparam AddressWidth Register address width in bytes
+ * @tparam Shadow Keep a write-through shadow of the register value
+ */
+template <class Bus, uint8_t Width = 1, uint8_t ByteOrder = LSBFIRST,
+          uint8_t AddressWidth = 1, bool Shadow = false>
+class Adafruit_BusIO_RegisterT : private Adafruit_BusIO_RegisterShadow<Shadow> {
+public:
+  static_assert(Width >= 1 && Width <= 4, "Registers are 1 to 4 bytes wide");
+
+  /*! @brief Create a register
+   *  @param bus Transport to the device
+   *  @param reg_addr Register address */
+  Adafruit_BusIO_RegisterT(Bus bus, uint16_t reg_addr)
+      : _bus(bus), _address(reg_addr) {}
+
+  /*! @brief Read bytes starting at the register
+   *  @param buffer Destination
+   *  @param len Bytes to read
+   *  @return True on success */
+  inline bool read(uint8_t *buffer, uint8_t len) {
+    return _bus.readRegister(_address, AddressWidth, buffer, len);
+  }
+
+  /*! @brief Write bytes starting at the register
+   *  @param buffer Data to write
+   *  @param len Bytes to write
+   *  @return True on success */
+  inline bool write(const uint8_t *buffer, uint8_t len) {
+    this->forget(); // Raw data, write(uint32_t) sets the shadow itself
+    return _bus.writeRegister(_address, AddressWidth, buffer, len);
+  }
+
+  /*! @brief Read the register value
+   *  @return The value, 0xFFFFFFFF on failure */
+  inline uint32_t read(void) {
+    uint8_t buffer[Width];
+    if (!read(buffer, Width)) {
+      return -1;
+    }
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < Width; i++) {
+      value <<= 8;
+      value |= ByteOrder == LSBFIRST ? buffer[Width - i - 1] : buffer[i];
+    }
+    this->keep(value);
+    return value;
+  }
+
+  /*! @brief Read the register for a read-modify-write. When shadowed this
+   *  is the mirrored value once it is known, with no bus access.
+   *  @return The value, 0xFFFFFFFF on failure */
+  inline uint32_t readShadow(void) {
+    uint32_t value;
+    if (this->kept(value)) {
+      return value;
+    }
+    return read(); // Seeds the shadow on success
+  }
+
+  /*! @brief Write the register value
+   *  @param value Value to write
+   *  @return True on success */
+  inline bool write(uint32_t value) {
+    uint8_t buffer[Width];
+    uint32_t v = value;
+    for (uint8_t i = 0; i < Width; i++) {
+      buffer[ByteOrder == LSBFIRST ? i : Width - i - 1] = v & 0xFF;
+      v >>= 8;
+    }
+    if (!write(buffer, Width)) {
+      return false;
+    }
+    this->keep(value);
+    return true;
+  }
+
+  /*! @brief Read a bitfield of the register
+   *  @tparam Bits Field width
+   *  @tparam Shift Position of the lowest field bit
+   *  @return The field value */
+  template <uint8_t Bits, uint8_t Shift> inline uint32_t readBits(void) {
+    return (read() >> Shift) & mask<Bits>();
+  }
+
+  /*! @brief Read-modify-write a bitfield of the register. When shadowed and
+   *  the value is known this is a single bus write.
+   *  @tparam Bits Field width
+   *  @tparam Shift Position of the lowest field bit
+   *  @param value New field value
+   *  @return False on a bad value or a failed bus access */
+  template <uint8_t Bits, uint8_t Shift> inline bool writeBits(uint32_t value) {
+    if (value > mask<Bits>()) {
+      return false;
+    }
+    uint32_t reg;
+    if (!this->kept(reg)) {
+      uint8_t buffer[Width];
+      if (!read(buffer, Width)) {
+        return false;
+      }
+      reg = 0;
+      for (uint8_t i = 0; i < Width; i++) {
+        reg <<= 8;
+        reg |= ByteOrder == LSBFIRST ? buffer[Width - i - 1] : buffer[i];
+      }
+    }
+    reg &= ~(mask<Bits>() << Shift);
+    return write(reg | (value << Shift));
+  }
+
+  /*! @brief Forget the shadowed value, e.g. after the device reset or
+   *  changed the register itself. The next writeBits() reads it again. */
+  inline void invalidate(void) { this->forget(); }
+
+  /*! @brief Point at another register
+   *  @param address New register address */
+  void setAddress(uint16_t address) {
+    _address = address;
+    this->forget();
+  }
+
+private:
+  template <uint8_t Bits> static inline uint32_t mask(void) {
+    return Bits >= 32 ? 0xFFFFFFFFUL : (1UL << (Bits & 31)) - 1;
+  }
+
+  Bus _bus;
+  uint16_t _address;
+};
+
+#endif // SPI exists
+#endif // Adafruit_BusIO_RegisterT_h
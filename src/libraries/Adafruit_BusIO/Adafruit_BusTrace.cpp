@@ -0,0 +1,156 @@
+#include "Adafruit_BusTrace.h"
+
+#ifdef BUSIO_HAS_TRACE
+#include <Arduino.h>
+#if defined(__AVR__)
+#include <util/atomic.h>
+#endif
+
+Adafruit_BusTrace BusTrace;
+
+/*!
+ *    @brief  Record a finished transaction. Safe to call from interrupts.
+ *    @param  addr 7-bit device address
+ *    @param  flags BUSIO_TRACE_WRITE, READ, NOSTOP and ASYNC
+ *    @param  status BUSIO_TRACE_OK or the failure code
+ *    @param  write_len Number of bytes written
+ *    @param  read_len Number of bytes read
+ *    @param  data Bytes of the transaction in bus order
+ *    @param  data_len Number of bytes in data
+ *    @param  more Bytes following data (e.g. the read after the write)
+ *    @param  more_len Number of bytes in more
+ */
+void Adafruit_BusTrace::record(uint8_t addr, uint8_t flags, uint8_t status,
+                               size_t write_len, size_t read_len,
+                               const uint8_t *data, size_t data_len,
+                               const uint8_t *more, size_t more_len) {
+  if (!_enabled) {
+    return;
+  }
+  uint8_t slot;
+#if defined(__AVR__)
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+  {
+    slot = _head;
+    _head = (slot + 1) & (BUSIO_TRACE_DEPTH - 1);
+    if (_count < BUSIO_TRACE_DEPTH) {
+      _count = _count + 1;
+    }
+    _total = _total + 1;
+  }
+
+  Adafruit_BusTraceEntry &e = _ring[slot];
+  e.micros = ::micros();
+  e.addr = addr;
+  e.flags = flags;
+  e.write_len = write_len > 255 ? 255 : write_len;
+  e.read_len = read_len > 255 ? 255 : read_len;
+  e.status = status;
+  uint8_t n = 0;
+  for (size_t i = 0; i < data_len && n < BUSIO_TRACE_BYTES; i++) {
+    e.data[n++] = data[i];
+  }
+  for (size_t i = 0; i < more_len && n < BUSIO_TRACE_BYTES; i++) {
+    e.data[n++] = more[i];
+  }
+  while (n < BUSIO_TRACE_BYTES) {
+    e.data[n++] = 0;
+  }
+}
+
+/*!
+ *    @brief  Number of entries held
+ *    @return Up to BUSIO_TRACE_DEPTH
+ */
+uint8_t Adafruit_BusTrace::count(void) const { return _count; }
+
+/*!
+ *    @brief  Read an entry. Pause recording first for a consistent view.
+ *    @param  index 0 is the oldest entry held
+ *    @param  entry Destination
+ *    @return False if there is no such entry
+ */
+bool Adafruit_BusTrace::get(uint8_t index, Adafruit_BusTraceEntry &entry) const {
+  uint8_t n = count();
+  if (index >= n) {
+    return false;
+  }
+  entry = _ring[(uint8_t)(_head - n + index) & (BUSIO_TRACE_DEPTH - 1)];
+  return true;
+}
+
+/*!
+ *    @brief  Serialize an entry: micros (4 bytes, little endian), addr,
+ *    flags, write_len, read_len, status and BUSIO_TRACE_BYTES data bytes
+ *    @param  index 0 is the oldest entry held
+ *    @param  out BUSIO_TRACE_ENTRY_SIZE bytes
+ *    @return False if there is no such entry
+ */
+bool Adafruit_BusTrace::pack(uint8_t index, uint8_t *out) const {
+  Adafruit_BusTraceEntry e;
+  if (!get(index, e)) {
+    return false;
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    *out++ = e.micros >> (8 * i);
+  }
+  *out++ = e.addr;
+  *out++ = e.flags;
+  *out++ = e.write_len;
+  *out++ = e.read_len;
+  *out++ = e.status;
+  for (uint8_t i = 0; i < BUSIO_TRACE_BYTES; i++) {
+    *out++ = e.data[i];
+  }
+  return true;
+}
+
+/*!
+ *    @brief  Write the trace in binary, oldest entry first. The header is
+ *    'B' 'T', version, entry size, entry count, total (2 bytes) and the
+ *    current micros() (4 bytes), multi-byte fields little endian. Recording
+ *    is paused while dumping.
+ *    @param  out Serial port or other Print
+ */
+void Adafruit_BusTrace::dump(Print &out) {
+  bool was = _enabled;
+  _enabled = false;
+  uint8_t n = count();
+  uint16_t total = _total;
+  uint32_t now = ::micros();
+  uint8_t header[11] = {'B',
+                        'T',
+                        BUSIO_TRACE_VERSION,
+                        BUSIO_TRACE_ENTRY_SIZE,
+                        n,
+                        (uint8_t)total,
+                        (uint8_t)(total >> 8),
+                        (uint8_t)now,
+                        (uint8_t)(now >> 8),
+                        (uint8_t)(now >> 16),
+                        (uint8_t)(now >> 24)};
+  out.write(header, sizeof(header));
+  uint8_t entry[BUSIO_TRACE_ENTRY_SIZE];
+  for (uint8_t i = 0; i < n; i++) {
+    pack(i, entry);
+    out.write(entry, sizeof(entry));
+  }
+  _enabled = was;
+}
+
+/*!
+ *    @brief  Drop all entries
+ */
+void Adafruit_BusTrace::clear(void) {
+#if defined(__AVR__)
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+  {
+    _head = 0;
+    _count = 0;
+    _total = 0;
+  }
+}
+
+#endif // BUSIO_HAS_TRACE
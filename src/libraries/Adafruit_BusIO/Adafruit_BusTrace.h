@@ -0,0 +1,101 @@
+#ifndef Adafruit_BusTrace_h
+#define Adafruit_BusTrace_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*! Entries kept in the trace ring (power of two), 0 compiles tracing out */
+#ifndef BUSIO_TRACE_DEPTH
+#define BUSIO_TRACE_DEPTH 8
+#endif
+
+/*! Leading data bytes stored per transaction */
+#define BUSIO_TRACE_BYTES 4
+
+/*! Size of an entry in dump() and pack() output */
+#define BUSIO_TRACE_ENTRY_SIZE (9 + BUSIO_TRACE_BYTES)
+
+/*! Format version of the dump() header */
+#define BUSIO_TRACE_VERSION 1
+
+// Entry flags
+#define BUSIO_TRACE_WRITE 0x01  ///< Transaction had a write phase
+#define BUSIO_TRACE_READ 0x02   ///< Transaction had a read phase
+#define BUSIO_TRACE_NOSTOP 0x04 ///< Ended without STOP (repeated START next)
+#define BUSIO_TRACE_ASYNC 0x08  ///< Ran on the asynchronous engine
+
+// Entry status: 0 is success, 1..5 are Wire endTransmission() codes, TWI
+// status codes (0x08..0xF8, multiples of 8) come from the asynchronous
+// engine, the rest are below
+#define BUSIO_TRACE_OK 0x00        ///< Success
+#define BUSIO_TRACE_TOO_LONG 0xF1  ///< Larger than the Wire buffer
+#define BUSIO_TRACE_SHORT 0xF2     ///< Fewer bytes read than requested
+#define BUSIO_TRACE_TIMEOUT 0xF3   ///< Aborted after the wait() timeout
+
+/*!
+ * @brief One recorded bus transaction
+ */
+struct Adafruit_BusTraceEntry {
+  uint32_t micros;  ///< micros() when the transaction finished
+  uint8_t addr;     ///< 7-bit device address
+  uint8_t flags;    ///< BUSIO_TRACE_WRITE | READ | NOSTOP | ASYNC
+  uint8_t write_len; ///< Bytes written (saturates at 255)
+  uint8_t read_len;  ///< Bytes read (saturates at 255)
+  uint8_t status;   ///< BUSIO_TRACE_OK or the failure code
+  uint8_t data[BUSIO_TRACE_BYTES]; ///< First written, then first read bytes
+};
+
+class Print;
+
+/*!
+ * @brief In-RAM recorder of bus transactions.
+ *
+ * record() costs a micros() call and a few byte copies, about 240 cycles
+ * on a 16 MHz AVR (15 us, less than one byte on a 400 kHz bus), cheap
+ * enough to leave on in production, unlike printing with DEBUG_SERIAL
+ * which changes the bus timing it is meant to show. The newest BUSIO_TRACE_DEPTH entries
+ * are kept; read them after the fact with get(), pack() or dump() and
+ * render them with tools/busio_trace.py.
+ */
+class Adafruit_BusTrace {
+public:
+  Adafruit_BusTrace() : _head(0), _count(0), _total(0), _enabled(true) {}
+
+  void record(uint8_t addr, uint8_t flags, uint8_t status, size_t write_len,
+              size_t read_len, const uint8_t *data, size_t data_len,
+              const uint8_t *more = nullptr, size_t more_len = 0);
+
+  uint8_t count(void) const;
+  uint16_t total(void) const { return _total; }
+  bool get(uint8_t index, Adafruit_BusTraceEntry &entry) const;
+  bool pack(uint8_t index, uint8_t *out) const;
+  void dump(Print &out);
+  void clear(void);
+
+  /*! @brief Pause or resume recording, e.g. while the trace is read out
+   *  @param enable True to record */
+  void enable(bool enable) { _enabled = enable; }
+  /*! @brief Whether transactions are being recorded
+   *  @return True while recording */
+  bool enabled(void) const { return _enabled; }
+
+private:
+#if BUSIO_TRACE_DEPTH > 0
+  Adafruit_BusTraceEntry _ring[BUSIO_TRACE_DEPTH];
+  static_assert((BUSIO_TRACE_DEPTH & (BUSIO_TRACE_DEPTH - 1)) == 0,
+                "BUSIO_TRACE_DEPTH must be a power of two");
+  static_assert(BUSIO_TRACE_DEPTH <= 128, "BUSIO_TRACE_DEPTH is too large");
+#endif
+  volatile uint8_t _head;   ///< Next slot to write
+  volatile uint8_t _count;  ///< Entries held
+  volatile uint16_t _total; ///< Transactions recorded since clear()
+  volatile bool _enabled;
+};
+
+#if BUSIO_TRACE_DEPTH > 0
+/*! Tracing is compiled in */
+#define BUSIO_HAS_TRACE
+extern Adafruit_BusTrace BusTrace; ///< Trace of all I2C transactions
+#endif
+
+#endif // Adafruit_BusTrace_h
@@ -0,0 +1,18 @@
+#include "Adafruit_I2CAsync.h"
+
+#ifdef BUSIO_HAS_I2C_ASYNC
+#include <Arduino.h>
+
+Adafruit_I2CAsyncEngine<Adafruit_TWIPort> I2CAsync;
+
+/*!
+ *    @brief  Time source of transaction timeouts
+ *    @return Microseconds since startup
+ */
+uint32_t Adafruit_TWIPort::micros() { return ::micros(); }
+
+#ifdef BUSIO_TWI_ISR
+ISR(TWI_vect) { I2CAsync.handleEvent(); }
+#endif
+
+#endif // BUSIO_HAS_I2C_ASYNC
@@ -0,0 +1,399 @@
+#ifndef Adafruit_I2CAsync_h
+#define Adafruit_I2CAsync_h
+
+#include <Adafruit_BusTrace.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*! Number of transactions that can wait for the bus */
+#define I2C_ASYNC_QUEUE 4
+
+/*! Write buffers up to this size are copied into the transaction */
+#define I2C_ASYNC_INLINE 4
+
+/*! Default time a wait() may take before the bus is reset (microseconds) */
+#define I2C_ASYNC_TIMEOUT_US 25000UL
+
+// TWI status codes (status register with the prescaler bits masked)
+#define I2C_ASYNC_START 0x08          ///< START sent
+#define I2C_ASYNC_REP_START 0x10      ///< Repeated START sent
+#define I2C_ASYNC_MT_SLA_ACK 0x18     ///< SLA+W sent, ACK received
+#define I2C_ASYNC_MT_SLA_NACK 0x20    ///< SLA+W sent, NACK received
+#define I2C_ASYNC_MT_DATA_ACK 0x28    ///< Data sent, ACK received
+#define I2C_ASYNC_MT_DATA_NACK 0x30   ///< Data sent, NACK received
+#define I2C_ASYNC_ARB_LOST 0x38       ///< Arbitration lost
+#define I2C_ASYNC_MR_SLA_ACK 0x40     ///< SLA+R sent, ACK received
+#define I2C_ASYNC_MR_SLA_NACK 0x48    ///< SLA+R sent, NACK received
+#define I2C_ASYNC_MR_DATA_ACK 0x50    ///< Data received, ACK returned
+#define I2C_ASYNC_MR_DATA_NACK 0x58   ///< Data received, NACK returned
+
+/*!
+ * @brief State of an asynchronous transaction
+ */
+typedef enum _Adafruit_I2CAsyncState {
+  I2C_ASYNC_IDLE = 0,   ///< Not submitted
+  I2C_ASYNC_QUEUED = 1, ///< Waiting for the bus
+  I2C_ASYNC_BUSY = 2,   ///< On the bus
+  I2C_ASYNC_DONE = 3,   ///< Completed, read buffer is valid
+  I2C_ASYNC_FAILED = 4, ///< NACK, arbitration loss, bus error or timeout
+} Adafruit_I2CAsyncState;
+
+struct Adafruit_I2CTransaction;
+
+/*! Completion callback, called from the interrupt (or poll()) */
+typedef void (*busio_i2c_async_callback_t)(Adafruit_I2CTransaction *t);
+
+/*! Starts (run true) or stops a periodic interrupt that calls step() */
+typedef void (*busio_i2c_async_stepper_t)(bool run);
+
+/*!
+ * @brief One write-then-read transfer. Owned by the caller, it must stay
+ * alive (and so must the buffers) until finished() returns true.
+ */
+struct Adafruit_I2CTransaction {
+  uint8_t addr;                        ///< 7-bit device address
+  const uint8_t *write_buffer;         ///< Bytes to write
+  uint16_t write_len;                  ///< Number of bytes to write
+  uint8_t *read_buffer;                ///< Destination of the read bytes
+  uint16_t read_len;                   ///< Number of bytes to read
+  busio_i2c_async_callback_t callback; ///< Called once finished, or nullptr
+  void *user;                          ///< Free for the callback
+  uint8_t inline_data[I2C_ASYNC_INLINE]; ///< Storage of short write buffers
+  volatile uint8_t state;              ///< Adafruit_I2CAsyncState
+
+  /*! @brief  Whether the transfer has completed or failed
+   *  @return True once the state is I2C_ASYNC_DONE or I2C_ASYNC_FAILED */
+  bool finished() const {
+    return state == I2C_ASYNC_DONE || state == I2C_ASYNC_FAILED;
+  }
+};
+
+/*!
+ * @brief Interrupt-driven I2C master with a transaction queue.
+ *
+ * handleEvent() is the body of the TWI interrupt: every call advances the
+ * active transfer by one bus event, so the CPU is free while bytes are on
+ * the wire. Finished transfers chain into the next queued one with a
+ * repeated START, the STOP is only sent once the queue is empty.
+ *
+ * Where the TWI interrupt is taken (by Wire on AVR), a periodic interrupt
+ * registered with setStepper() can call step() instead, so transfers still
+ * run in the background rather than only inside wait() and poll().
+ *
+ * The hardware is reached through Port, which provides:
+ *   static void start();          // send (repeated) START
+ *   static void stop();           // send STOP, release the bus
+ *   static void send(uint8_t b);  // transmit a byte
+ *   static void receive(bool ack);// receive a byte, ACK or NACK it
+ *   static uint8_t data();        // last received byte
+ *   static uint8_t status();      // status code (I2C_ASYNC_*)
+ *   static bool pending();        // an event waits for handleEvent()
+ *   static void reset();          // abort and reinitialize the peripheral
+ *   static uint8_t lock();        // disable interrupts, returns the state
+ *   static void unlock(uint8_t);  // restore the interrupt state
+ *   static uint32_t micros();
+ *   static const bool interruptDriven; // events are handled by the ISR
+ */
+template <class Port> class Adafruit_I2CAsyncEngine {
+public:
+  Adafruit_I2CAsyncEngine()
+      : _head(0), _tail(0), _phase(0), _pos(0), _stepper(nullptr) {}
+
+  /*!
+   * @brief  Queue a transaction, it starts at once if the bus is free
+   * @param  t The transaction (addr, buffers and callback set)
+   * @return False if the queue is full
+   */
+  bool submit(Adafruit_I2CTransaction *t) {
+    uint8_t sreg = Port::lock();
+    if ((uint8_t)(_head - _tail) == I2C_ASYNC_QUEUE) {
+      Port::unlock(sreg);
+      return false;
+    }
+    t->state = I2C_ASYNC_QUEUED;
+    _queue[_head & (I2C_ASYNC_QUEUE - 1)] = t;
+    _head++;
+    if ((uint8_t)(_head - _tail) == 1) {
+      begin(t);
+      if (_stepper)
+        _stepper(true);
+    }
+    Port::unlock(sreg);
+    return true;
+  }
+
+  /*!
+   * @brief  Whether a transaction is queued or on the bus
+   * @return True while busy
+   */
+  bool busy() const { return _head != _tail; }
+
+  /*!
+   * @brief  Advance the active transaction by one bus event (TWI interrupt)
+   */
+  void handleEvent() {
+    if (_head == _tail)
+      return;
+    Adafruit_I2CTransaction *t = _queue[_tail & (I2C_ASYNC_QUEUE - 1)];
+    uint8_t status = Port::status();
+
+    switch (status) {
+    case I2C_ASYNC_START:
+    case I2C_ASYNC_REP_START:
+      t->state = I2C_ASYNC_BUSY;
+      Port::send((t->addr << 1) | _phase);
+      break;
+
+    case I2C_ASYNC_MT_SLA_ACK:
+    case I2C_ASYNC_MT_DATA_ACK:
+      if (_pos < t->write_len) {
+        Port::send(t->write_buffer[_pos++]);
+      } else if (t->read_len) {
+        // Repeated START into the read phase
+        _phase = 1;
+        _pos = 0;
+        Port::start();
+      } else {
+        finish(t, I2C_ASYNC_DONE, status);
+      }
+      break;
+
+    case I2C_ASYNC_MR_SLA_ACK:
+      Port::receive(t->read_len > 1);
+      break;
+
+    case I2C_ASYNC_MR_DATA_ACK:
+      t->read_buffer[_pos++] = Port::data();
+      Port::receive(_pos + 1 < t->read_len);
+      break;
+
+    case I2C_ASYNC_MR_DATA_NACK:
+      t->read_buffer[_pos++] = Port::data();
+      finish(t, _pos == t->read_len ? I2C_ASYNC_DONE : I2C_ASYNC_FAILED,
+             status);
+      break;
+
+    case I2C_ASYNC_ARB_LOST:
+      // Another master owns the bus, no STOP
+      Port::reset();
+      finish(t, I2C_ASYNC_FAILED, status, false);
+      break;
+
+    default:
+      // NACKs and bus errors
+      finish(t, I2C_ASYNC_FAILED, status);
+      break;
+    }
+  }
+
+  /*!
+   * @brief  Handle pending bus events when no interrupt does it
+   */
+  void poll() {
+    if (Port::interruptDriven)
+      return;
+    uint8_t sreg = Port::lock(); // Keeps a stepping interrupt out
+    while (_head != _tail && Port::pending())
+      handleEvent();
+    Port::unlock(sreg);
+  }
+
+  /*!
+   * @brief  Hand the bus events to a periodic interrupt. The engine starts
+   *         it when a transaction goes on an idle bus and stops it once the
+   *         queue is empty; the interrupt calls step(), which handles at
+   *         most one event. poll() and wait() still handle the pending
+   *         events at once. A period of about one byte on the bus (9
+   *         clocks) after the last event keeps the bus busy.
+   * @param  stepper Starts and stops the interrupt, nullptr to poll
+   */
+  void setStepper(busio_i2c_async_stepper_t stepper) {
+    uint8_t sreg = Port::lock();
+    _stepper = stepper;
+    if (_stepper && _head != _tail)
+      _stepper(true);
+    Port::unlock(sreg);
+  }
+
+  /*!
+   * @brief  Handle the pending bus event, if any (body of the stepping
+   *         interrupt, see setStepper())
+   * @return True if an event was handled
+   */
+  bool step() {
+    if (_head == _tail || !Port::pending())
+      return false;
+    handleEvent();
+    return true;
+  }
+
+  /*!
+   * @brief  Wait until a transaction has finished
+   * @param  t The transaction
+   * @param  timeout_us Time after which the bus is reset and all queued
+   *         transactions fail
+   * @return True if it completed successfully
+   */
+  bool wait(Adafruit_I2CTransaction *t,
+            uint32_t timeout_us = I2C_ASYNC_TIMEOUT_US) {
+    uint32_t start = Port::micros();
+    while (!t->finished()) {
+      poll();
+      if (Port::micros() - start > timeout_us) {
+        abort();
+        break;
+      }
+    }
+    return t->state == I2C_ASYNC_DONE;
+  }
+
+  /*!
+   * @brief  Wait until every queued transaction has finished
+   */
+  void flush() {
+    uint8_t head = _head;
+    if (head != _tail)
+      wait(_queue[(uint8_t)(head - 1) & (I2C_ASYNC_QUEUE - 1)]);
+  }
+
+  /*!
+   * @brief  Reset the bus and fail every queued transaction
+   */
+  void abort() {
+    uint8_t sreg = Port::lock();
+    Port::reset();
+    uint8_t head = _head;
+    while (_tail != head) {
+      Adafruit_I2CTransaction *t = _queue[_tail & (I2C_ASYNC_QUEUE - 1)];
+      _tail++;
+      t->state = I2C_ASYNC_FAILED;
+      trace(t, BUSIO_TRACE_TIMEOUT, 0, 0, true);
+      if (t->callback)
+        t->callback(t);
+    }
+    if (_stepper)
+      _stepper(false);
+    Port::unlock(sreg);
+  }
+
+private:
+  Adafruit_I2CTransaction *_queue[I2C_ASYNC_QUEUE];
+  volatile uint8_t _head; ///< Next free queue slot
+  volatile uint8_t _tail; ///< Active transaction
+  uint8_t _phase;         ///< R/W bit of the next address byte
+  uint16_t _pos;          ///< Bytes written or read in the current phase
+  busio_i2c_async_stepper_t _stepper; ///< Stands in for the bus interrupt
+
+  static_assert((I2C_ASYNC_QUEUE & (I2C_ASYNC_QUEUE - 1)) == 0,
+                "I2C_ASYNC_QUEUE must be a power of two");
+
+  void begin(Adafruit_I2CTransaction *t) {
+    _phase = (t->write_len == 0 && t->read_len != 0) ? 1 : 0;
+    _pos = 0;
+    Port::start();
+  }
+
+  /*!
+   * Retire the active transaction. A successful one chains into the next
+   * queued transaction with a repeated START; after a failure, or when the
+   * queue is empty, the bus is released with a STOP first. The trace entry
+   * is written once the next transaction is on its way.
+   */
+  void finish(Adafruit_I2CTransaction *t, uint8_t state, uint8_t status,
+              bool stop = true) {
+    uint16_t written = _phase ? t->write_len : _pos;
+    uint16_t read = _phase ? _pos : 0;
+    _tail++;
+    t->state = state;
+    bool more = _head != _tail;
+    bool stopped = stop && (state == I2C_ASYNC_FAILED || !more);
+    if (stopped)
+      Port::stop();
+    if (more)
+      begin(_queue[_tail & (I2C_ASYNC_QUEUE - 1)]);
+    else if (_stepper)
+      _stepper(false);
+    trace(t, state == I2C_ASYNC_DONE ? BUSIO_TRACE_OK : status, written,
+          read, stopped);
+    if (t->callback)
+      t->callback(t);
+  }
+
+  static inline void trace(Adafruit_I2CTransaction *t, uint8_t status,
+                           uint16_t written, uint16_t read, bool stopped) {
+#ifdef BUSIO_HAS_TRACE
+    uint8_t flags = BUSIO_TRACE_ASYNC | (stopped ? 0 : BUSIO_TRACE_NOSTOP) |
+                    (t->write_len ? BUSIO_TRACE_WRITE : 0) |
+                    (t->read_len ? BUSIO_TRACE_READ : 0);
+    BusTrace.record(t->addr, flags, status, written, read, t->write_buffer,
+                    written, t->read_buffer, read);
+#endif
+  }
+};
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#endif
+
+#if defined(__AVR__) && defined(TWCR)
+
+/*!
+ * @brief TWI peripheral of AVR parts.
+ *
+ * The Wire library defines the TWI interrupt itself. Unless the sketch is
+ * built with BUSIO_TWI_ISR (and without Wire), events are handled by
+ * I2CAsync.poll() and wait(), or by a timer interrupt of the sketch that
+ * calls I2CAsync.step() (see setStepper()); Wire keeps working between
+ * transactions.
+ */
+struct Adafruit_TWIPort {
+#ifdef BUSIO_TWI_ISR
+  static const uint8_t ie = _BV(TWIE); ///< Interrupt enable of every TWCR write
+  static const bool interruptDriven = true;
+#else
+  static const uint8_t ie = 0;
+  static const bool interruptDriven = false;
+#endif
+  static void start() {
+    while (TWCR & _BV(TWSTO)) {
+      // A STOP is still being sent
+    }
+    TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN) | ie;
+  }
+  static void stop() {
+    // Leave the peripheral as Wire expects it
+    TWCR = _BV(TWINT) | _BV(TWSTO) | _BV(TWEN) | _BV(TWEA) | _BV(TWIE);
+  }
+  static void send(uint8_t b) {
+    TWDR = b;
+    TWCR = _BV(TWINT) | _BV(TWEN) | ie;
+  }
+  static void receive(bool ack) {
+    TWCR = _BV(TWINT) | _BV(TWEN) | ie | (ack ? _BV(TWEA) : 0);
+  }
+  static uint8_t data() { return TWDR; }
+  static uint8_t status() { return TWSR & 0xF8; }
+  static bool pending() { return TWCR & _BV(TWINT); }
+  static void reset() {
+    TWCR = 0;
+    TWCR = _BV(TWEN) | _BV(TWEA) | _BV(TWIE);
+  }
+  static uint8_t lock() {
+    uint8_t sreg = SREG;
+    cli();
+    return sreg;
+  }
+  static void unlock(uint8_t sreg) { SREG = sreg; }
+  static uint32_t micros();
+};
+
+/*! @brief Asynchronous I2C engine of the TWI peripheral */
+extern Adafruit_I2CAsyncEngine<Adafruit_TWIPort> I2CAsync;
+
+/*! Defined when I2CAsync is available, Adafruit_I2CDevice falls back to
+ *  blocking transfers otherwise */
+#define BUSIO_HAS_I2C_ASYNC
+#endif
+
+#endif // Adafruit_I2CAsync_h
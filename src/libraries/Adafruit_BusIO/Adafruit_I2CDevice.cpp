@@ -2,6 +2,45 @@
 
 // #define DEBUG_SERIAL Serial
 
+/*!
+ *    @brief  Record a blocking write in the bus trace
+ *    @param  addr 7-bit device address
+ *    @param  stop Whether the write ended with a STOP
+ *    @param  status BUSIO_TRACE_OK or the failure code
+ *    @param  prefix_buffer Prefix bytes, or nullptr
+ *    @param  prefix_len Number of prefix bytes
+ *    @param  buffer Data bytes
+ *    @param  len Number of data bytes
+ */
+static inline void traceWrite(uint8_t addr, bool stop, uint8_t status,
+                              const uint8_t *prefix_buffer, size_t prefix_len,
+                              const uint8_t *buffer, size_t len) {
+#ifdef BUSIO_HAS_TRACE
+  if (prefix_buffer == nullptr) {
+    prefix_len = 0;
+  }
+  BusTrace.record(addr, BUSIO_TRACE_WRITE | (stop ? 0 : BUSIO_TRACE_NOSTOP),
+                  status, prefix_len + len, 0, prefix_buffer, prefix_len,
+                  buffer, len);
+#endif
+}
+
+/*!
+ *    @brief  Record a blocking read in the bus trace
+ *    @param  addr 7-bit device address
+ *    @param  stop Whether the read ended with a STOP
+ *    @param  status BUSIO_TRACE_OK or the failure code
+ *    @param  buffer Bytes read
+ *    @param  len Number of bytes read
+ */
+static inline void traceRead(uint8_t addr, bool stop, uint8_t status,
+                             const uint8_t *buffer, size_t len) {
+#ifdef BUSIO_HAS_TRACE
+  BusTrace.record(addr, BUSIO_TRACE_READ | (stop ? 0 : BUSIO_TRACE_NOSTOP),
+                  status, 0, len, buffer, len);
+#endif
+}
+
 /*!
  *    @brief  Create an I2C device at a given address
  *    @param  addr The 7-bit I2C address for the device
@@ -109,9 +148,16 @@ bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
 #ifdef DEBUG_SERIAL
     DEBUG_SERIAL.println(F("\tI2CDevice could not write such a large buffer"));
 #endif
+    traceWrite(_addr, stop, BUSIO_TRACE_TOO_LONG, prefix_buffer, prefix_len,
+               buffer, len);
     return false;
   }
 
+#ifdef BUSIO_HAS_I2C_ASYNC
+  // Let queued asynchronous transfers finish before Wire takes the bus
+  I2CAsync.flush();
+#endif
+
   _wire->beginTransmission(_addr);
 
   // Write the prefix data (usually an address)
@@ -120,6 +166,8 @@ bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
 #ifdef DEBUG_SERIAL
       DEBUG_SERIAL.println(F("\tI2CDevice failed to write"));
 #endif
+      traceWrite(_addr, stop, BUSIO_TRACE_TOO_LONG, prefix_buffer, prefix_len,
+                 buffer, len);
       return false;
     }
   }
@@ -129,6 +177,8 @@ bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
 #ifdef DEBUG_SERIAL
     DEBUG_SERIAL.println(F("\tI2CDevice failed to write"));
 #endif
+    traceWrite(_addr, stop, BUSIO_TRACE_TOO_LONG, prefix_buffer, prefix_len,
+               buffer, len);
     return false;
   }
 
@@ -158,7 +208,9 @@ bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
   }
 #endif
 
-  if (_wire->endTransmission(stop) == 0) {
+  uint8_t result = _wire->endTransmission(stop);
+  traceWrite(_addr, stop, result, prefix_buffer, prefix_len, buffer, len);
+  if (result == 0) {
 #ifdef DEBUG_SERIAL
     DEBUG_SERIAL.println();
     // DEBUG_SERIAL.println("Sent!");
@@ -174,13 +226,20 @@ bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool stop,
 
 /*!
  *    @brief  Read from I2C into a buffer from the I2C device.
- *    Cannot be more than maxBufferSize() bytes.
+ *    Reads ending with a STOP are streamed straight into the buffer where
+ *    the asynchronous engine is available, with no size limit. Otherwise
+ *    they are split into maxBufferSize() chunks.
  *    @param  buffer Pointer to buffer of data to read into
  *    @param  len Number of bytes from buffer to read.
  *    @param  stop Whether to send an I2C STOP signal on read
  *    @return True if read was successful, otherwise false.
  */
 bool Adafruit_I2CDevice::read(uint8_t *buffer, size_t len, bool stop) {
+#ifdef BUSIO_HAS_I2C_ASYNC
+  if (stop) {
+    return _transfer(nullptr, 0, buffer, len);
+  }
+#endif
   size_t pos = 0;
   while (pos < len) {
     size_t read_len =
@@ -194,6 +253,9 @@ bool Adafruit_I2CDevice::read(uint8_t *buffer, size_t len, bool stop) {
 }
 
 bool Adafruit_I2CDevice::_read(uint8_t *buffer, size_t len, bool stop) {
+#ifdef BUSIO_HAS_I2C_ASYNC
+  I2CAsync.flush();
+#endif
 #if defined(TinyWireM_h)
   size_t recv = _wire->requestFrom((uint8_t)_addr, (uint8_t)len);
 #elif defined(ARDUINO_ARCH_MEGAAVR)
@@ -208,12 +270,14 @@ bool Adafruit_I2CDevice::_read(uint8_t *buffer, size_t len, bool stop) {
     DEBUG_SERIAL.print(F("\tI2CDevice did not receive enough data: "));
     DEBUG_SERIAL.println(recv);
 #endif
+    traceRead(_addr, stop, BUSIO_TRACE_SHORT, buffer, 0);
     return false;
   }
 
   for (uint16_t i = 0; i < len; i++) {
     buffer[i] = _wire->read();
   }
+  traceRead(_addr, stop, BUSIO_TRACE_OK, buffer, len);
 
 #ifdef DEBUG_SERIAL
   DEBUG_SERIAL.print(F("\tI2CREAD  @ 0x"));
@@ -233,9 +297,37 @@ bool Adafruit_I2CDevice::_read(uint8_t *buffer, size_t len, bool stop) {
   return true;
 }
 
+/*!
+ *    @brief  Run one transaction on the asynchronous engine and wait for it.
+ *    Bytes go from the TWI data register straight into read_buffer.
+ *    @param  write_buffer Pointer to buffer of data to write from
+ *    @param  write_len Number of bytes from buffer to write.
+ *    @param  read_buffer Pointer to buffer of data to read into.
+ *    @param  read_len Number of bytes from buffer to read.
+ *    @return True if the transaction completed successfully.
+ */
+bool Adafruit_I2CDevice::_transfer(const uint8_t *write_buffer,
+                                   size_t write_len, uint8_t *read_buffer,
+                                   size_t read_len) {
+  Adafruit_I2CTransaction transaction;
+  if (!write_then_read_async(write_buffer, write_len, read_buffer, read_len,
+                             transaction)) {
+    // Queue full, let it drain
+#ifdef BUSIO_HAS_I2C_ASYNC
+    I2CAsync.flush();
+#endif
+    if (!write_then_read_async(write_buffer, write_len, read_buffer,
+                               read_len, transaction)) {
+      return false;
+    }
+  }
+  return wait(transaction);
+}
+
 /*!
  *    @brief  Write some data, then read some data from I2C into another buffer.
- *    Cannot be more than maxBufferSize() bytes. The buffers can point to
+ *    Without a STOP in between, the read has no maxBufferSize() limit where
+ *    the asynchronous engine is available. The buffers can point to
  *    same/overlapping locations.
  *    @param  write_buffer Pointer to buffer of data to write from
  *    @param  write_len Number of bytes from buffer to write.
@@ -247,6 +339,11 @@ bool Adafruit_I2CDevice::_read(uint8_t *buffer, size_t len, bool stop) {
 bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer,
                                          size_t write_len, uint8_t *read_buffer,
                                          size_t read_len, bool stop) {
+#ifdef BUSIO_HAS_I2C_ASYNC
+  if (!stop) {
+    return _transfer(write_buffer, write_len, read_buffer, read_len);
+  }
+#endif
   if (!write(write_buffer, write_len, stop)) {
     return false;
   }
@@ -254,6 +351,68 @@ bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer,
   return read(read_buffer, read_len);
 }
 
+/*!
+ *    @brief  Start writing some data, then reading some data into another
+ *    buffer, without waiting for the bus. The transfer runs from the TWI
+ *    interrupt (see Adafruit_I2CAsync.h) with a repeated START between the
+ *    write and the read, and has no maxBufferSize() limit. Platforms without
+ *    the asynchronous engine run a blocking write_then_read() instead.
+ *    @param  write_buffer Pointer to buffer of data to write from. Up to
+ *            I2C_ASYNC_INLINE bytes are copied, longer buffers must stay
+ *            valid until the transaction has finished.
+ *    @param  write_len Number of bytes from buffer to write.
+ *    @param  read_buffer Pointer to buffer of data to read into, valid once
+ *            the transaction is I2C_ASYNC_DONE.
+ *    @param  read_len Number of bytes from buffer to read.
+ *    @param  transaction Transaction state, must stay alive until it has
+ *            finished.
+ *    @param  callback Optional function called when the transaction has
+ *            finished (from the interrupt, keep it short).
+ *    @return True if the transaction was queued (or has completed).
+ */
+bool Adafruit_I2CDevice::write_then_read_async(
+    const uint8_t *write_buffer, size_t write_len, uint8_t *read_buffer,
+    size_t read_len, Adafruit_I2CTransaction &transaction,
+    busio_i2c_async_callback_t callback) {
+  transaction.addr = _addr;
+  transaction.write_len = write_len;
+  transaction.read_buffer = read_buffer;
+  transaction.read_len = read_len;
+  transaction.callback = callback;
+  if (write_len <= I2C_ASYNC_INLINE) {
+    for (size_t i = 0; i < write_len; i++) {
+      transaction.inline_data[i] = write_buffer[i];
+    }
+    transaction.write_buffer = transaction.inline_data;
+  } else {
+    transaction.write_buffer = write_buffer;
+  }
+
+#ifdef BUSIO_HAS_I2C_ASYNC
+  return I2CAsync.submit(&transaction);
+#else
+  bool ok = write_then_read(write_buffer, write_len, read_buffer, read_len);
+  transaction.state = ok ? I2C_ASYNC_DONE : I2C_ASYNC_FAILED;
+  if (callback) {
+    callback(&transaction);
+  }
+  return true;
+#endif
+}
+
+/*!
+ *    @brief  Wait for an asynchronous transaction to finish.
+ *    @param  transaction A transaction started with write_then_read_async()
+ *    @return True if the transaction completed successfully.
+ */
+bool Adafruit_I2CDevice::wait(Adafruit_I2CTransaction &transaction) {
+#ifdef BUSIO_HAS_I2C_ASYNC
+  return I2CAsync.wait(&transaction);
+#else
+  return transaction.state == I2C_ASYNC_DONE;
+#endif
+}
+
 /*!
  *    @brief  Returns the 7-bit address of this device
  *    @return The 7-bit address of this device
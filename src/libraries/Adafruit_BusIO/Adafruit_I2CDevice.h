@@ -1,6 +1,7 @@
 #ifndef Adafruit_I2CDevice_h
 #define Adafruit_I2CDevice_h
 
+#include <Adafruit_I2CAsync.h>
 #include <Arduino.h>
 #include <Wire.h>
 
@@ -19,9 +20,16 @@ public:
   bool write_then_read(const uint8_t *write_buffer, size_t write_len,
                        uint8_t *read_buffer, size_t read_len,
                        bool stop = false);
+  bool write_then_read_async(const uint8_t *write_buffer, size_t write_len,
+                             uint8_t *read_buffer, size_t read_len,
+                             Adafruit_I2CTransaction &transaction,
+                             busio_i2c_async_callback_t callback = nullptr);
+  bool wait(Adafruit_I2CTransaction &transaction);
   bool setSpeed(uint32_t desiredclk);
 
-  /*!   @brief  How many bytes we can read in a transaction
+  /*!   @brief  How many bytes we can read in a transaction. Reads that end
+   *    with a STOP bypass the Wire buffer where I2CAsync is available and
+   *    are not limited by it.
    *    @return The size of the Wire receive/transmit buffer */
   size_t maxBufferSize() { return _maxBufferSize; }
 
@@ -31,6 +39,8 @@ private:
   bool _begun;
   size_t _maxBufferSize;
   bool _read(uint8_t *buffer, size_t len, bool stop);
+  bool _transfer(const uint8_t *write_buffer, size_t write_len,
+                 uint8_t *read_buffer, size_t read_len);
 };
 
 #endif // Adafruit_I2CDevice_h
@@ -0,0 +1,195 @@
+#ifndef Adafruit_SoftSPI_h
+#define Adafruit_SoftSPI_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * @brief A software SPI pin on a fixed port bit.
+ *
+ * Port provides set(mask) and clear(mask) for the output register, in()
+ * returning the input register and dir() the direction register. With the
+ * port and bit known at compile time every access compiles to a single bit
+ * instruction (sbi/cbi/sbic on AVR), instead of the load-modify-store
+ * through a port pointer of Adafruit_SPIDevice.
+ */
+template <class Port, uint8_t Bit> struct Adafruit_SoftSPIPin {
+  static const bool present = true; ///< Pin is wired
+
+  /*! @brief Make the pin an output */
+  static inline void output() { Port::dir() |= (uint8_t)(1 << Bit); }
+  /*! @brief Make the pin an input */
+  static inline void input() { Port::dir() &= (uint8_t)~(1 << Bit); }
+  /*! @brief Drive the pin high */
+  static inline void high() { Port::set((uint8_t)(1 << Bit)); }
+  /*! @brief Drive the pin low */
+  static inline void low() { Port::clear((uint8_t)(1 << Bit)); }
+  /*! @brief Drive the pin
+   *  @param v Level */
+  static inline void write(bool v) {
+    if (v)
+      high();
+    else
+      low();
+  }
+  /*! @brief Read the pin
+   *  @return True if high */
+  static inline bool read() { return Port::in() & (uint8_t)(1 << Bit); }
+};
+
+/*!
+ * @brief Placeholder for an unused MOSI or MISO line, all accesses vanish.
+ */
+struct Adafruit_SoftSPINoPin {
+  static const bool present = false; ///< Pin is not wired
+  static inline void output() {}     ///< No-op
+  static inline void input() {}      ///< No-op
+  static inline void high() {}       ///< No-op
+  static inline void low() {}        ///< No-op
+  static inline void write(bool) {}  ///< No-op
+  static inline bool read() { return false; } ///< Reads as 0
+};
+
+/*!
+ * @brief Compile-time specialized software SPI master.
+ *
+ * Mode, bit order and the presence of MOSI/MISO are template parameters, so
+ * the per-bit decisions of Adafruit_SPIDevice::transfer() are resolved by
+ * the compiler and each byte is eight unrolled bit steps of direct port
+ * writes. The clock runs as fast as the CPU toggles the pins, use it for
+ * devices that accept that rate (chip select is left to the caller).
+ *
+ * @tparam SCK Clock pin (Adafruit_SoftSPIPin)
+ * @tparam MOSI Data out pin, or Adafruit_SoftSPINoPin
+ * @tparam MISO Data in pin, or Adafruit_SoftSPINoPin
+ * @tparam Mode SPI_MODE0 .. SPI_MODE3
+ * @tparam LSBFirst True for least significant bit first
+ */
+template <class SCK, class MOSI, class MISO, uint8_t Mode = 0,
+          bool LSBFirst = false>
+class Adafruit_SoftSPI {
+public:
+  /*!
+   * @brief Configure the pins and put the clock at its idle level
+   */
+  static void begin() {
+    SCK::output();
+    SCK::write(cpol);
+    MOSI::output();
+    MOSI::high();
+    MISO::input();
+  }
+
+  /*!
+   * @brief  Send and receive one byte
+   * @param  out The byte to send
+   * @return The byte received
+   */
+  static inline uint8_t transfer(uint8_t out) {
+    uint8_t in = 0;
+    bit<0>(out, in);
+    bit<1>(out, in);
+    bit<2>(out, in);
+    bit<3>(out, in);
+    bit<4>(out, in);
+    bit<5>(out, in);
+    bit<6>(out, in);
+    bit<7>(out, in);
+    return in;
+  }
+
+  /*!
+   * @brief  Send a buffer and replace it with the received bytes
+   * @param  buffer The bytes to send, then the bytes received
+   * @param  len Number of bytes
+   */
+  static void transfer(uint8_t *buffer, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+      uint8_t in = transfer(buffer[i]);
+      if (MISO::present)
+        buffer[i] = in;
+    }
+  }
+
+  /*!
+   * @brief  Send a buffer, ignoring MISO
+   * @param  buffer The bytes to send
+   * @param  len Number of bytes
+   */
+  static void write(const uint8_t *buffer, size_t len) {
+    for (size_t i = 0; i < len; i++)
+      Adafruit_SoftSPI<SCK, MOSI, Adafruit_SoftSPINoPin, Mode,
+                       LSBFirst>::transfer(buffer[i]);
+  }
+
+  /*!
+   * @brief  Receive into a buffer
+   * @param  buffer Destination
+   * @param  len Number of bytes
+   * @param  sendvalue Byte sent while reading
+   */
+  static void read(uint8_t *buffer, size_t len, uint8_t sendvalue = 0xFF) {
+    for (size_t i = 0; i < len; i++)
+      buffer[i] = transfer(sendvalue);
+  }
+
+private:
+  // SPI_MODE0..3 differ between cores (0..3 or 0x00/0x04/0x08/0x0C), both
+  // encode CPOL and CPHA in the same relative order
+  static const uint8_t modeIndex = Mode > 3 ? Mode >> 2 : Mode;
+  static const bool cpol = modeIndex & 0x02; ///< Clock idles high
+  static const bool cpha = modeIndex & 0x01; ///< Sample on the trailing edge
+
+  template <uint8_t N> static inline void bit(uint8_t out, uint8_t &in) {
+    const uint8_t mask = LSBFirst ? (uint8_t)(1 << N) : (uint8_t)(0x80 >> N);
+    if (!cpha) {
+      // Data valid before the leading edge, sampled on it
+      MOSI::write(out & mask);
+      SCK::write(!cpol);
+      if (MISO::read())
+        in |= mask;
+      SCK::write(cpol);
+    } else {
+      // Data changes on the leading edge, sampled on the trailing edge
+      SCK::write(!cpol);
+      MOSI::write(out & mask);
+      SCK::write(cpol);
+      if (MISO::read())
+        in |= mask;
+    }
+  }
+};
+
+#if defined(__AVR__)
+#include <avr/io.h>
+
+/*! Define Adafruit_SoftSPIPort\<name\> (e.g. Adafruit_SoftSPIPortB) for an AVR I/O port */
+#define BUSIO_AVR_SOFTSPI_PORT(name)                                           \
+  struct Adafruit_SoftSPIPort##name {                                          \
+    static inline void set(uint8_t mask) { PORT##name |= mask; }               \
+    static inline void clear(uint8_t mask) { PORT##name &= ~mask; }            \
+    static inline volatile uint8_t &in() { return PIN##name; }                 \
+    static inline volatile uint8_t &dir() { return DDR##name; }                \
+  };
+
+#ifdef PORTA
+BUSIO_AVR_SOFTSPI_PORT(A)
+#endif
+#ifdef PORTB
+BUSIO_AVR_SOFTSPI_PORT(B)
+#endif
+#ifdef PORTC
+BUSIO_AVR_SOFTSPI_PORT(C)
+#endif
+#ifdef PORTD
+BUSIO_AVR_SOFTSPI_PORT(D)
+#endif
+#ifdef PORTE
+BUSIO_AVR_SOFTSPI_PORT(E)
+#endif
+#ifdef PORTF
+BUSIO_AVR_SOFTSPI_PORT(F)
+#endif
+#endif // __AVR__
+
+#endif // Adafruit_SoftSPI_h
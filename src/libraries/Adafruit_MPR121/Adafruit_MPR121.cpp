@@ -56,6 +56,11 @@ bool Adafruit_MPR121::begin(uint8_t i2caddr, TwoWire *theWire,
     delete i2c_dev;
   }
   i2c_dev = new Adafruit_I2CDevice(i2caddr, theWire);
+  if (ecr_reg) {
+    delete ecr_reg;
+  }
+  ecr_reg = new Adafruit_BusIO_Register(i2c_dev, MPR121_ECR, 1);
+  ecr_reg->setShadow(true);
 
   if (!i2c_dev->begin()) {
     return false;
@@ -150,17 +155,77 @@ void Adafruit_MPR121::setThresholds(uint8_t touch, uint8_t release) {
   }
 }
 
+/*!
+ *  @brief      Enable the proximity channel: the selected electrodes are
+ *              measured together as a 13th electrode (channel 12), which
+ *              detects an approaching hand further away than a single pad.
+ *              Its status is one bit of the touch status register, so it
+ *              makes a cheap wake-up detector. The larger combined
+ *              capacitance uses the global charge settings, pick a smaller
+ *              group if filteredData(12) saturates.
+ *  @param      electrodes
+ *              the electrodes to combine, or MPR121_PROX_OFF
+ *  @param      touch
+ *              the proximity touch threshold value from 0 to 255.
+ *  @param      release
+ *              the proximity release threshold from 0 to 255.
+ */
+void Adafruit_MPR121::setProximity(mpr121_proximity_t electrodes,
+                                   uint8_t touch, uint8_t release) {
+  // Slow baseline tracking so a hand approaching over a few hundred ms is not
+  // absorbed into the baseline (AN3893)
+  writeRegister(MPR121_MHDPROXR, 0xFF);
+  writeRegister(MPR121_NHDPROXR, 0xFF);
+  writeRegister(MPR121_NCLPROXR, 0x00);
+  writeRegister(MPR121_FDLPROXR, 0x00);
+
+  writeRegister(MPR121_MHDPROXF, 0x01);
+  writeRegister(MPR121_NHDPROXF, 0x01);
+  writeRegister(MPR121_NCLPROXF, 0xFF);
+  writeRegister(MPR121_FDLPROXF, 0xFF);
+
+  writeRegister(MPR121_NHDPROXT, 0x00);
+  writeRegister(MPR121_NCLPROXT, 0x00);
+  writeRegister(MPR121_FDLPROXT, 0x00);
+
+  writeRegister(MPR121_PROXTOUCHTH, touch);
+  writeRegister(MPR121_PROXRELEASETH, release);
+
+  // ELEPROX_EN are bits 5:4 of ECR, keep baseline tracking and electrodes
+  uint8_t ecr = ecr_reg->readShadow();
+  writeRegister(MPR121_ECR, (ecr & ~0x30) | ((electrodes & 0x03) << 4));
+}
+
+/*!
+ *  @brief      Read which electrodes form the proximity channel
+ *  @returns    the electrode group, MPR121_PROX_OFF if disabled
+ */
+mpr121_proximity_t Adafruit_MPR121::proximityElectrodes(void) {
+  return (mpr121_proximity_t)((ecr_reg->readShadow() >> 4) & 0x03);
+}
+
+/*!
+ *  @brief      Read the proximity status, a single register read.
+ *  @returns    true if the proximity channel detects a hand
+ */
+bool Adafruit_MPR121::proximity(void) {
+  return readRegister8(MPR121_TOUCHSTATUS_H) & (MPR121_PROXIMITY_BIT >> 8);
+}
+
 /*!
  *  @brief      Read the filtered data from channel t. The ADC raw data outputs
  *              run through 3 levels of digital filtering to filter out the high
  * frequency and low frequency noise encountered. For detailed information on
  * this filtering see page 6 of the device datasheet.
  *  @param      t
- *              the channel to read
- *  @returns    the filtered reading as a 10 bit unsigned value
+ *              the channel to read, 12 is the proximity channel (see
+ *              setProximity())
+ *  @returns    the filtered reading as a 10 bit unsigned value, 0 for the
+ *              proximity channel while it is disabled
  */
 uint16_t Adafruit_MPR121::filteredData(uint8_t t) {
-  if (t > 12)
+  if (t > 12 ||
+      (t == MPR121_PROXIMITY_CHANNEL && proximityElectrodes() == MPR121_PROX_OFF))
     return 0;
   return readRegister16(MPR121_FILTDATA_0L + t * 2);
 }
@@ -170,11 +235,13 @@ uint16_t Adafruit_MPR121::filteredData(uint8_t t) {
  *              result is internally 10bit but only high 8 bits are readable
  * from registers 0x1E~0x2A as the baseline value output for each channel.
  *  @param      t
- *              the channel to read.
- *  @returns    the baseline data that was read
+ *              the channel to read, 12 is the proximity channel
+ *  @returns    the baseline data that was read, 0 for the proximity
+ *              channel while it is disabled
  */
 uint16_t Adafruit_MPR121::baselineData(uint8_t t) {
-  if (t > 12)
+  if (t > 12 ||
+      (t == MPR121_PROXIMITY_CHANNEL && proximityElectrodes() == MPR121_PROX_OFF))
     return 0;
   uint16_t bl = readRegister8(MPR121_BASELINE_0 + t);
   return (bl << 2);
@@ -198,7 +265,8 @@ uint16_t Adafruit_MPR121::touched(void) {
  *  @returns    the 8 bit value that was read.
  */
 uint8_t Adafruit_MPR121::readRegister8(uint8_t reg) {
-  Adafruit_BusIO_Register thereg = Adafruit_BusIO_Register(i2c_dev, reg, 1);
+  Adafruit_BusIO_RegisterT<Adafruit_I2CTransport> thereg(
+      Adafruit_I2CTransport(i2c_dev), reg);
 
   return (thereg.read());
 }
@@ -209,40 +277,77 @@ uint8_t Adafruit_MPR121::readRegister8(uint8_t reg) {
  *  @returns    the 16 bit value that was read.
  */
 uint16_t Adafruit_MPR121::readRegister16(uint8_t reg) {
-  Adafruit_BusIO_Register thereg =
-      Adafruit_BusIO_Register(i2c_dev, reg, 2, LSBFIRST);
+  Adafruit_BusIO_RegisterT<Adafruit_I2CTransport, 2, LSBFIRST> thereg(
+      Adafruit_I2CTransport(i2c_dev), reg);
 
   return (thereg.read());
 }
 
+/*!
+ *  @brief      Start reading consecutive registers without waiting for the
+ *              bus, see Adafruit_I2CDevice::write_then_read_async().
+ *  @param      reg the first register address to read from
+ *  @param      buffer destination, valid once the transaction is done
+ *  @param      len number of registers to read
+ *  @param      transaction transaction state, must stay alive until done
+ *  @returns    true if the read was started.
+ */
+bool Adafruit_MPR121::readRegistersAsync(uint8_t reg, uint8_t *buffer,
+                                         uint8_t len,
+                                         Adafruit_I2CTransaction &transaction) {
+  return i2c_dev->write_then_read_async(&reg, 1, buffer, len, transaction);
+}
+
+/*!
+ *  @brief      Wait for a read started with readRegistersAsync().
+ *  @param      transaction the transaction of the read
+ *  @returns    true if the read completed successfully.
+ */
+bool Adafruit_MPR121::wait(Adafruit_I2CTransaction &transaction) {
+  return i2c_dev->wait(transaction);
+}
+
 /*!
     @brief  Writes 8-bits to the specified destination register
     @param  reg the register address to write to
     @param  value the value to write
+    @param  keep_baselines restart with CL=00, so the electrodes keep their
+            baselines instead of loading them from the current data. A key
+            touched during the write stays touched. The ECR keeps CL=00
+            afterwards, so later restarts keep the baselines too.
 */
-void Adafruit_MPR121::writeRegister(uint8_t reg, uint8_t value) {
+void Adafruit_MPR121::writeRegister(uint8_t reg, uint8_t value,
+                                    bool keep_baselines) {
   // MPR121 must be put in Stop Mode to write to most registers
   bool stop_required = true;
 
-  // first get the current set value of the MPR121_ECR register
-  Adafruit_BusIO_Register ecr_reg =
-      Adafruit_BusIO_Register(i2c_dev, MPR121_ECR, 1);
+  if (reg == MPR121_ECR) {
+    // Through the shadow, so it stays in sync
+    ecr_reg->write(value);
+    return;
+  }
 
-  uint8_t ecr_backup = ecr_reg.read();
-  if ((reg == MPR121_ECR) || ((0x73 <= reg) && (reg <= 0x7A))) {
+  // first get the current set value of the MPR121_ECR register
+  // (shadowed: only read from the bus the first time)
+  uint8_t ecr_backup = ecr_reg->readShadow();
+  if ((0x73 <= reg) && (reg <= 0x7A)) {
     stop_required = false;
   }
 
   if (stop_required) {
     // clear this register to set stop mode
-    ecr_reg.write(0x00);
+    ecr_reg->write(0x00);
   }
 
-  Adafruit_BusIO_Register the_reg = Adafruit_BusIO_Register(i2c_dev, reg, 1);
+  Adafruit_BusIO_RegisterT<Adafruit_I2CTransport> the_reg(
+      Adafruit_I2CTransport(i2c_dev), reg);
   the_reg.write(value);
 
   if (stop_required) {
     // write back the previous set ECR settings
-    ecr_reg.write(ecr_backup);
+    if (keep_baselines) {
+      ecr_backup &= ~MPR121_ECR_CL_MASK;
+    }
+    ecr_reg->write(ecr_backup);
   }
 }
@@ -23,13 +23,18 @@
 #define ADAFRUIT_MPR121_H
 
 #include "Arduino.h"
-#include <Adafruit_BusIO_Register.h>
+#include <Adafruit_BusIO_RegisterT.h>
 #include <Adafruit_I2CDevice.h>
 
 // The default I2C address
 #define MPR121_I2CADDR_DEFAULT 0x5A        ///< default I2C address
 #define MPR121_TOUCH_THRESHOLD_DEFAULT 12  ///< default touch threshold value
 #define MPR121_RELEASE_THRESHOLD_DEFAULT 6 ///< default relese threshold value
+#define MPR121_PROX_TOUCH_THRESHOLD_DEFAULT 6 ///< default proximity touch
+#define MPR121_PROX_RELEASE_THRESHOLD_DEFAULT 3 ///< default proximity release
+#define MPR121_PROXIMITY_CHANNEL 12    ///< channel of the proximity electrode
+#define MPR121_PROXIMITY_BIT 0x1000    ///< proximity bit of the touch status
+#define MPR121_ECR_CL_MASK 0xC0        ///< ECR calibration lock (baseline load)
 
 /*!
  *  Device register map
@@ -51,9 +56,22 @@ enum {
   MPR121_NHDT = 0x33,
   MPR121_NCLT = 0x34,
   MPR121_FDLT = 0x35,
+  MPR121_MHDPROXR = 0x36,
+  MPR121_NHDPROXR = 0x37,
+  MPR121_NCLPROXR = 0x38,
+  MPR121_FDLPROXR = 0x39,
+  MPR121_MHDPROXF = 0x3A,
+  MPR121_NHDPROXF = 0x3B,
+  MPR121_NCLPROXF = 0x3C,
+  MPR121_FDLPROXF = 0x3D,
+  MPR121_NHDPROXT = 0x3E,
+  MPR121_NCLPROXT = 0x3F,
+  MPR121_FDLPROXT = 0x40,
 
   MPR121_TOUCHTH_0 = 0x41,
   MPR121_RELEASETH_0 = 0x42,
+  MPR121_PROXTOUCHTH = 0x59,
+  MPR121_PROXRELEASETH = 0x5A,
   MPR121_DEBOUNCE = 0x5B,
   MPR121_CONFIG1 = 0x5C,
   MPR121_CONFIG2 = 0x5D,
@@ -77,6 +95,16 @@ enum {
 
 //.. thru to 0x1C/0x1D
 
+/*!
+ *  Electrodes combined into the proximity channel (ECR ELEPROX_EN)
+ */
+typedef enum {
+  MPR121_PROX_OFF = 0,     ///< proximity channel disabled
+  MPR121_PROX_ELE0_1 = 1,  ///< ELE0 and ELE1
+  MPR121_PROX_ELE0_3 = 2,  ///< ELE0 to ELE3
+  MPR121_PROX_ELE0_11 = 3, ///< all twelve electrodes
+} mpr121_proximity_t;
+
 /*!
  *  @brief  Class that stores state and functions for interacting with MPR121
  *  proximity capacitive touch sensor controller.
@@ -95,15 +123,25 @@ public:
 
   uint8_t readRegister8(uint8_t reg);
   uint16_t readRegister16(uint8_t reg);
-  void writeRegister(uint8_t reg, uint8_t value);
+  void writeRegister(uint8_t reg, uint8_t value, bool keep_baselines = false);
   uint16_t touched(void);
+  bool readRegistersAsync(uint8_t reg, uint8_t *buffer, uint8_t len,
+                          Adafruit_I2CTransaction &transaction);
+  bool wait(Adafruit_I2CTransaction &transaction);
   // Add deprecated attribute so that the compiler shows a warning
   void setThreshholds(uint8_t touch, uint8_t release)
       __attribute__((deprecated));
   void setThresholds(uint8_t touch, uint8_t release);
+  void setProximity(
+      mpr121_proximity_t electrodes,
+      uint8_t touch = MPR121_PROX_TOUCH_THRESHOLD_DEFAULT,
+      uint8_t release = MPR121_PROX_RELEASE_THRESHOLD_DEFAULT);
+  mpr121_proximity_t proximityElectrodes(void);
+  bool proximity(void);
 
 private:
   Adafruit_I2CDevice *i2c_dev = NULL;
+  Adafruit_BusIO_Register *ecr_reg = NULL; ///< Shadowed, only we write ECR
 };
 
 #endif
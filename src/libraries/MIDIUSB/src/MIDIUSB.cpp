@@ -25,37 +25,77 @@
 #define MIDI_RX MIDI_ENDPOINT_OUT
 #define MIDI_TX MIDI_ENDPOINT_IN
 
-struct ring_bufferMIDI
-{
-	midiEventPacket_t midiEvent[MIDI_BUFFER_SIZE];
-	volatile uint32_t head;
-	volatile uint32_t tail;
-};
-
-ring_bufferMIDI midi_rx_buffer = {{0,0,0,0 }, 0, 0};
+SPSCRing<midiEventPacket_t, MIDI_RX_RING_SIZE> midi_rx_buffer;
 
 MIDI_ MidiUSB;
 
+uint8_t WEAK MIDI_cableCount(void)
+{
+	return 1;
+}
+
+// Sends one part of the interface descriptor, adds its length to total
+static bool sendDescriptor(int &total, const void *d, int len)
+{
+	int r = USB_SendControl(0, d, len);
+	if (r < 0)
+		return false;
+	total += r;
+	return true;
+}
+
 int MIDI_::getInterface(uint8_t* interfaceNum)
 {
 	interfaceNum[0] += 2;	// uses 2 interfaces
+	uint8_t cables = MIDI_cableCount();
+	if (cables < 1)
+		cables = 1;
+	if (cables > MIDI_MAX_CABLES)
+		cables = MIDI_MAX_CABLES;
+
 	MIDIDescriptor _midiInterface =
 	{
 		D_IAD(MIDI_AC_INTERFACE, 2, MIDI_AUDIO, MIDI_AUDIO_CONTROL, 0),
 		D_INTERFACE(MIDI_AC_INTERFACE,0,MIDI_AUDIO,MIDI_AUDIO_CONTROL,0),
 		D_AC_INTERFACE(0x1, MIDI_INTERFACE),
 		D_INTERFACE(MIDI_INTERFACE,2, MIDI_AUDIO,MIDI_STREAMING,0),
-		D_AS_INTERFACE,
-		D_MIDI_INJACK(MIDI_JACK_EMD, 0x1),
-		D_MIDI_INJACK(MIDI_JACK_EXT, 0x2),
-		D_MIDI_OUTJACK(MIDI_JACK_EMD, 0x3, 1, 2, 1),
-		D_MIDI_OUTJACK(MIDI_JACK_EXT, 0x4, 1, 1, 1),
-		D_MIDI_JACK_EP(USB_ENDPOINT_OUT(MIDI_ENDPOINT_OUT),USB_ENDPOINT_TYPE_BULK,MIDI_BUFFER_SIZE),
-		D_MIDI_AC_JACK_EP(1, 1),
-		D_MIDI_JACK_EP(USB_ENDPOINT_IN(MIDI_ENDPOINT_IN),USB_ENDPOINT_TYPE_BULK,MIDI_BUFFER_SIZE),
-		D_MIDI_AC_JACK_EP (1, 3)
+		D_AS_INTERFACE(MIDI_AS_TOTAL_LENGTH(cables))
 	};
-	return USB_SendControl(0, &_midiInterface, sizeof(_midiInterface));
+	int total = 0;
+	if (!sendDescriptor(total, &_midiInterface, sizeof(_midiInterface)))
+		return -1;
+
+	// Cable n uses jacks 4n+1 (embedded IN) to 4n+4, so one cable gives the
+	// same descriptor as before
+	uint8_t embIn[MIDI_MAX_CABLES], embOut[MIDI_MAX_CABLES];
+	for (uint8_t n = 0; n < cables; n++) {
+		uint8_t id = 4 * n;
+		MIDICableDescriptor _cable =
+		{
+			D_MIDI_INJACK(MIDI_JACK_EMD, id + 1),
+			D_MIDI_INJACK(MIDI_JACK_EXT, id + 2),
+			D_MIDI_OUTJACK(MIDI_JACK_EMD, id + 3, 1, id + 2, 1),
+			D_MIDI_OUTJACK(MIDI_JACK_EXT, id + 4, 1, id + 1, 1)
+		};
+		if (!sendDescriptor(total, &_cable, sizeof(_cable)))
+			return -1;
+		embIn[n] = id + 1;
+		embOut[n] = id + 3;
+	}
+
+	// Both endpoints carry all cables, listed in cable number order
+	MIDI_EPDescriptor _out = D_MIDI_JACK_EP(USB_ENDPOINT_OUT(MIDI_ENDPOINT_OUT),USB_ENDPOINT_TYPE_BULK,MIDI_BUFFER_SIZE);
+	MIDI_EP_ACDescriptor _outSPC = D_MIDI_AC_JACK_EP(cables);
+	MIDI_EPDescriptor _in = D_MIDI_JACK_EP(USB_ENDPOINT_IN(MIDI_ENDPOINT_IN),USB_ENDPOINT_TYPE_BULK,MIDI_BUFFER_SIZE);
+	MIDI_EP_ACDescriptor _inSPC = D_MIDI_AC_JACK_EP(cables);
+	if (!sendDescriptor(total, &_out, sizeof(_out)) ||
+		!sendDescriptor(total, &_outSPC, sizeof(_outSPC)) ||
+		!sendDescriptor(total, embIn, cables) ||
+		!sendDescriptor(total, &_in, sizeof(_in)) ||
+		!sendDescriptor(total, &_inSPC, sizeof(_inSPC)) ||
+		!sendDescriptor(total, embOut, cables))
+		return -1;
+	return total;
 }
 
 bool MIDI_::setup(USBSetup& setup __attribute__((unused)))
@@ -77,68 +117,58 @@ uint8_t MIDI_::getShortName(char* name)
 
 void MIDI_::accept(void)
 {
-	ring_bufferMIDI *buffer = &midi_rx_buffer;
-	uint32_t i = (uint32_t)(buffer->head+1) % MIDI_BUFFER_SIZE;
-
-	// if we should be storing the received character into the location
-	// just before the tail (meaning that the head would advance to the
-	// current location of the tail), we're about to overflow the buffer
-	// and so we don't write the character or advance the head.
-	while (i != buffer->tail) {
-		int c;
-		midiEventPacket_t event;
+	// Receive straight into the free ring slots. This takes one USB_Recv
+	// unless the free space wraps around the end of the ring. If the ring
+	// is full, packets stay in the endpoint until the next read makes room.
+	for (uint8_t pass = 0; pass < 2; pass++) {
+		midiEventPacket_t *slots;
+		uint8_t room = midi_rx_buffer.writeSpan(slots);
+		if (room == 0)
+			return;
 		if (!USB_Available(MIDI_RX)) {
 #if defined(ARDUINO_ARCH_SAM)
 			udd_ack_fifocon(MIDI_RX);
 #endif
-			//break;
+			return;
 		}
-		c = USB_Recv(MIDI_RX, &event, sizeof(event) );
+		int c = USB_Recv(MIDI_RX, slots, room * sizeof(midiEventPacket_t));
 
-		//MIDI packet has to be 4 bytes
-		if(c < 4)
+		//MIDI packets have to be 4 bytes
+		if (c < (int)sizeof(midiEventPacket_t))
 			return;
-		buffer->midiEvent[buffer->head] = event;
-		buffer->head = i;
-
-		i = (i + 1) % MIDI_BUFFER_SIZE;
+		midi_rx_buffer.commit(c / sizeof(midiEventPacket_t));
 	}
 }
 
 uint32_t MIDI_::available(void)
 {
-	
-	ring_bufferMIDI *buffer = &midi_rx_buffer;
-	return (uint32_t)(MIDI_BUFFER_SIZE + buffer->head - buffer->tail) % MIDI_BUFFER_SIZE;
+	if (midi_rx_buffer.empty()) {
+		accept();
+	}
+	return midi_rx_buffer.available();
 }
 
 
 midiEventPacket_t MIDI_::read(void)
 {
-        midiEventPacket_t c;
-	ring_bufferMIDI   *buffer = &midi_rx_buffer;
-
-	if(((uint32_t)(MIDI_BUFFER_SIZE + buffer->head - buffer->tail) % MIDI_BUFFER_SIZE) > 0) {
-	    c = buffer->midiEvent[buffer->tail];
-	} else {
-            if (USB_Available(MIDI_RX)) {
-	        accept();
-	        c = buffer->midiEvent[buffer->tail];
-	    } else {
-	        c.header = 0;
-	        c.byte1 = 0;
-	        c.byte2 = 0;
-	        c.byte3 = 0;
-	    }
-	}
-	// if the head isn't ahead of the tail, we don't have any characters
-	if (buffer->head != buffer->tail)
-	{
-		buffer->tail = (uint32_t)(buffer->tail + 1) % MIDI_BUFFER_SIZE;
+	midiEventPacket_t c = {0, 0, 0, 0};
+
+	if (midi_rx_buffer.empty()) {
+		accept();
 	}
+	// leaves c zeroed if nothing was received
+	midi_rx_buffer.pop(c);
 	return c;
 }
 
+uint8_t MIDI_::readMany(midiEventPacket_t *events, uint8_t count)
+{
+	if (midi_rx_buffer.available() < count) {
+		accept();
+	}
+	return midi_rx_buffer.popMany(events, count);
+}
+
 void MIDI_::flush(void)
 {
 	USB_Flush(MIDI_TX);
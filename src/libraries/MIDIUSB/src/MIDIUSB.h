@@ -19,6 +19,7 @@
 #endif
 
 #include "MIDIUSB_Defs.h"
+#include "MIDIUSB_Ring.h"
 
 #if defined(ARDUINO_ARCH_AVR)
 
@@ -79,6 +80,14 @@
 
 #endif
 
+/// Number of MIDI events buffered on RX (power of two, at most 128)
+#ifndef MIDI_RX_RING_SIZE
+#define MIDI_RX_RING_SIZE						64
+#endif
+
+/// Most virtual cables (MIDI ports) one interface can announce, \see MIDI_cableCount()
+#define MIDI_MAX_CABLES							16
+
 #define MIDI_AUDIO								0x01
 #define MIDI_AUDIO_CONTROL						0x01
 #define MIDI_CS_INTERFACE						0x24
@@ -132,13 +141,13 @@ typedef struct
 } MIDI_EPDescriptor;
 
 /// MIDI Jack  EndPoint AudioControl Descriptor, common to midi in and out ac jacks.
+/// Followed by the IDs of its embJacks embedded jacks, one per cable.
 typedef struct
 {
-	uint8_t len;		// 5
-	uint8_t dtype;		// 0x24
+	uint8_t len;		// 4 + embJacks
+	uint8_t dtype;		// 0x25
 	uint8_t subtype;
 	uint8_t embJacks;
-	uint8_t jackID;
 } MIDI_EP_ACDescriptor;
 
 /// MIDI Audio Stream Descriptor Interface
@@ -151,7 +160,8 @@ typedef struct
 	uint16_t wTotalLength;
 } MIDI_ASInterfaceDescriptor;
 
-/// Top Level MIDI Descriptor used to create a Midi Interface instace \see MIDI_::getInterface()
+/// Top Level MIDI Descriptor used to create a Midi Interface instace, followed by
+/// one MIDICableDescriptor per cable and the endpoints \see MIDI_::getInterface()
 typedef struct
 {
 	//	IAD
@@ -163,23 +173,27 @@ typedef struct
 	// MIDI Audio Streaming Interface
 	InterfaceDescriptor                Audio_StreamInterface;
 	MIDI_ASInterfaceDescriptor         Audio_StreamInterface_SPC;
+} MIDIDescriptor;
 
+/// Jacks of one virtual cable: host OUT port -> embedded IN jack, embedded OUT jack -> host IN port
+typedef struct
+{
 	MIDIJackinDescriptor               MIDI_In_Jack_Emb;
 	MIDIJackinDescriptor               MIDI_In_Jack_Ext;
 	MIDIJackOutDescriptor              MIDI_Out_Jack_Emb;
 	MIDIJackOutDescriptor              MIDI_Out_Jack_Ext;
+} MIDICableDescriptor;
 
-	MIDI_EPDescriptor                  MIDI_In_Jack_Endpoint;
-	MIDI_EP_ACDescriptor               MIDI_In_Jack_Endpoint_SPC;
-	MIDI_EPDescriptor                  MIDI_Out_Jack_Endpoint;
-	MIDI_EP_ACDescriptor               MIDI_Out_Jack_Endpoint_SPC;
-} MIDIDescriptor;
+/// Length of the class specific audio streaming descriptors announcing _cables cables
+#define MIDI_AS_TOTAL_LENGTH(_cables) \
+	(sizeof(MIDI_ASInterfaceDescriptor) + (_cables) * sizeof(MIDICableDescriptor) + \
+	 2 * (sizeof(MIDI_EPDescriptor) + sizeof(MIDI_EP_ACDescriptor) + (_cables)))
 
 #define D_AC_INTERFACE(_streamingInterfaces, _MIDIInterface) \
 	{ 9, MIDI_CS_INTERFACE, 0x1, 0x0100, 0x0009, _streamingInterfaces, (uint8_t)(_MIDIInterface) }
 
-#define D_AS_INTERFACE \
-	{ 0x7, MIDI_CS_INTERFACE, 0x01,0x0100, 0x0041}
+#define D_AS_INTERFACE(_totalLength) \
+	{ 0x7, MIDI_CS_INTERFACE, 0x01,0x0100, (uint16_t)(_totalLength)}
 
 #define D_MIDI_INJACK(jackProp, _jackID) \
 	{ 0x06, MIDI_CS_INTERFACE, 0x02, jackProp, _jackID, 0  }
@@ -190,8 +204,8 @@ typedef struct
 #define D_MIDI_JACK_EP(_addr,_attr,_packetSize) \
 	{ 9, 5, _addr,_attr,_packetSize, 0, 0, 0}
 
-#define D_MIDI_AC_JACK_EP(_nMIDI, _iDMIDI) \
-	{ 5, MIDI_CS_ENDPOINT, 0x1, _nMIDI, _iDMIDI}
+#define D_MIDI_AC_JACK_EP(_nMIDI) \
+	{ (uint8_t)(4 + (_nMIDI)), MIDI_CS_ENDPOINT, 0x1, _nMIDI}
 
 #define D_CDCCS(_subtype,_d0,_d1)	{ 5, 0x24, _subtype, _d0, _d1 }
 #define D_CDCCS4(_subtype,_d0)		{ 4, 0x24, _subtype, _d0 }
@@ -204,6 +218,11 @@ _Pragma("pack()")
 
 #endif
 
+/// Number of virtual cables announced to the host, 1 to MIDI_MAX_CABLES. The
+/// default announces one, define it in the sketch to get more MIDI ports.
+/// The cable of an event is the high nibble of midiEventPacket_t::header.
+uint8_t MIDI_cableCount(void);
+
 /**
  	 Concrete MIDI implementation of a PluggableUSBModule
  	 By default, will define one midi in and one midi out enpoints.
@@ -232,10 +251,12 @@ protected:
 public:
 	/// Creates a MIDI USB device with 2 endpoints
 	MIDI_(void);
-	/// Returns the number of bytes currently available from RX
+	/// Returns the number of MIDI events currently available from RX
 	uint32_t available(void);
-	/// Reads a new MIDI message from USB
+	/// Reads a new MIDI message from USB, all fields are 0 if none is pending
 	midiEventPacket_t read(void);
+	/// Reads up to count MIDI messages into events, returns the number read. Never blocks.
+	uint8_t readMany(midiEventPacket_t *events, uint8_t count);
 	/// Flushes TX midi channel
 	void flush(void);
 	/// Sends a MIDI message to USB
@@ -0,0 +1,139 @@
+//================================================================================
+//================================================================================
+
+/**
+	Single-producer/single-consumer ring buffer
+*/
+#ifndef MIDIUSB_Ring_h
+#define MIDIUSB_Ring_h
+
+#include <stdint.h>
+
+/// Compiler barrier: keeps slot accesses on the correct side of an index update.
+/// Enough for an ISR and the loop on one core; multi-core hosts (the tests in
+/// tools/test) define a real fence before including this file.
+#ifndef SPSC_BARRIER
+#define SPSC_BARRIER() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/**
+	Lock-free ring buffer for one producer (e.g. an ISR) and one consumer (e.g. loop()).
+
+	N must be a power of two no larger than 128. Indices are free-running 8-bit
+	counters, so every load/store of them is a single atomic access on AVR and
+	wrapping is a mask instead of a division. The producer only writes head,
+	the consumer only writes tail; no interrupt masking is required.
+*/
+template <typename T, uint8_t N>
+class SPSCRing
+{
+	static_assert(N >= 2 && N <= 128 && (N & (N - 1)) == 0,
+		"SPSCRing size must be a power of two between 2 and 128");
+
+public:
+	SPSCRing(void) : head(0), tail(0) {}
+
+	/// Number of slots the ring can hold
+	static uint8_t capacity(void) { return N; }
+
+	/// Number of elements ready to be popped (consumer side)
+	uint8_t available(void) const { return (uint8_t)(head - tail); }
+
+	/// Number of free slots (producer side)
+	uint8_t space(void) const { return (uint8_t)(N - (uint8_t)(head - tail)); }
+
+	bool empty(void) const { return head == tail; }
+
+	/// Stores one element, returns false if the ring is full
+	bool push(const T &value)
+	{
+		uint8_t h = head;
+		if ((uint8_t)(h - tail) == N)
+			return false;
+		slots[h & (N - 1)] = value;
+		SPSC_BARRIER();
+		head = (uint8_t)(h + 1);
+		return true;
+	}
+
+	/// Removes the oldest element into value, returns false if the ring is empty
+	bool pop(T &value)
+	{
+		uint8_t t = tail;
+		if (t == head)
+			return false;
+		SPSC_BARRIER();
+		value = slots[t & (N - 1)];
+		SPSC_BARRIER();
+		tail = (uint8_t)(t + 1);
+		return true;
+	}
+
+	/// Copies the oldest element without removing it, returns false if empty
+	bool peek(T &value) const
+	{
+		uint8_t t = tail;
+		if (t == head)
+			return false;
+		SPSC_BARRIER();
+		value = slots[t & (N - 1)];
+		return true;
+	}
+
+	/// Stores up to count elements with a single head update, returns the number stored
+	uint8_t pushMany(const T *values, uint8_t count)
+	{
+		uint8_t h = head;
+		uint8_t free = (uint8_t)(N - (uint8_t)(h - tail));
+		if (count > free)
+			count = free;
+		for (uint8_t i = 0; i < count; i++)
+			slots[(uint8_t)(h + i) & (N - 1)] = values[i];
+		SPSC_BARRIER();
+		head = (uint8_t)(h + count);
+		return count;
+	}
+
+	/// Removes up to count elements with a single tail update, returns the number removed
+	uint8_t popMany(T *values, uint8_t count)
+	{
+		uint8_t t = tail;
+		uint8_t used = (uint8_t)(head - t);
+		if (count > used)
+			count = used;
+		SPSC_BARRIER();
+		for (uint8_t i = 0; i < count; i++)
+			values[i] = slots[(uint8_t)(t + i) & (N - 1)];
+		SPSC_BARRIER();
+		tail = (uint8_t)(t + count);
+		return count;
+	}
+
+	/// Contiguous free slots from the write position (producer side).
+	/// Fill up to the returned count through region, then publish them with commit().
+	uint8_t writeSpan(T *&region)
+	{
+		uint8_t h = head;
+		uint8_t free = (uint8_t)(N - (uint8_t)(h - tail));
+		uint8_t toEnd = (uint8_t)(N - (h & (N - 1)));
+		region = &slots[h & (N - 1)];
+		return free < toEnd ? free : toEnd;
+	}
+
+	/// Publishes count slots filled in place through writeSpan()
+	void commit(uint8_t count)
+	{
+		SPSC_BARRIER();
+		head = (uint8_t)(head + count);
+	}
+
+	/// Drops everything currently queued (consumer side)
+	void clear(void) { tail = head; }
+
+private:
+	T slots[N];
+	volatile uint8_t head;	///< Next slot to write, owned by the producer
+	volatile uint8_t tail;	///< Next slot to read, owned by the consumer
+};
+
+#endif	/* MIDIUSB_Ring_h */
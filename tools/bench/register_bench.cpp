@@ -0,0 +1,158 @@
+/* register_bench.cpp - Host benchmark of Adafruit_BusIO_RegisterT against
+   Adafruit_BusIO_Register
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Times register accesses through the runtime dispatched
+ * Adafruit_BusIO_Register and the statically dispatched
+ * Adafruit_BusIO_RegisterT on the same Adafruit_I2CDevice, whose bus calls
+ * are stubbed with a register file in memory (out of line, like the real
+ * ones). What is left is the register layer itself:
+ *  - a 16-bit write and read back, as the MPR121 helpers do;
+ *  - a 2-bit field write on an 8-bit register, plain and shadowed.
+ * Every access is checked against the register file, and the bus reads of
+ * the field writes are counted: shadowed, only the first one reads.
+ */
+
+#include <Adafruit_BusIO_Register.h>
+#include <Adafruit_BusIO_RegisterT.h>
+#include <chrono>
+#include <stdio.h>
+
+#define BENCH_ROUNDS 2000000UL
+#define REG_DATA 0x04  // 16-bit, like the MPR121 filtered data
+#define REG_CONFIG 0x5E  // 8-bit, like the MPR121 ECR
+
+static uint8_t regs[256];
+static unsigned long busReads = 0;
+
+// The bus calls the registers end in, on the register file
+Adafruit_I2CDevice::Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire)
+    : _addr(addr), _wire(theWire), _begun(true), _maxBufferSize(32) {}
+
+__attribute__((noinline)) bool
+Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool,
+                          const uint8_t *prefix_buffer, size_t prefix_len) {
+  if (prefix_len != 1) return false;
+  memcpy(regs + prefix_buffer[0], buffer, len);
+  return true;
+}
+
+__attribute__((noinline)) bool
+Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer, size_t write_len,
+                                    uint8_t *read_buffer, size_t read_len, bool) {
+  if (write_len != 1) return false;
+  memcpy(read_buffer, regs + write_buffer[0], read_len);
+  busReads++;
+  return true;
+}
+
+// Adafruit_BusIO_Register links against SPI too, the benchmark never uses it
+bool Adafruit_SPIDevice::write(const uint8_t *, size_t, const uint8_t *, size_t) {
+  return false;
+}
+
+bool Adafruit_SPIDevice::write_then_read(const uint8_t *, size_t, uint8_t *, size_t, uint8_t) {
+  return false;
+}
+
+static Adafruit_I2CDevice device(0x5A, nullptr);
+static bool ok = true;
+
+/**
+ * @brief Nanoseconds per round of an access function.
+ */
+template <typename F> static double timeRounds(F round) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t r = 0; r < BENCH_ROUNDS; r++) {
+    round(r);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / BENCH_ROUNDS;
+}
+
+/**
+ * @brief One row: both times and the ratio.
+ */
+static void report(const char *what, double runtime, double templated) {
+  printf("%-22s %8.2f  %8.2f  %5.2fx\n", what, runtime, templated, runtime / templated);
+}
+
+/**
+ * @brief 16-bit write and read back.
+ */
+static void benchWord() {
+  Adafruit_BusIO_Register runtime(&device, REG_DATA, 2, LSBFIRST);
+  double r = timeRounds([&](uint32_t i) {
+    runtime.write(i & 0xFFFF);
+    if (runtime.read() != (i & 0xFFFF)) ok = false;
+  });
+
+  Adafruit_BusIO_RegisterT<Adafruit_I2CTransport, 2, LSBFIRST> templated(
+      Adafruit_I2CTransport(&device), REG_DATA);
+  double t = timeRounds([&](uint32_t i) {
+    templated.write(i & 0xFFFF);
+    if (templated.read() != (i & 0xFFFF)) ok = false;
+  });
+  report("16-bit write+read", r, t);
+}
+
+/**
+ * @brief 2-bit field at bit 6 of an 8-bit register, the other bits kept.
+ */
+static void benchBits(bool shadow) {
+  regs[REG_CONFIG] = 0x0C;
+  Adafruit_BusIO_Register runtime(&device, REG_CONFIG);
+  runtime.setShadow(shadow);
+  Adafruit_BusIO_RegisterBits field(&runtime, 2, 6);
+  busReads = 0;
+  double r = timeRounds([&](uint32_t i) { field.write(i & 3); });
+  unsigned long runtimeReads = busReads;
+  if (regs[REG_CONFIG] != (0x0C | ((BENCH_ROUNDS - 1) & 3) << 6)) ok = false;
+
+  regs[REG_CONFIG] = 0x0C;
+  busReads = 0;
+  double t;
+  if (shadow) {
+    Adafruit_BusIO_RegisterT<Adafruit_I2CTransport, 1, LSBFIRST, 1, true> templated(
+        Adafruit_I2CTransport(&device), REG_CONFIG);
+    t = timeRounds([&](uint32_t i) { templated.writeBits<2, 6>(i & 3); });
+  } else {
+    Adafruit_BusIO_RegisterT<Adafruit_I2CTransport> templated(
+        Adafruit_I2CTransport(&device), REG_CONFIG);
+    t = timeRounds([&](uint32_t i) { templated.writeBits<2, 6>(i & 3); });
+  }
+  if (regs[REG_CONFIG] != (0x0C | ((BENCH_ROUNDS - 1) & 3) << 6)) ok = false;
+
+  // Shadowed, only the first write reads the register
+  unsigned long expected = shadow ? 1 : BENCH_ROUNDS;
+  if (runtimeReads != expected || busReads != expected) ok = false;
+  report(shadow ? "bits write, shadowed" : "bits write", r, t);
+  printf("%-22s %8lu  %8lu\n", "  bus reads", runtimeReads, busReads);
+}
+
+int main() {
+  printf("ns per access          Register  RegisterT  speedup\n");
+  benchWord();
+  benchBits(false);
+  benchBits(true);
+  printf("register file %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
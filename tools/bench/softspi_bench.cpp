@@ -0,0 +1,149 @@
+/* softspi_bench.cpp - Host benchmark of Adafruit_SoftSPI against Adafruit_SPIDevice
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Bit-bangs the same buffer through the software SPI loop of
+ * Adafruit_SPIDevice (built here with its port pointer I/O, the path AVR
+ * takes) and through Adafruit_SoftSPI, on one simulated port with MOSI
+ * looped back to MISO, in every mode and bit order. The loopback checks
+ * that both send and receive the right bits.
+ *
+ * Both write the port with the same volatile read-modify-write through a
+ * pointer, so the ratio is what the per-bit checks of the runtime loop
+ * cost. On AVR the SoftSPI pin accesses become single sbi/cbi/sbic
+ * instructions on top, which this does not model.
+ */
+
+// Software SPI only (no SPI.h), and TEENSYDUINO selects the port pointer
+// I/O Adafruit_SPIDevice uses on AVR
+#define SPI_INTERFACES_COUNT 0
+#define TEENSYDUINO
+
+#include <Arduino.h>
+#include <chrono>
+#include <stdio.h>
+
+#define BENCH_BYTES 256
+#define BENCH_ROUNDS 4000
+
+#define PIN_SCK 10
+#define PIN_MOSI 11
+#define PIN_MISO 11  // Looped back
+#define PIN_CS 12
+
+static volatile uint8_t port;  // Simulated I/O port, output and input register in one
+static volatile uint8_t ddr;
+// SoftSPI reaches the port through a pointer too (volatile, or the compiler
+// folds it back to the fixed address): x86 forwards stores to loads of a
+// fixed address slower than through a register, which would otherwise
+// swamp the difference being measured
+static volatile uint8_t *volatile portReg = &port;
+
+// The Arduino core pieces Adafruit_SPIDevice.cpp uses, on the simulated port
+#define INPUT 0
+#define OUTPUT 1
+#define LOW 0
+#define HIGH 1
+#define digitalPinToPort(pin) 0
+#define digitalPinToBitMask(pin) (uint8_t)(1 << ((pin) - PIN_SCK))
+#define portOutputRegister(p) (&port)
+#define portInputRegister(p) (&port)
+
+static void pinMode(uint8_t, uint8_t) {}
+
+static void digitalWrite(uint8_t pin, uint8_t v) {
+  if (v) port |= digitalPinToBitMask(pin);
+  else port &= ~digitalPinToBitMask(pin);
+}
+
+static void delayMicroseconds(unsigned int) {}
+
+#include "Adafruit_SPIDevice.cpp"
+#include "Adafruit_SoftSPI.h"
+
+/**
+ * @brief The simulated port for Adafruit_SoftSPIPin.
+ */
+struct SimPort {
+  static inline void set(uint8_t mask) { *portReg |= mask; }
+  static inline void clear(uint8_t mask) { *portReg &= ~mask; }
+  static inline volatile uint8_t &in() { return *portReg; }
+  static inline volatile uint8_t &dir() { return ddr; }
+};
+
+typedef Adafruit_SoftSPIPin<SimPort, PIN_SCK - PIN_SCK> SimSCK;
+typedef Adafruit_SoftSPIPin<SimPort, PIN_MOSI - PIN_SCK> SimMOSI;
+typedef Adafruit_SoftSPIPin<SimPort, PIN_MISO - PIN_SCK> SimMISO;
+
+static uint8_t pattern[BENCH_BYTES];
+static bool ok = true;
+
+/**
+ * @brief Nanoseconds per byte of a transfer function, checking the loopback.
+ */
+template <typename F> static double timeTransfer(F transfer) {
+  uint8_t buffer[BENCH_BYTES];
+  memcpy(buffer, pattern, sizeof(buffer));
+  transfer(buffer, BENCH_BYTES);
+  if (memcmp(buffer, pattern, sizeof(buffer))) ok = false;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < BENCH_ROUNDS; r++) {
+    transfer(buffer, BENCH_BYTES);
+  }
+  auto end = std::chrono::steady_clock::now();
+  if (memcmp(buffer, pattern, sizeof(buffer))) ok = false;
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         ((double)BENCH_ROUNDS * BENCH_BYTES);
+}
+
+/**
+ * @brief One mode and bit order, both engines.
+ */
+template <uint8_t Mode, bool LSBFirst> static double bench() {
+  Adafruit_SPIDevice device(PIN_CS, PIN_SCK, PIN_MISO, PIN_MOSI, 8000000,
+                            LSBFirst ? SPI_BITORDER_LSBFIRST : SPI_BITORDER_MSBFIRST, Mode);
+  device.begin();
+  double runtime = timeTransfer([&](uint8_t *b, size_t n) { device.transfer(b, n); });
+
+  typedef Adafruit_SoftSPI<SimSCK, SimMOSI, SimMISO, Mode, LSBFirst> Soft;
+  Soft::begin();
+  double unrolled = timeTransfer([](uint8_t *b, size_t n) { Soft::transfer(b, n); });
+
+  printf("mode %u %s  %8.2f  %8.2f  %5.2fx\n", Mode, LSBFirst ? "LSB" : "MSB", runtime, unrolled,
+         runtime / unrolled);
+  return runtime / unrolled;
+}
+
+int main() {
+  for (int i = 0; i < BENCH_BYTES; i++) pattern[i] = (uint8_t)(i * 37 + 11);
+  printf("ns per byte     SPIDevice  SoftSPI  speedup\n");
+  double sum = 0;
+  sum += bench<0, false>();
+  sum += bench<1, false>();
+  sum += bench<2, false>();
+  sum += bench<3, false>();
+  sum += bench<0, true>();
+  sum += bench<1, true>();
+  sum += bench<2, true>();
+  sum += bench<3, true>();
+  printf("mean speedup %.2fx, loopback %s\n", sum / 8, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
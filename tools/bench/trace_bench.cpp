@@ -0,0 +1,137 @@
+/* trace_bench.cpp - Host benchmark of Adafruit_BusTrace::record()
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Times record() for the transactions KeyCloth makes (the keypad block
+ * read, a register write, a failed write) on this machine, checking the
+ * entries it leaves, and puts the AVR cost beside it. There is no AVR
+ * toolchain in the host build, so that cost is counted by hand for avr-gcc
+ * -Os, part by part (AVR_CYCLES), the way i2c_async_test.cpp estimates
+ * its interrupt costs. It is compared with the time the transaction
+ * itself takes on the 400 kHz bus: record() costs less than one byte.
+ */
+
+#include "Adafruit_BusTrace.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_ROUNDS 10000000UL
+#define CPU_HZ 16000000UL
+#define BUS_HZ 400000UL
+#define BYTE_US (9 * 1000000.0 / BUS_HZ)  // 8 data bits and the ACK
+#define BLOCK_LEN 43  // KEYPAD_BLOCK_LEN of keys.cpp
+
+static unsigned long clockUs = 0;
+
+unsigned long micros() {
+  return clockUs;
+}
+
+/**
+ * @brief AVR cycles of a part of record(), counted by instruction.
+ */
+struct Part {
+  const char *name;
+  unsigned cycles;
+};
+
+static const Part AVR_CYCLES[] = {
+  {"call, 12 saved registers, ret", 56},
+  {"_enabled check", 4},
+  {"ATOMIC_BLOCK: _head, _count, _total", 30},
+  {"entry address (slot * 13)", 9},
+  {"micros(), call included", 50},
+  {"timestamp, fields, saturated lengths", 34},
+  {"4 data bytes over both copy loops", 58},
+};
+
+static bool ok = true;
+
+/**
+ * @brief Nanoseconds per record() of one transaction, and its entry checked.
+ */
+static double timeRecord(uint8_t flags, uint8_t status, const uint8_t *data, size_t dataLen,
+                         const uint8_t *more, size_t moreLen) {
+  size_t writeLen = flags & BUSIO_TRACE_WRITE ? dataLen : 0;
+  size_t readLen = flags & BUSIO_TRACE_READ ? (writeLen ? moreLen : dataLen) : 0;
+  BusTrace.clear();
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t r = 0; r < BENCH_ROUNDS; r++) {
+    clockUs = r;
+    BusTrace.record(0x5A, flags, status, writeLen, readLen, data, dataLen, more, moreLen);
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  Adafruit_BusTraceEntry e;
+  if (BusTrace.count() != BUSIO_TRACE_DEPTH || BusTrace.total() != (uint16_t)BENCH_ROUNDS ||
+      !BusTrace.get(BUSIO_TRACE_DEPTH - 1, e)) {
+    ok = false;
+    return 0;
+  }
+  uint8_t expected[BUSIO_TRACE_BYTES] = {};
+  size_t n = 0;
+  for (size_t i = 0; i < dataLen && n < BUSIO_TRACE_BYTES; i++) expected[n++] = data[i];
+  for (size_t i = 0; i < moreLen && n < BUSIO_TRACE_BYTES; i++) expected[n++] = more[i];
+  if (e.micros != BENCH_ROUNDS - 1 || e.flags != flags || e.status != status ||
+      e.write_len != writeLen || e.read_len != (readLen > 255 ? 255 : readLen) ||
+      memcmp(e.data, expected, sizeof(expected))) {
+    ok = false;
+  }
+  return std::chrono::duration<double, std::nano>(end - start).count() / BENCH_ROUNDS;
+}
+
+/**
+ * @brief One row: host time, and the AVR cost against the bus time.
+ *
+ * @bytes: Bytes on the bus, addresses included.
+ */
+static void report(const char *what, double ns, unsigned bytes, unsigned avrCycles) {
+  double avrUs = avrCycles * 1000000.0 / CPU_HZ;
+  double busUs = bytes * BYTE_US;
+  printf("%-20s %6.1f ns  %5u bytes %7.1f us  %4.1f%%\n", what, ns, bytes, busUs,
+         100 * avrUs / busUs);
+}
+
+int main() {
+  unsigned avrCycles = 0;
+  printf("record() on AVR, counted cycles\n");
+  for (const Part &p : AVR_CYCLES) {
+    printf("  %-38s %3u\n", p.name, p.cycles);
+    avrCycles += p.cycles;
+  }
+  printf("  %-38s %3u = %.1f us at 16 MHz, %.2f bytes at 400 kHz\n\n", "total", avrCycles,
+         avrCycles * 1000000.0 / CPU_HZ, avrCycles * 1000000.0 / CPU_HZ / BYTE_US);
+
+  uint8_t reg = 0x00, block[BLOCK_LEN], write[2] = {0x5E, 0x8C};
+  for (uint8_t i = 0; i < BLOCK_LEN; i++) block[i] = i * 7;
+  printf("transaction          host record  on the bus          record/bus on AVR\n");
+  // Address, register; address, block
+  report("keypad block read",
+         timeRecord(BUSIO_TRACE_WRITE | BUSIO_TRACE_READ | BUSIO_TRACE_ASYNC, BUSIO_TRACE_OK, &reg,
+                    1, block, BLOCK_LEN),
+         3 + BLOCK_LEN, avrCycles);
+  report("register write",
+         timeRecord(BUSIO_TRACE_WRITE, BUSIO_TRACE_OK, write, 2, nullptr, 0), 3, avrCycles);
+  // The address is not acknowledged
+  report("NACKed write", timeRecord(BUSIO_TRACE_WRITE, 2, write, 2, nullptr, 0), 1, avrCycles);
+  printf("entries %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
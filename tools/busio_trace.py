@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+# busio_trace.py - Render a BusIO I2C trace
+#
+# Copyright (C) 2025 Alexia Pagkopoulou
+#
+# This file is part of KeyCloth.
+#
+# KeyCloth is free software: you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+"""Render a BusIO I2C trace.
+
+Reads the binary output of BusTrace.dump() captured from a serial port,
+e.g. with `cat /dev/ttyACM0 > trace.bin`:
+
+    busio_trace.py trace.bin
+
+keycloth_sysex.py uses the same decoder for its `trace` command, which
+reads the trace over SysEx. The format is described in
+src/libraries/Adafruit_BusIO/Adafruit_BusTrace.cpp.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"BT"
+VERSION = 1
+DATA_BYTES = 4
+ENTRY_SIZE = 9 + DATA_BYTES
+HEADER = struct.Struct("<2sBBBHI")
+
+WRITE = 0x01
+READ = 0x02
+NOSTOP = 0x04
+ASYNC = 0x08
+
+STATUS = {
+    0x00: "ok",
+    0x01: "too long",
+    0x02: "addr nack",
+    0x03: "data nack",
+    0x04: "error",
+    0x05: "timeout",
+    0x20: "addr nack",
+    0x30: "data nack",
+    0x38: "arb lost",
+    0x48: "addr nack",
+    0xF1: "too long",
+    0xF2: "short read",
+    0xF3: "timeout",
+}
+
+
+def unpack_entry(data):
+    """Entry dict of BUSIO_TRACE_ENTRY_SIZE packed bytes."""
+    us, addr, flags, wlen, rlen, status = struct.unpack_from("<IBBBBB", data)
+    return {"us": us, "addr": addr, "flags": flags, "write_len": wlen,
+            "read_len": rlen, "status": status, "data": list(data[9:9 + DATA_BYTES])}
+
+
+def unpack7(data):
+    """8-bit bytes of groups of a high-bit byte and up to seven 7-bit bytes."""
+    out = []
+    for i in range(0, len(data), 8):
+        high, group = data[i], data[i + 1:i + 8]
+        out += [b | (0x80 if high & (1 << j) else 0) for j, b in enumerate(group)]
+    return out
+
+
+def parse_dump(blob):
+    """(entries, total, now_us) of a BusTrace.dump(), skipping leading noise."""
+    start = blob.find(MAGIC)
+    if start < 0 or len(blob) - start < HEADER.size:
+        raise ValueError("no trace header found")
+    magic, version, size, count, total, now = HEADER.unpack_from(blob, start)
+    if version != VERSION or size != ENTRY_SIZE:
+        raise ValueError("unsupported trace version %d, entry size %d" % (version, size))
+    pos = start + HEADER.size
+    if len(blob) - pos < count * size:
+        raise ValueError("trace is truncated")
+    entries = [unpack_entry(blob[pos + i * size:pos + (i + 1) * size]) for i in range(count)]
+    return entries, total, now
+
+
+def format_entry(e, ref_us):
+    flags = e["flags"]
+    kind = ("W" if flags & WRITE else "-") + ("R" if flags & READ else "-")
+    # Write bytes come first, then read bytes, up to DATA_BYTES in total
+    shown = e["data"][:min(DATA_BYTES, e["write_len"] + e["read_len"])]
+    nw = min(e["write_len"], len(shown))
+    data = " ".join("%02X" % b for b in shown[:nw])
+    if len(shown) > nw:
+        data += " | " + " ".join("%02X" % b for b in shown[nw:])
+    if e["write_len"] + e["read_len"] > DATA_BYTES:
+        data += " .."
+    status = STATUS.get(e["status"], "status 0x%02X" % e["status"])
+    dt = (e["us"] - ref_us) & 0xFFFFFFFF
+    if dt & 0x80000000:
+        dt -= 1 << 32
+    return "%+11.3f ms  0x%02X  %s w%-3d r%-3d %-5s %-5s %-11s %s" % (
+        dt / 1000.0, e["addr"], kind, e["write_len"], e["read_len"],
+        "async" if flags & ASYNC else "",
+        "" if flags & NOSTOP else "stop", status, data)
+
+
+def render(entries, total, now_us=None, out=sys.stdout):
+    """Print the entries, times relative to now_us (or the last entry)."""
+    if total > len(entries):
+        print("%d older transactions were overwritten" % ((total - len(entries)) & 0xFFFF), file=out)
+    if not entries:
+        print("no transactions recorded", file=out)
+        return
+    ref = now_us if now_us is not None else entries[-1]["us"]
+    prev = None
+    for e in entries:
+        line = format_entry(e, ref)
+        if prev is not None:
+            line += "  (+%d us)" % ((e["us"] - prev) & 0xFFFFFFFF)
+        prev = e["us"]
+        print(line, file=out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("file", help="binary BusTrace.dump() capture, - for stdin")
+    opts = parser.parse_args()
+    blob = sys.stdin.buffer.read() if opts.file == "-" else open(opts.file, "rb").read()
+    try:
+        entries, total, now = parse_dump(blob)
+    except ValueError as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    render(entries, total, now)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,379 @@
+#!/usr/bin/env python3
+# keycloth_capture.py - Record and replay KeyCloth raw data captures
+#
+# Copyright (C) 2025 Alexia Pagkopoulou
+#
+# This file is part of KeyCloth.
+#
+# KeyCloth is free software: you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+"""Record and replay KeyCloth raw data captures.
+
+The board streams the MPR121 filtered data and baselines of all 13
+electrodes and the raw ADC codes of the bend/stretch inputs for every scan
+as delta-encoded records batched into SysEx messages (see
+src/keycloth/capture.h). `record` stores the messages unchanged in a
+capture file, `export` replays it as CSV and
+`stats` compares its size with the old text dump:
+
+    keycloth_capture.py --port "Arduino Leonardo" record touch.kcap --seconds 10
+    keycloth_capture.py export touch.kcap > touch.csv
+    keycloth_capture.py --stand-in record demo.kcap --seconds 2
+
+Other tools replay a capture with read_capture(path), which yields one
+Frame per scan.
+"""
+
+import argparse
+import sys
+import time
+
+import keycloth_sysex as ks
+
+CAPTURE = 0x07
+FRAME = 0x20
+KEY = 0x40
+CODE_VALUE = 3
+CODES = {0: 0, 1: 1, -1: 2}
+DELTAS = {0: 0, 1: 1, 2: -1}
+MAGIC = b"keycloth-capture 1\n"
+
+
+class Frame:
+    """One scan: time (µs), filtered and baseline (10-bit) per electrode, ADC codes."""
+
+    def __init__(self, us, values, electrodes):
+        self.us = us
+        self.filtered = values[:electrodes]
+        self.baseline = [b << 2 for b in values[electrodes:2 * electrodes]]
+        self.adc = values[2 * electrodes:]
+
+
+def put_varint(v):
+    out = []
+    while v >= 0x40:
+        out.append(0x40 | (v & 0x3F))
+        v >>= 6
+    return out + [v]
+
+
+def get_varint(data, pos):
+    v, shift = 0, 0
+    while True:
+        b = data[pos]
+        pos += 1
+        v |= (b & 0x3F) << shift
+        shift += 6
+        if not b & 0x40:
+            return v, pos
+
+
+def zigzag(d):
+    return 2 * d if d >= 0 else -2 * d - 1
+
+
+def unzigzag(z):
+    return (z >> 1) ^ -(z & 1)
+
+
+def groups(count, electrodes):
+    """(start, end) of the filtered, baseline and ADC groups."""
+    return [(0, electrodes), (electrodes, 2 * electrodes), (2 * electrodes, count)]
+
+
+class Encoder:
+    """Record encoder as in capture.cpp (for the stand-in and size comparisons)."""
+
+    def __init__(self, count, electrodes, key_interval=64, batch_bytes=32):
+        self.count = count
+        self.groups = groups(count, electrodes)
+        self.key_interval = key_interval
+        self.batch_bytes = batch_bytes
+        self.until_key = 0
+        self.seq = 0
+        self.last = None
+        self.last_us = self.last_dt = 0
+        self.records = None
+
+    def group(self, values, old):
+        codes, deltas = [], []
+        for v, o in zip(values, old):
+            d = v - o
+            if d in CODES:
+                codes.append(CODES[d])
+            else:
+                codes.append(CODE_VALUE)
+                deltas += put_varint(zigzag(d))
+        return [sum(c << (2 * j) for j, c in enumerate(codes[i:i + 3]))
+                for i in range(0, len(codes), 3)] + deltas
+
+    def frame(self, us, values):
+        """Record one scan, a finished message or None (key records start a message)."""
+        if not self.until_key and self.records:
+            self.records, msg = None, ks.message(FRAME, self.records)
+        else:
+            msg = None
+        if self.records is None:
+            self.records = [self.seq]
+            self.seq = (self.seq + 1) & 0x7F
+        dt = (us - self.last_us) & 0xFFFFFFFF
+        if not self.until_key:
+            rec = [KEY] + [(us >> (7 * i)) & 0x7F for i in range(5)] + [self.count]
+            for v in values:
+                rec += put_varint(v)
+            self.until_key = self.key_interval
+            dt = 0
+        else:
+            change = (dt - self.last_dt) & 0xFFFFFFFF
+            rec = [0] + put_varint(zigzag(change - (1 << 32) if change & 0x80000000 else change))
+            for g, (start, end) in enumerate(self.groups):
+                if values[start:end] != self.last[start:end]:
+                    rec[0] |= 1 << g
+                    rec += self.group(values[start:end], self.last[start:end])
+        self.until_key -= 1
+        self.last, self.last_us, self.last_dt = list(values), us, dt
+        self.records += rec
+        if len(self.records) - 1 >= self.batch_bytes:
+            msg, self.records = ks.message(FRAME, self.records), None
+        return msg
+
+
+class Decoder:
+    """Rebuilds scans from messages, skips deltas after a lost message until the next key record."""
+
+    def __init__(self, electrodes):
+        self.electrodes = electrodes
+        self.values = None
+        self.us = self.dt = 0
+        self.seq = None
+        self.lost = 0
+
+    def group(self, payload, pos, start, end):
+        n = end - start
+        codes = payload[pos:pos + (n + 2) // 3]
+        pos += len(codes)
+        for i in range(n):
+            code = (codes[i // 3] >> (2 * (i % 3))) & 3
+            if code == CODE_VALUE:
+                z, pos = get_varint(payload, pos)
+                self.values[start + i] += unzigzag(z)
+            else:
+                self.values[start + i] += DELTAS[code]
+        return pos
+
+    def frames(self, msg):
+        """Scans of one message."""
+        parsed = ks.parse_reply(msg)
+        if not parsed or parsed[0] != FRAME:
+            return
+        payload = parsed[1]
+        seq, pos = payload[0], 1
+        if self.seq is not None and seq != (self.seq + 1) & 0x7F:
+            self.lost += (seq - self.seq - 1) & 0x7F
+            self.values = None
+        self.seq = seq
+        while pos < len(payload):
+            tag = payload[pos]
+            pos += 1
+            if tag == KEY:
+                self.us = sum(b << (7 * i) for i, b in enumerate(payload[pos:pos + 5])) & 0xFFFFFFFF
+                count, pos = payload[pos + 5], pos + 6
+                values = []
+                for _ in range(count):
+                    v, pos = get_varint(payload, pos)
+                    values.append(v)
+                self.values, self.dt = values, 0
+            elif self.values is not None:
+                z, pos = get_varint(payload, pos)
+                self.dt = (self.dt + unzigzag(z)) & 0xFFFFFFFF
+                self.us = (self.us + self.dt) & 0xFFFFFFFF
+                for g, (start, end) in enumerate(groups(len(self.values), self.electrodes)):
+                    if tag & (1 << g):
+                        pos = self.group(payload, pos, start, end)
+            else:
+                return  # Delta records cannot be skipped without the values
+            yield Frame(self.us, list(self.values), self.electrodes)
+
+
+def split_messages(blob):
+    """SysEx messages (F0..F7) of a byte string."""
+    start = None
+    for i, b in enumerate(blob):
+        if b == 0xF0:
+            start = i
+        elif b == 0xF7 and start is not None:
+            yield list(blob[start:i + 1])
+            start = None
+
+
+def read_header(f):
+    if f.readline() != MAGIC:
+        raise ValueError("not a KeyCloth capture file")
+    fields = dict(item.split("=") for item in f.readline().decode().split())
+    return int(fields["electrodes"]), int(fields["sampled"])
+
+
+def read_capture(path):
+    """Frames of a capture file, in scan order."""
+    with open(path, "rb") as f:
+        electrodes, _sampled = read_header(f)
+        blob = f.read()
+    decoder = Decoder(electrodes)
+    for msg in split_messages(blob):
+        for frame in decoder.frames(msg):
+            yield frame
+
+
+class StandInSource:
+    """Synthetic scans: key taps with the odd noise spike, crumples,
+    stretches and slowly moving bend sensors (1kΩ dividers)."""
+
+    def __init__(self, electrodes=13, sampled=4):
+        import random
+        self.random = random.Random(1)
+        self.electrodes, self.sampled = electrodes, sampled
+        self.encoder = Encoder(2 * electrodes + sampled, electrodes)
+        self.us = 0
+
+    @staticmethod
+    def adc(r):
+        return int(1024 * 1000 / (1000 + r))
+
+    @staticmethod
+    def ramp(phase, start, end, edge):
+        """0 before start, rising to 1 over edge seconds, falling back at end."""
+        if phase < start or phase >= end + edge:
+            return 0.0
+        return min(1.0, (phase - start) / edge, (end + edge - phase) / edge)
+
+    def frames(self, seconds):
+        import math
+        r = self.random
+        while self.us < seconds * 1e6:
+            self.us += 1000 + r.randint(-20, 20)
+            t = self.us / 1e6
+            filtered = [600 + r.randint(-1, 1) for _ in range(self.electrodes)]
+            # A tap every 0.3 s, cycling through the keys
+            filtered[int(t / 0.3) % 12] -= int(60 * self.ramp(t % 0.3, 0.1, 0.22, 0.02))
+            if r.random() < 0.002:
+                filtered[r.randrange(12)] -= 15  # Noise spike
+            baseline = [150] * self.electrodes
+            bend = 300 + 150 * math.sin(t * 2)
+            middle = 400 - 340 * self.ramp(t % 2, 1.0, 1.3, 0.03)
+            stretch = 400 - 320 * self.ramp(t % 2, 1.5, 1.8, 0.03)
+            adc = [self.adc(bend), self.adc(bend + 100), self.adc(middle), self.adc(stretch)]
+            adc = [a + r.randint(-2, 2) for a in adc[:self.sampled]]
+            msg = self.encoder.frame(self.us, filtered + baseline + adc)
+            if msg:
+                yield msg
+
+
+def record(opts, path):
+    if opts.stand_in:
+        electrodes, sampled = 13, 4
+        messages = StandInSource(electrodes, sampled).frames(opts.seconds)
+        port = None
+    else:
+        port = ks.MidoTransport(opts.port, opts.timeout)
+        r = ks.request(port, CAPTURE, [1])
+        electrodes, sampled = r[1], r[2]
+
+        def receive():
+            deadline = time.monotonic() + opts.seconds
+            while time.monotonic() < deadline:
+                for m in port.input.iter_pending():
+                    if m.type == "sysex":
+                        yield [0xF0] + list(m.data) + [0xF7]
+                time.sleep(0.0005)
+        messages = receive()
+    count = size = 0  # Messages
+    try:
+        with open(path, "wb") as f:
+            f.write(MAGIC)
+            f.write(("electrodes=%d sampled=%d\n" % (electrodes, sampled)).encode())
+            for msg in messages:
+                parsed = ks.parse_reply(msg)
+                if parsed and parsed[0] == FRAME:
+                    f.write(bytes(msg))
+                    count += 1
+                    size += len(msg)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if port:
+            ks.request(port, CAPTURE, [0])
+    print("%d messages, %d bytes" % (count, size), file=sys.stderr)
+
+
+def export(path, out=sys.stdout):
+    with open(path, "rb") as f:
+        electrodes, sampled = read_header(f)
+    cols = ["us"] + ["filt%d" % i for i in range(electrodes)] + \
+        ["base%d" % i for i in range(electrodes)] + ["adc%d" % i for i in range(sampled)]
+    print(",".join(cols), file=out)
+    for fr in read_capture(path):
+        print(",".join(str(v) for v in [fr.us] + fr.filtered + fr.baseline + fr.adc), file=out)
+
+
+def text_size(fr):
+    """Bytes of the same scan as the Serial text dump in keyHandler()."""
+    line = "Filt: " + "".join("%d\t" % v for v in fr.filtered) + "\r\n"
+    line += "Base: " + "".join("%d\t" % v for v in fr.baseline) + "\r\n"
+    line += "ADC: " + "".join("%d\t" % v for v in fr.adc) + "%d\r\n" % fr.us
+    return len(line)
+
+
+def stats(path):
+    with open(path, "rb") as f:
+        read_header(f)
+        messages = list(split_messages(f.read()))
+    frames = list(read_capture(path))
+    if not frames:
+        print("no frames")
+        return
+    # USB-MIDI carries 3 SysEx bytes per 4-byte packet
+    usb = sum(4 * ((len(m) + 2) // 3) for m in messages)
+    text = sum(text_size(fr) for fr in frames)
+    span = (frames[-1].us - frames[0].us) / 1e6
+    print("%d scans over %.2f s (%.0f scans/s)" % (len(frames), span, (len(frames) - 1) / span if span else 0))
+    print("SysEx %.1f bytes/scan, %.1f on USB; text %.1f bytes/scan (%.1fx)" % (
+        sum(len(m) for m in messages) / len(frames), usb / len(frames),
+        text / len(frames), text / usb))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", help="MIDI port of the board")
+    parser.add_argument("--stand-in", action="store_true", help="record synthetic scans instead of a board")
+    parser.add_argument("--timeout", type=float, default=1.0, help="reply timeout (s)")
+    parser.add_argument("--seconds", type=float, default=10.0, help="recording length (s)")
+    parser.add_argument("command", choices=["record", "export", "stats"])
+    parser.add_argument("file", help="capture file")
+    opts = parser.parse_args()
+    try:
+        if opts.command == "record":
+            if not (opts.port or opts.stand_in):
+                parser.error("either --port or --stand-in is required")
+            record(opts, opts.file)
+        elif opts.command == "export":
+            export(opts.file)
+        else:
+            stats(opts.file)
+    except (RuntimeError, ValueError, OSError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
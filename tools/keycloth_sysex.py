@@ -0,0 +1,321 @@
+#!/usr/bin/env python3
+# keycloth_sysex.py - Get, set and store KeyCloth parameters over SysEx
+#
+# Copyright (C) 2025 Alexia Pagkopoulou
+#
+# This file is part of KeyCloth.
+#
+# KeyCloth is free software: you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+"""Get, set and store KeyCloth parameters over SysEx.
+
+Talks to the board through a MIDI port (needs the `mido` package with a
+backend such as python-rtmidi), or to a local stand-in that emulates the
+firmware's parameter table, so the protocol can be tried without hardware:
+
+    keycloth_sysex.py --list-ports
+    keycloth_sysex.py --port "Arduino Leonardo" dump
+    keycloth_sysex.py --port "Arduino Leonardo" set transpose -2 save
+    keycloth_sysex.py --stand-in set touchThreshold 20 get touchThreshold
+    keycloth_sysex.py --port "Arduino Leonardo" trace
+
+The protocol is described in src/keycloth/sysex.h.
+"""
+
+import argparse
+import sys
+
+import busio_trace
+
+SYSEX_ID = 0x7D
+SYSEX_DEVICE = 0x4B
+
+GET, SET, SAVE, DESCRIBE, RESET, TRACE = 0x01, 0x02, 0x03, 0x04, 0x05, 0x06
+REPLY = 0x40
+ERROR = 0x7F
+ERRORS = {0x01: "unknown command", 0x02: "wrong length", 0x03: "unknown parameter"}
+
+U8, U16, INT, BOOL, FLOAT = range(5)
+TYPE_NAMES = ["u8", "u16", "int", "bool", "float"]
+
+# Parameter ids as in src/keycloth/params.h, with the firmware defaults
+# (the stand-in starts from these)
+PARAMS = [
+    ("channel", INT, 0, 15, 0),
+    ("touchThreshold", U8, 1, 255, 12),
+    ("releaseThreshold", U8, 1, 255, 6),
+    ("crumpleEnter", U16, 0, 32767, 100),
+    ("crumpleExit", U16, 0, 32767, 130),
+    ("crumpleFull", U16, 0, 32767, 70),
+    ("stretchEnter", U16, 0, 32767, 100),
+    ("stretchExit", U16, 0, 32767, 250),
+    ("stretchFull", U16, 0, 32767, 70),
+    ("ccRight", U8, 0, 119, 1),
+    ("ccLeft", U8, 0, 119, 1),
+    ("layout", INT, 0, 3, 0),
+    ("scale", U16, 0, 0xFFF, 0xFFF),
+    ("scaleRoot", INT, 0, 11, 0),
+    ("transpose", INT, -48, 48, 0),
+    ("octaveShift", INT, -4, 4, 0),
+    ("arpMode", INT, 0, 3, 0),
+    ("arpLatch", BOOL, 0, 1, 0),
+    ("arpRate", INT, 1, 96, 6),
+    ("arpBpm", FLOAT, 20, 300, 120),
+    ("stretchOutput", U8, 0, 3, 0),
+    ("stretchSource", U8, 0, 1, 0),
+    ("stretchCC", U8, 0, 119, 11),
+    ("stretchRateFull", U16, 1, 32767, 2000),
+]
+PARAM_IDS = {name.lower(): i for i, (name, *_rest) in enumerate(PARAMS)}
+
+
+def encode_value(value):
+    """16-bit value as three 7-bit bytes, least significant first."""
+    v = value & 0xFFFF
+    return [v & 0x7F, (v >> 7) & 0x7F, v >> 14]
+
+
+def decode_value(data, signed=True):
+    v = data[0] | (data[1] << 7) | (data[2] << 14)
+    if signed and v & 0x8000:
+        v -= 0x10000
+    return v
+
+
+def pack7(data):
+    """8-bit bytes as groups of a high-bit byte and up to seven 7-bit bytes."""
+    out = []
+    for i in range(0, len(data), 7):
+        group = data[i:i + 7]
+        out.append(sum(1 << j for j, b in enumerate(group) if b & 0x80))
+        out += [b & 0x7F for b in group]
+    return out
+
+
+def message(command, payload=()):
+    """Complete SysEx message, F0 to F7."""
+    return [0xF0, SYSEX_ID, SYSEX_DEVICE, command] + list(payload) + [0xF7]
+
+
+def parse_reply(msg):
+    """(command, payload) of a device reply, None for other messages."""
+    if len(msg) < 5 or msg[0] != 0xF0 or msg[-1] != 0xF7:
+        return None
+    if msg[1] != SYSEX_ID or msg[2] != SYSEX_DEVICE:
+        return None
+    return msg[3], list(msg[4:-1])
+
+
+class StandIn:
+    """Local stand-in for the board: answers like the firmware's sysex.cpp."""
+
+    # Two keypad scans as the firmware traces them: status block read, ECR write
+    TRACE = [
+        bytes([0x10, 0x27, 0, 0, 0x5A, 0x0B, 1, 43, 0, 0x00, 0x01, 0x00, 0xA4]),
+        bytes([0x9C, 0x2A, 0, 0, 0x5A, 0x01, 2, 0, 0, 0x5E, 0x8C, 0, 0]),
+        bytes([0x54, 0x2B, 0, 0, 0x5A, 0x0B, 0, 0, 0x20, 0, 0, 0, 0]),
+    ]
+
+    def __init__(self):
+        self.values = [default for *_rest, default in PARAMS]
+        self.stored = None
+        self.tracing = True
+
+    def _clamp(self, pid, value):
+        _name, ptype, lo, hi, _default = PARAMS[pid]
+        if ptype == U16:
+            value &= 0xFFFF
+        return max(lo, min(hi, value))
+
+    def request(self, msg):
+        if len(msg) < 5 or msg[1] != SYSEX_ID or msg[2] != SYSEX_DEVICE:
+            return None
+        command, payload = msg[3], msg[4:-1]
+
+        def error(code):
+            return message(ERROR, [command, code])
+
+        if command in (GET, DESCRIBE):
+            if len(payload) != 1:
+                return error(0x02)
+            pid = payload[0]
+            if pid >= len(PARAMS):
+                return error(0x03)
+            if command == GET:
+                return message(GET | REPLY, [pid] + encode_value(self.values[pid]))
+            _name, ptype, lo, hi, _default = PARAMS[pid]
+            return message(DESCRIBE | REPLY, [pid, ptype] + encode_value(lo) + encode_value(hi))
+        if command == SET:
+            if len(payload) != 4:
+                return error(0x02)
+            pid = payload[0]
+            if pid >= len(PARAMS):
+                return error(0x03)
+            ptype = PARAMS[pid][1]
+            self.values[pid] = self._clamp(pid, decode_value(payload[1:], ptype != U16))
+            return message(SET | REPLY, [pid] + encode_value(self.values[pid]))
+        if command == SAVE:
+            self.stored = list(self.values)
+            return message(SAVE | REPLY)
+        if command == RESET:
+            self.stored = None
+            return message(RESET | REPLY)
+        if command == TRACE:
+            if not payload:
+                self.tracing = True
+                return message(TRACE | REPLY)
+            if len(payload) != 1:
+                return error(0x02)
+            self.tracing = False
+            index, count = payload[0], len(self.TRACE)
+            entry = pack7(self.TRACE[index]) if index < count else []
+            return message(TRACE | REPLY, [index, count] + encode_value(count) + entry)
+        return error(0x01)
+
+
+class StandInTransport:
+    def __init__(self):
+        self.device = StandIn()
+
+    def transact(self, msg):
+        return self.device.request(msg)
+
+
+class MidoTransport:
+    def __init__(self, port, timeout):
+        import mido
+        self.mido = mido
+        self.output = mido.open_output(port)
+        self.input = mido.open_input(port)
+        self.timeout = timeout
+
+    def transact(self, msg):
+        import time
+        self.output.send(self.mido.Message("sysex", data=msg[1:-1]))
+        deadline = time.monotonic() + self.timeout
+        while time.monotonic() < deadline:
+            for reply in self.input.iter_pending():
+                if reply.type == "sysex":
+                    data = [0xF0] + list(reply.data) + [0xF7]
+                    if parse_reply(data):
+                        return data
+            time.sleep(0.001)
+        return None
+
+
+def request(transport, command, payload=()):
+    reply = transport.transact(message(command, payload))
+    parsed = parse_reply(reply) if reply else None
+    if not parsed:
+        raise RuntimeError("no reply from the device")
+    rcommand, rpayload = parsed
+    if rcommand == ERROR:
+        raise RuntimeError(ERRORS.get(rpayload[1], "error %d" % rpayload[1]))
+    if rcommand != command | REPLY:
+        raise RuntimeError("unexpected reply 0x%02X" % rcommand)
+    return rpayload
+
+
+def param_id(name):
+    if name.isdigit():
+        return int(name)
+    try:
+        return PARAM_IDS[name.lower()]
+    except KeyError:
+        raise RuntimeError("unknown parameter %s" % name)
+
+
+def param_name(pid):
+    return PARAMS[pid][0] if pid < len(PARAMS) else str(pid)
+
+
+def run(transport, args):
+    """Execute commands: get P, set P V, describe P, dump, save, reset, trace."""
+    i = 0
+    while i < len(args):
+        cmd = args[i]
+        if cmd == "get":
+            pid = param_id(args[i + 1])
+            r = request(transport, GET, [pid])
+            print("%s = %d" % (param_name(pid), decode_value(r[1:4], PARAMS[pid][1] != U16)))
+            i += 2
+        elif cmd == "set":
+            pid = param_id(args[i + 1])
+            r = request(transport, SET, [pid] + encode_value(int(args[i + 2], 0)))
+            print("%s = %d" % (param_name(pid), decode_value(r[1:4], PARAMS[pid][1] != U16)))
+            i += 3
+        elif cmd == "describe":
+            pid = param_id(args[i + 1])
+            r = request(transport, DESCRIBE, [pid])
+            signed = r[1] != U16
+            print("%s: %s %d..%d" % (param_name(pid), TYPE_NAMES[r[1]],
+                                     decode_value(r[2:5], signed), decode_value(r[5:8], signed)))
+            i += 2
+        elif cmd == "dump":
+            for pid, (name, ptype, *_rest) in enumerate(PARAMS):
+                r = request(transport, GET, [pid])
+                print("%-16s %d" % (name, decode_value(r[1:4], ptype != U16)))
+            i += 1
+        elif cmd == "save":
+            request(transport, SAVE)
+            print("saved")
+            i += 1
+        elif cmd == "trace":
+            # Reading pauses the trace, resuming afterwards starts a new one
+            r = request(transport, TRACE, [0])
+            count, total = r[1], decode_value(r[2:5], False)
+            entries = []
+            for index in range(count):
+                r = r if index == 0 else request(transport, TRACE, [index])
+                entries.append(busio_trace.unpack_entry(bytes(busio_trace.unpack7(r[5:]))))
+            request(transport, TRACE)
+            busio_trace.render(entries, total)
+            i += 1
+        elif cmd == "reset":
+            request(transport, RESET)
+            print("stored parameters dropped, defaults apply after a reset")
+            i += 1
+        else:
+            raise RuntimeError("unknown command %s" % cmd)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", help="MIDI port of the board")
+    parser.add_argument("--stand-in", action="store_true", help="talk to a local stand-in instead of a board")
+    parser.add_argument("--list-ports", action="store_true", help="list MIDI ports and exit")
+    parser.add_argument("--timeout", type=float, default=1.0, help="reply timeout (s)")
+    parser.add_argument("commands", nargs="*", help="get P | set P V | describe P | dump | save | reset | trace")
+    opts = parser.parse_args()
+
+    if opts.list_ports:
+        import mido
+        for name in mido.get_input_names():
+            print(name)
+        return 0
+    if opts.stand_in:
+        transport = StandInTransport()
+    elif opts.port:
+        transport = MidoTransport(opts.port, opts.timeout)
+    else:
+        parser.error("either --port or --stand-in is required")
+    try:
+        run(transport, opts.commands or ["dump"])
+    except (RuntimeError, IndexError, ValueError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+# keycloth_test.py - Build and run the KeyCloth host tests and benchmarks
+#
+# Copyright (C) 2025 Alexia Pagkopoulou
+#
+# This file is part of KeyCloth.
+#
+# KeyCloth is free software: you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+"""Build and run the KeyCloth host tests and benchmarks.
+
+Every program under tools/test (and tools/bench with --bench) is built for
+this machine together with the firmware and library sources it exercises,
+against the Arduino stand-ins of tools/tune/host, then run. A test passes
+when it exits with 0; benchmarks print their measurements:
+
+    keycloth_test.py             # all tests
+    keycloth_test.py ring        # only the named ones
+    keycloth_test.py --bench     # benchmarks instead of tests
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SRC = os.path.join(HERE, "..", "src")
+FIRMWARE = os.path.join(SRC, "keycloth")
+BUSIO = os.path.join(SRC, "libraries", "Adafruit_BusIO")
+MIDIUSB = os.path.join(SRC, "libraries", "MIDIUSB", "src")
+MPR121 = os.path.join(SRC, "libraries", "Adafruit_MPR121")
+INCLUDES = [os.path.join(HERE, "tune", "host"), FIRMWARE, BUSIO, MIDIUSB, MPR121]
+
+# name: program, sources it is linked with, extra compiler options
+TESTS = {
+    "arp": ("test/arp_test.cpp", ["keycloth/arp.cpp"], []),
+    "gesture": ("test/gesture_test.cpp", ["keycloth/gesture.cpp"], []),
+    "i2c_async": ("test/i2c_async_test.cpp", ["libraries/Adafruit_BusIO/Adafruit_BusTrace.cpp"], []),
+    "midi": ("test/midi_test.cpp",
+             ["keycloth/midi.cpp", "keycloth/voice.cpp", "keycloth/gesture.cpp",
+              "keycloth/stretch.cpp", "keycloth/sensors.cpp", "../tools/tune/host/stubs.cpp"], []),
+    "ring": ("test/ring_test.cpp", [], ["-pthread"]),
+    "sensors": ("test/sensors_test.cpp", ["keycloth/sensors.cpp"], []),
+    "stretch": ("test/stretch_test.cpp",
+                ["keycloth/stretch.cpp", "keycloth/midi.cpp", "keycloth/voice.cpp", "keycloth/gesture.cpp",
+                 "keycloth/sensors.cpp", "../tools/tune/host/stubs.cpp"], []),
+    "trace": ("test/trace_test.cpp", ["keycloth/sensors.cpp", "keycloth/gesture.cpp"], []),
+    "voice": ("test/voice_test.cpp", ["keycloth/voice.cpp"], []),
+    "wake": ("test/wake_test.cpp",
+             ["keycloth/voice.cpp", "libraries/Adafruit_MPR121/Adafruit_MPR121.cpp",
+              "libraries/Adafruit_BusIO/Adafruit_BusIO_Register.cpp",
+              "libraries/Adafruit_BusIO/Adafruit_GenericDevice.cpp"], []),
+}
+
+BENCHES = {
+    "register": ("bench/register_bench.cpp",
+                 ["libraries/Adafruit_BusIO/Adafruit_BusIO_Register.cpp",
+                  "libraries/Adafruit_BusIO/Adafruit_GenericDevice.cpp"], []),
+    "softspi": ("bench/softspi_bench.cpp", [], []),
+    "trace": ("bench/trace_bench.cpp", ["libraries/Adafruit_BusIO/Adafruit_BusTrace.cpp"], []),
+}
+
+
+def build(cxx, program, sources, options, out):
+    cmd = [cxx, "-O2", "-std=gnu++11", "-Wall"] + ["-I" + d for d in INCLUDES] + options
+    cmd += [os.path.join(HERE, program)] + [os.path.join(SRC, s) for s in sources] + ["-o", out]
+    subprocess.run(cmd, check=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("names", nargs="*", help="tests (or benchmarks) to run, default all")
+    parser.add_argument("--bench", action="store_true", help="run the benchmarks")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"), help="host C++ compiler")
+    opts = parser.parse_args()
+    table = BENCHES if opts.bench else TESTS
+    names = opts.names or sorted(table)
+    unknown = [n for n in names if n not in table]
+    if unknown:
+        print("error: unknown %s" % ", ".join(unknown), file=sys.stderr)
+        return 1
+
+    tmp = tempfile.mkdtemp(prefix="keycloth_test")
+    failed = []
+    try:
+        for name in names:
+            program, sources, options = table[name]
+            exe = os.path.join(tmp, name)
+            try:
+                build(opts.cxx, program, sources, options, exe)
+                ok = subprocess.run([exe]).returncode == 0
+            except subprocess.CalledProcessError:
+                ok = False
+            print("%s: %s" % (name, "ok" if ok else "FAILED"))
+            if not ok:
+                failed.append(name)
+    finally:
+        shutil.rmtree(tmp, ignore_errors=True)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,384 @@
+#!/usr/bin/env python3
+# keycloth_tune.py - Tune KeyCloth thresholds and filters on captured data
+#
+# Copyright (C) 2025 Alexia Pagkopoulou
+#
+# This file is part of KeyCloth.
+#
+# KeyCloth is free software: you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+"""Tune KeyCloth thresholds and filters on captured data.
+
+Builds the firmware's sensors.cpp, gesture.cpp, voice.cpp, stretch.cpp
+and midi.cpp for this machine (tools/tune/tune_host.cpp), replays captures
+recorded with keycloth_capture.py through them on all cores and searches the values of
+src/keycloth/tuning.h for the fewest missed notes and false triggers, then
+the lowest latency and CC traffic. Every capture is also replayed with
+extra noise (--dither), which keeps thresholds off the edge of the noise
+seen while recording:
+
+    keycloth_tune.py touch.kcap crumple.kcap
+    keycloth_tune.py touch.kcap --header ../src/keycloth/tuning.h --sysex tuned.syx
+
+The intended events come from a slow offline detector (centered
+smoothing, thresholds relative to each channel's peak), or from
+<capture>.labels next to a capture, with lines of
+`<channel>,<on ms>,<off ms>` (channels key0..key11, crumple, stretch,
+times from the first scan), which then replace the detector. Latency is
+relative to the reference onsets, so it can be negative.
+
+--sysex writes the live parameters among the results as SET messages and
+a SAVE, for any tool that sends .syx files; the filter constants are
+compiled in and only go to the --header output.
+"""
+
+import argparse
+import os
+import random
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+import keycloth_capture as kc
+import keycloth_sysex as ks
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+FIRMWARE = os.path.join(HERE, "..", "src", "keycloth")
+TUNING_H = os.path.join(FIRMWARE, "tuning.h")
+SOURCES = ["sensors.cpp", "gesture.cpp", "voice.cpp", "stretch.cpp", "midi.cpp"]
+
+NUM_KEYS = 12
+CRUMPLE_SLOT, STRETCH_SLOT = 2, 3  # MIDDLE and the stretch sensor in sampled[]
+CHANNELS = ["key%d" % i for i in range(NUM_KEYS)] + ["crumple", "stretch"]
+MAXR = 1000  # Bend sensor limit (bend.h)
+MIN_HYSTERESIS_R = 10  # Smallest exitR - enterR of a gesture (Ω)
+
+# Searched values in tune_host input order: name, tuning.h macro, range,
+# SysEx parameter (None: compiled in only)
+SPACE = [
+    ("touch", "TOUCH_THRESHOLD", 2, 60, "touchThreshold"),
+    ("release", "RELEASE_THRESHOLD", 1, 59, "releaseThreshold"),
+    ("crumpleEnter", "CRUMPLE_ENTER_R", 10, 900, "crumpleEnter"),
+    ("crumpleExit", "CRUMPLE_EXIT_R", 11, 1000, "crumpleExit"),
+    ("stretchEnter", "STRETCH_ENTER_R", 10, 2000, "stretchEnter"),
+    ("stretchExit", "STRETCH_EXIT_R", 11, 3000, "stretchExit"),
+    ("alpha", "SMOOTH_ALPHA", 8, 256, None),
+    ("spike", "SPIKE_THRESHOLD", 10, 500, None),
+    ("deadZone", "DEAD_ZONE", 0, 50, None),
+]
+
+# Reference detector
+REF_SMOOTH = 5         # Centered moving average over 2 * REF_SMOOTH + 1 scans
+REF_ON, REF_OFF = 0.5, 0.25  # Hysteresis as fractions of the channel's peak
+REF_MIN_MS = 20        # Shorter events are dropped, shorter gaps merged
+REF_FLOOR = {"key": 4, "R": 20}  # Smallest peak that counts (counts, Ω)
+
+
+def ohms(raw, limit):
+    """rawToOhms() of a 1kΩ divider, clamped like the convert stage."""
+    if raw <= 0:
+        return limit
+    return min(limit, 1000 * (1024 - raw) // raw)
+
+
+def smooth(values, k):
+    sums = [0]
+    for v in values:
+        sums.append(sums[-1] + v)
+    n = len(values)
+    return [(sums[min(n, i + k + 1)] - sums[max(0, i - k)]) / (min(n, i + k + 1) - max(0, i - k))
+            for i in range(n)]
+
+
+def percentile(values, q):
+    s = sorted(values)
+    return s[min(len(s) - 1, int(q * len(s)))]
+
+
+def reference(deflection, us, floor):
+    """(on scan, off scan) of the events in a deflection (rest = 0, positive when active)."""
+    d = smooth(deflection, REF_SMOOTH)
+    rest = percentile(d, 0.5)
+    d = [v - rest for v in d]
+    noise = 1.4826 * percentile([abs(v) for v in d], 0.5)
+    peak = percentile(d, 0.995)
+    if peak < max(floor, 8 * noise):
+        return []
+    events, on = [], None
+    for i, v in enumerate(d):
+        if on is None and v > REF_ON * peak:
+            on = i
+        elif on is not None and v < REF_OFF * peak:
+            if events and us[on] - us[events[-1][1]] < REF_MIN_MS * 1000:
+                on = events.pop()[0]  # Merge a short gap
+            events.append((on, i))
+            on = None
+    if on is not None:
+        events.append((on, len(d) - 1))
+    return [(a, b) for a, b in events if us[b] - us[a] >= REF_MIN_MS * 1000]
+
+
+def read_labels(path, us):
+    """Events of a labels file, times mapped to scan indices."""
+    events = []
+    with open(path) as f:
+        for line in f:
+            line = line.split("#")[0].strip()
+            if not line:
+                continue
+            name, on_ms, off_ms = [x.strip() for x in line.split(",")]
+            if name not in CHANNELS:
+                raise ValueError("%s: unknown channel %s" % (path, name))
+            scan = [next((i for i, t in enumerate(us) if t - us[0] >= float(ms) * 1000), len(us) - 1)
+                    for ms in (on_ms, off_ms)]
+            events.append((CHANNELS.index(name), scan[0], scan[1]))
+    return events
+
+
+def load_segment(path):
+    """(frames, unwrapped times, events, electrodes, sampled) of a capture."""
+    with open(path, "rb") as f:
+        electrodes, sampled = kc.read_header(f)
+    frames = list(kc.read_capture(path))
+    if len(frames) < 2:
+        raise ValueError("%s: no scans" % path)
+    us = [fr.us for fr in frames]
+    for i in range(1, len(us)):
+        us[i] = us[i - 1] + ((frames[i].us - frames[i - 1].us) & 0xFFFFFFFF)  # Unwrap
+    labels = os.path.splitext(path)[0] + ".labels"
+    if os.path.exists(labels):
+        events = read_labels(labels, us)
+    else:
+        events = []
+        for key in range(NUM_KEYS):
+            deflection = [fr.baseline[key] - fr.filtered[key] for fr in frames]
+            events += [(key, a, b) for a, b in reference(deflection, us, REF_FLOOR["key"])]
+        for ch, slot, limit in ((NUM_KEYS, CRUMPLE_SLOT, MAXR), (NUM_KEYS + 1, STRETCH_SLOT, 0xFFFF)):
+            if slot < sampled:
+                deflection = [-ohms(fr.adc[slot], limit) for fr in frames]
+                events += [(ch, a, b) for a, b in reference(deflection, us, REF_FLOOR["R"])]
+    return frames, us, events, electrodes, sampled
+
+
+def write_data(path, segments):
+    electrodes, sampled = segments[0][3], segments[0][4]
+    with open(path, "wb") as f:
+        f.write(b"KCTN" + struct.pack("<BBBH", 1, electrodes, sampled, len(segments)))
+        for frames, us, events, e, s in segments:
+            if (e, s) != (electrodes, sampled):
+                raise ValueError("captures differ in electrodes or inputs")
+            f.write(struct.pack("<II", len(frames), len(events)))
+            row = struct.Struct("<I%dH" % (2 * electrodes + sampled))
+            for fr, t in zip(frames, us):
+                f.write(row.pack(t & 0xFFFFFFFF, *(fr.filtered + fr.baseline + fr.adc)))
+            for ch, on, off in events:
+                f.write(struct.pack("<BII", ch, on, off))
+
+
+def build(cxx, out):
+    tune = os.path.join(HERE, "tune")
+    cmd = [cxx, "-O2", "-std=gnu++11", "-I" + os.path.join(tune, "host"), "-I" + FIRMWARE,
+           "-include", os.path.join(tune, "tune_host.h"), os.path.join(tune, "tune_host.cpp"),
+           os.path.join(tune, "host", "stubs.cpp")]
+    cmd += [os.path.join(FIRMWARE, s) for s in SOURCES] + ["-o", out]
+    subprocess.run(cmd, check=True)
+
+
+class Workers:
+    """One tune_host process per core, fed candidates in chunks."""
+
+    CHUNK = 256  # Keeps both pipes of a worker below their buffer size
+
+    def __init__(self, exe, data, jobs, dither):
+        self.procs = [subprocess.Popen([exe, data, str(dither)], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                       universal_newlines=True) for _ in range(jobs)]
+        self.evaluations = 0
+
+    def run(self, candidates):
+        results = []
+        for start in range(0, len(candidates), self.CHUNK * len(self.procs)):
+            batch = candidates[start:start + self.CHUNK * len(self.procs)]
+            parts = [batch[i::len(self.procs)] for i in range(len(self.procs))]
+            for p, part in zip(self.procs, parts):
+                p.stdin.write("".join(" ".join(map(str, c)) + "\n" for c in part))
+                p.stdin.flush()
+            answers = [[p.stdout.readline().split() for _ in part] for p, part in zip(self.procs, parts)]
+            for i in range(len(batch)):
+                fields = answers[i % len(self.procs)][i // len(self.procs)]
+                if len(fields) != 5:
+                    raise RuntimeError("tune_host failed")
+                results.append([int(x) for x in fields])
+        self.evaluations += len(candidates)
+        return results
+
+    def close(self):
+        for p in self.procs:
+            p.stdin.close()
+            p.wait()
+
+
+def repair(c):
+    """Clamp a candidate to the space, release below touch, exits above enters."""
+    c = [max(lo, min(hi, int(round(v)))) for v, (_n, _m, lo, hi, _p) in zip(c, SPACE)]
+    c[1] = min(c[1], c[0] - 1)
+    c[3] = max(c[3], c[2] + MIN_HYSTERESIS_R)
+    c[5] = max(c[5], c[4] + MIN_HYSTERESIS_R)
+    return tuple(c)
+
+
+class Search:
+    """Random sampling, then coordinate descent from the best candidate."""
+
+    def __init__(self, workers, weights, seconds, seed):
+        self.workers = workers
+        self.weights = weights
+        self.seconds = seconds
+        self.random = random.Random(seed)
+        self.scores = {}
+
+    def cost(self, r):
+        missed, false, matched, latency_us, cc = r
+        w = self.weights
+        latency_ms = latency_us / 1000.0 / matched if matched else 0.0
+        return w.miss * missed + w.false * false + w.latency * latency_ms + w.cc * cc / self.seconds
+
+    def evaluate(self, candidates):
+        todo = [c for c in dict.fromkeys(candidates) if c not in self.scores]
+        for c, r in zip(todo, self.workers.run(todo)):
+            self.scores[c] = r
+        return min(candidates, key=lambda c: self.cost(self.scores[c]))
+
+    def run(self, start, budget):
+        best = self.evaluate([start])
+        samples = [repair([self.random.uniform(lo, hi) for _n, _m, lo, hi, _p in SPACE])
+                   for _ in range(budget // 2)]
+        best = self.evaluate([best] + samples)
+        steps = [(hi - lo) / 8.0 for _n, _m, lo, hi, _p in SPACE]
+        while max(steps) >= 1 and len(self.scores) < budget:
+            moves = []
+            for i, step in enumerate(steps):
+                for sign in (-1, 1):
+                    c = list(best)
+                    c[i] += sign * max(1, step)
+                    moves.append(repair(c))
+            better = self.evaluate([best] + moves)
+            if self.cost(self.scores[better]) < self.cost(self.scores[best]):
+                best = better
+            else:
+                steps = [s / 2 for s in steps]
+        return best
+
+
+def read_defaults(path=TUNING_H):
+    with open(path) as f:
+        text = f.read()
+    values = []
+    for _name, macro, *_rest in SPACE:
+        m = re.search(r"#define %s\s+(\d+)" % macro, text)
+        if not m:
+            raise ValueError("%s not found in %s" % (macro, path))
+        values.append(int(m.group(1)))
+    return tuple(values), text
+
+
+def write_header(path, text, values):
+    def number(v):
+        # Keep trailing comments in their column
+        return lambda m: m.group(1) + str(v) + (" " * max(1, len(m.group(2) + m.group(3)) - len(str(v)))
+                                                if m.group(3) else "")
+    for (_name, macro, *_rest), v in zip(SPACE, values):
+        text = re.sub(r"(#define %s\s+)(\d+)([ \t]*)" % macro, number(v), text)
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def write_sysex(path, values):
+    data = []
+    for (_name, _macro, _lo, _hi, param), v in zip(SPACE, values):
+        if param:
+            data += ks.message(ks.SET, [ks.PARAM_IDS[param.lower()]] + ks.encode_value(v))
+    data += ks.message(ks.SAVE)
+    with open(path, "wb") as f:
+        f.write(bytes(data))
+
+
+def report(search, label, c):
+    missed, false, matched, latency_us, cc = search.scores[c]
+    print("%-8s %s" % (label, " ".join("%s=%d" % (n, v) for (n, *_rest), v in zip(SPACE, c))))
+    print("         missed %d, false %d, latency %+.1f ms, %.1f CC/s, cost %.2f" % (
+        missed, false, latency_us / 1000.0 / matched if matched else 0.0,
+        cc / search.seconds, search.cost(search.scores[c])))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("captures", nargs="+", help="capture files of keycloth_capture.py")
+    parser.add_argument("--budget", type=int, default=2000, help="candidates to evaluate")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1, help="worker processes")
+    parser.add_argument("--seed", type=int, default=1, help="random seed")
+    parser.add_argument("--miss", type=float, default=1.0, help="cost of a missed note")
+    parser.add_argument("--false", type=float, default=1.0, help="cost of a false trigger")
+    parser.add_argument("--latency", type=float, default=0.1, help="cost per ms of mean latency")
+    parser.add_argument("--cc", type=float, default=0.01, help="cost per CC message per second")
+    parser.add_argument("--dither", type=int, default=3,
+                        help="extra noise (counts) of the second replay, 0 for none")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"), help="host C++ compiler")
+    parser.add_argument("--header", help="write tuning.h with the results")
+    parser.add_argument("--sysex", help="write the live parameters as a .syx file")
+    opts = parser.parse_args()
+    weights = argparse.Namespace(miss=opts.miss, false=opts.false, latency=opts.latency, cc=opts.cc)
+
+    tmp = tempfile.mkdtemp(prefix="keycloth_tune")
+    workers = None
+    try:
+        defaults, text = read_defaults()
+        segments = [load_segment(p) for p in opts.captures]
+        seconds = sum((us[-1] - us[0]) / 1e6 for _f, us, *_rest in segments)
+        events = sum(len(s[2]) for s in segments)
+        print("%d scans over %.1f s, %d reference events" % (
+            sum(len(s[0]) for s in segments), seconds, events))
+        data, exe = os.path.join(tmp, "data"), os.path.join(tmp, "tune_host")
+        write_data(data, segments)
+        build(opts.cxx, exe)
+
+        workers = Workers(exe, data, max(1, opts.jobs), opts.dither)
+        search = Search(workers, weights, seconds, opts.seed)
+        started = time.monotonic()
+        best = search.run(repair(defaults), opts.budget)
+        elapsed = time.monotonic() - started
+        report(search, "default", repair(defaults))
+        report(search, "tuned", best)
+        per_eval = elapsed * max(1, opts.jobs) / workers.evaluations
+        print("%d evaluations in %.1f s on %d cores, %.1f ms each (%.0fx real time)" % (
+            workers.evaluations, elapsed, max(1, opts.jobs), per_eval * 1000, seconds / per_eval))
+
+        if opts.header:
+            write_header(opts.header, text, best)
+        if opts.sysex:
+            write_sysex(opts.sysex, best)
+    except (RuntimeError, ValueError, OSError, subprocess.CalledProcessError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+    finally:
+        if workers:
+            workers.close()
+        shutil.rmtree(tmp, ignore_errors=True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,291 @@
+/* arp_test.cpp - Host test of the arpeggiator: mode changes and pulse jitter
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Runs arp.cpp against a simulated clock and a note recorder:
+ *  - switching arpMode on and off leaves no note sounding and no stale
+ *    chord behind;
+ *  - the loop of keycloth.ino, as a sequence of stages with estimated
+ *    Leonardo run times (randomly varied), drives the internal clock at
+ *    300 BPM with one step per pulse. The jitter is the spread of the note
+ *    ons against the pulse grid: it is bounded by the longest stretch of
+ *    the loop between two arpService() calls, since loop() services the
+ *    arpeggiator while the keypad transfer finishes;
+ *  - the same loop following an external MIDI clock at 300 BPM. Incoming
+ *    pulses step the arpeggio where the loop reads the MIDI input, so the
+ *    jitter is bounded by the longest stretch between two pollMidiIn()
+ *    calls, which loop() makes while the keypad transfer finishes too.
+ */
+
+#include "arp.h"
+#include "layout.h"
+#include "midi.h"
+#include "check.h"
+
+int arpMode = ARP_OFF;
+bool arpLatch = false;
+int arpRate = 6;
+float arpBpm = 120;
+uint8_t noteTable[NUM_KEYS];
+
+static unsigned long now = 0;  // Microseconds
+
+unsigned long micros() {
+  return now;
+}
+
+unsigned long millis() {
+  return now / 1000;
+}
+
+static uint8_t soundingNotes = 0;
+static unsigned long noteOns[4096];
+static unsigned noteOnCount = 0;
+
+void noteOn(int, int, uint8_t) {
+  soundingNotes++;
+  if (noteOnCount < sizeof(noteOns) / sizeof(noteOns[0])) noteOns[noteOnCount++] = now;
+}
+
+void noteOff(int, uint8_t) {
+  soundingNotes--;
+}
+
+void flushMidi() {}
+
+static const int velocity[NUM_KEYS] = {100, 100, 100, 100, 100, 100, 100, 100, 100, 100, 100, 100};
+
+/**
+ * @brief Advance the clock, servicing the arpeggiator every 100 us.
+ */
+static void run(unsigned long us) {
+  for (unsigned long end = now + us; now < end; now += 100) arpService();
+}
+
+/**
+ * @brief Mode changes release the arpeggio and drop stale chords.
+ */
+static void testModeChanges() {
+  arpBpm = 120;
+  arpRate = 6;
+  arpMode = ARP_UP;
+  arpModeChanged();
+  arpKeys(0x0003, velocity);
+  run(200000);
+  CHECK(noteOnCount > 0);
+
+  // Off while a note sounds: it is released, the keys are forgotten
+  while (!soundingNotes) run(100);
+  arpMode = ARP_OFF;
+  arpModeChanged();
+  CHECK(soundingNotes == 0 && !arpPlaying());
+
+  // On again with no keys held: nothing plays
+  unsigned count = noteOnCount;
+  arpMode = ARP_DOWN;
+  arpModeChanged();
+  run(500000);
+  CHECK(noteOnCount == count && !arpPlaying());
+
+  // A latched chord is dropped too when the arpeggiator is turned off
+  arpLatch = true;
+  arpKeys(0x0007, velocity);
+  arpKeys(0, velocity);
+  run(200000);
+  CHECK(arpPlaying() && noteOnCount > count);
+  arpMode = ARP_OFF;
+  arpModeChanged();
+  CHECK(soundingNotes == 0);
+  arpMode = ARP_UPDOWN;
+  arpModeChanged();
+  count = noteOnCount;
+  run(500000);
+  CHECK(noteOnCount == count && !arpPlaying());
+
+  // Changing between modes restarts the arpeggio without a stuck note
+  arpKeys(0x0003, velocity);
+  run(200000);
+  while (!soundingNotes) run(100);
+  arpMode = ARP_UP;
+  arpModeChanged();
+  CHECK(soundingNotes == 0 && arpPlaying());
+  arpMode = ARP_OFF;
+  arpModeChanged();
+  arpKeys(0, velocity);
+  arpLatch = false;
+}
+
+/**
+ * @brief A loop stage: estimated run time and when arpService() runs.
+ */
+struct Stage {
+  const char *name;
+  unsigned long us;
+  bool service;  // Once afterwards
+  bool spin;     // Throughout, every 10 us (waiting for the keypad transfer)
+  bool midiIn;   // The MIDI input is read too where arpService() runs
+};
+
+static bool externalClock = false;  // A host sends 0xF8 every pulse
+static unsigned long nextClockUs = 0;  // Arrival of the next 0xF8
+
+/**
+ * @brief Read the MIDI input, as pollMidiIn() does: the clock pulses
+ * received by now.
+ */
+static void pollClock(unsigned long pulseUs) {
+  for (; externalClock && (long)(now - nextClockUs) >= 0; nextClockUs += pulseUs) arpClock();
+}
+
+static uint32_t seed = 1;
+
+/**
+ * @brief Run time varied by -30..+30% (LCG, repeatable).
+ */
+static unsigned long vary(unsigned long us) {
+  seed = seed * 1103515245 + 12345;
+  return us * (70 + (seed >> 16) % 61) / 100;
+}
+
+/**
+ * @brief Largest spread of the note ons against the pulse grid (us).
+ *
+ * @external: Follow a MIDI clock instead of the internal one.
+ */
+static unsigned long loopJitter(const Stage *stages, uint8_t n, unsigned long &pulseUs,
+                                bool external = false) {
+  arpBpm = 300;
+  arpRate = 1;
+  arpMode = ARP_UP;
+  arpModeChanged();
+  setupArp();
+  arpKeys(0x0FFF, velocity);
+  noteOnCount = 0;
+  pulseUs = (unsigned long)(60000000.0 / (arpBpm * CLOCK_PPQN));
+  externalClock = external;
+  nextClockUs = now;
+  unsigned long end = now + 10000000UL;
+  while ((long)(now - end) < 0) {
+    for (uint8_t i = 0; i < n; i++) {
+      unsigned long stageEnd = now + vary(stages[i].us);
+      if (stages[i].spin) {
+        for (; now < stageEnd; now += 10) {
+          if (stages[i].midiIn) pollClock(pulseUs);
+          arpService();
+        }
+      }
+      now = stageEnd;
+      if (stages[i].service) {
+        if (stages[i].midiIn) pollClock(pulseUs);
+        arpService();
+      }
+    }
+  }
+  externalClock = false;
+  arpMode = ARP_OFF;
+  arpModeChanged();
+  arpKeys(0, velocity);
+
+  long lo = 0, hi = 0;
+  for (unsigned i = 1; i < noteOnCount; i++) {
+    long d = (long)(noteOns[i] - noteOns[0]) - (long)(i * pulseUs);
+    if (d < lo) lo = d;
+    if (d > hi) hi = d;
+  }
+  return hi - lo;
+}
+
+/**
+ * @brief Pulse jitter of the loop at 300 BPM.
+ */
+static void testJitter() {
+  // keycloth.ino loop(), active scanning with the arpeggiator on
+  static const Stage loop[] = {
+    {"pollMidiIn", 60, true, false, true},
+    {"drainSamples, startKeyScan", 80, false, false, false},
+    {"readSensors", 500, true, false, false},
+    {"keyScanPending", 600, false, true, true},  // Rest of the keypad transfer
+    {"keyHandler", 150, false, false, false},
+    {"handleSignals", 300, true, false, false},  // arpService() at the end of its arpeggiator branch
+    {"serviceIdle, serviceCalibration", 40, false, false, false},
+  };
+  // Before: keyHandler() blocked in the transfer, no arpService() before handleSignals()
+  static const Stage before[] = {
+    {"pollMidiIn", 60, true, false, true},
+    {"drainSamples, startKeyScan", 80, false, false, false},
+    {"readSensors", 500, false, false, false},
+    {"keyHandler", 750, false, false, false},
+    {"handleSignals", 300, true, false, false},
+    {"serviceIdle, serviceCalibration", 40, false, false, false},
+  };
+  unsigned long pulseUs;
+  now = 0;
+  unsigned long beforeUs = loopJitter(before, sizeof(before) / sizeof(before[0]), pulseUs);
+  unsigned count = noteOnCount;
+  now = 0;
+  unsigned long jitterUs = loopJitter(loop, sizeof(loop) / sizeof(loop[0]), pulseUs);
+  printf("300 BPM, pulse %lu us, %u pulses: jitter %lu us (%lu us blocking in keyHandler())\n",
+         pulseUs, noteOnCount, jitterUs, beforeUs);
+  CHECK(noteOnCount > 1000 && count > 1000);
+  CHECK(jitterUs < 1000);
+}
+
+/**
+ * @brief Pulse jitter of the loop following a MIDI clock at 300 BPM.
+ */
+static void testExternalJitter() {
+  // keycloth.ino loop(), the MIDI input is read while the keypad transfer finishes
+  static const Stage loop[] = {
+    {"pollMidiIn", 60, true, false, true},
+    {"drainSamples, startKeyScan", 80, false, false, false},
+    {"readSensors", 500, true, false, false},
+    {"keyScanPending", 600, false, true, true},
+    {"keyHandler", 150, false, false, false},
+    {"handleSignals", 300, true, false, false},
+    {"serviceIdle, serviceCalibration", 40, false, false, false},
+  };
+  // Before: only arpService() while the transfer finishes, the clock waits for the next loop
+  static const Stage before[] = {
+    {"pollMidiIn", 60, true, false, true},
+    {"drainSamples, startKeyScan", 80, false, false, false},
+    {"readSensors", 500, true, false, false},
+    {"keyScanPending", 600, false, true, false},
+    {"keyHandler", 150, false, false, false},
+    {"handleSignals", 300, true, false, false},
+    {"serviceIdle, serviceCalibration", 40, false, false, false},
+  };
+  unsigned long pulseUs;
+  now = 0;
+  unsigned long beforeUs = loopJitter(before, sizeof(before) / sizeof(before[0]), pulseUs, true);
+  unsigned count = noteOnCount;
+  unsigned long jitterUs = loopJitter(loop, sizeof(loop) / sizeof(loop[0]), pulseUs, true);
+  printf("MIDI clock 300 BPM, %u pulses: jitter %lu us (%lu us reading it once per loop)\n",
+         noteOnCount, jitterUs, beforeUs);
+  CHECK(noteOnCount > 1000 && count > 1000);
+  CHECK(jitterUs < 1000);
+}
+
+int main() {
+  for (uint8_t i = 0; i < NUM_KEYS; i++) noteTable[i] = 60 + i;
+  testModeChanges();
+  testJitter();
+  testExternalJitter();
+  return checkResult();
+}
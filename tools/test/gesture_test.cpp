@@ -0,0 +1,95 @@
+/* gesture_test.cpp - Host test of the gesture state machine
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Feeds resistance sequences (one sample per millisecond) into
+ * stepGesture() and checks the events: one ON and one OFF per gesture,
+ * HOLD once however often the release bounces back, short dips and
+ * blocked gestures ignored.
+ */
+
+#include "gesture.h"
+#include "check.h"
+
+static const GestureConfig config = {1000, 2000, 500, 15, 500, 36};
+
+static GestureInfo g;
+static uint16_t nowMs;
+static uint8_t events[4];  // Count per GESTURE_* event
+
+/**
+ * @brief Hold a resistance for some milliseconds.
+ */
+static void feed(uint16_t r, uint16_t ms, bool blocked = false) {
+  for (uint16_t i = 0; i < ms; i++) {
+    events[stepGesture(g, config, r, nowMs++, blocked)]++;
+  }
+}
+
+static void reset() {
+  g = GestureInfo();
+  for (uint8_t i = 0; i < 4; i++) events[i] = 0;
+  feed(3000, 10);
+}
+
+int main() {
+  // A plain hit
+  reset();
+  feed(800, 100);
+  feed(3000, 50);
+  CHECK(events[GESTURE_ON] == 1 && events[GESTURE_OFF] == 1 && events[GESTURE_HOLD] == 0);
+  CHECK(g.state == GESTURE_REST);
+
+  // A dip shorter than the dwell time does nothing
+  reset();
+  feed(800, 10);
+  feed(3000, 50);
+  CHECK(events[GESTURE_ON] == 0 && g.state == GESTURE_REST);
+
+  // Held, then the release bounces back twice before it settles
+  reset();
+  feed(800, 600);
+  CHECK(events[GESTURE_ON] == 1 && events[GESTURE_HOLD] == 1 && g.state == GESTURE_HELD);
+  for (uint8_t i = 0; i < 2; i++) {
+    feed(3000, 10);
+    CHECK(g.state == GESTURE_RELEASING_HELD);
+    feed(1500, 20);  // Back into the band
+    CHECK(g.state == GESTURE_HELD);
+  }
+  feed(1500, 600);
+  feed(3000, 50);
+  CHECK(events[GESTURE_HOLD] == 1 && events[GESTURE_OFF] == 1 && g.state == GESTURE_REST);
+
+  // A bounce before the hold time still counts towards it
+  reset();
+  feed(800, 100);
+  feed(3000, 10);
+  CHECK(g.state == GESTURE_RELEASING);
+  feed(800, 450);
+  CHECK(events[GESTURE_HOLD] == 1 && g.state == GESTURE_HELD);
+  feed(3000, 50);
+  CHECK(events[GESTURE_ON] == 1 && events[GESTURE_OFF] == 1);
+
+  // Blocked gestures do not engage
+  reset();
+  feed(800, 100, true);
+  CHECK(events[GESTURE_ON] == 0 && g.state == GESTURE_REST);
+  return checkResult();
+}
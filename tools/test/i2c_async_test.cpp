@@ -0,0 +1,339 @@
+/* i2c_async_test.cpp - Host test of the asynchronous I2C engine on a simulated TWI
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Runs Adafruit_I2CAsyncEngine on a simulated TWI peripheral with an
+ * MPR121-like slave, in 16 MHz CPU cycles at a 400 kHz bus clock:
+ * block reads, chaining with repeated STARTs, NACK recovery, a full queue
+ * and the timeout abort, with the polling path and with the stepping timer
+ * keys.cpp uses (Wire owns the TWI interrupt).
+ *
+ * Then it times KeyCloth's scan: startKeyScan() queues the 43 byte block
+ * read, the loop does W cycles of other work (readSensors()), keyHandler()
+ * waits. Polled, the transfer only moves inside the wait, so the scan takes
+ * W plus the transfer; stepped, it runs under the work and only the
+ * interrupt time is left of it. The interrupt costs are estimates for
+ * avr-gcc (register save/restore plus step()).
+ */
+
+#include "Adafruit_I2CAsync.h"
+#include "check.h"
+
+#define CPU_HZ 16000000UL
+#define BUS_HZ 400000UL
+#define BYTE_CYCLES (CPU_HZ / BUS_HZ * 9)     // 8 data bits and the ACK
+#define START_CYCLES (CPU_HZ / BUS_HZ * 2)    // (Repeated) START condition
+#define STEP_CYCLES BYTE_CYCLES               // KEYPAD_STEP_CYCLES of keys.cpp
+#define STEP_LEAD 32                          // KEYPAD_STEP_LEAD
+#define STEP_RETRY 48                         // KEYPAD_STEP_RETRY
+#define ISR_ENTRY_CYCLES 40                   // Vector and prologue, up to the bus command
+#define ISR_RELOAD_CYCLES 110                 // Up to the TCNT3 reload after an event
+#define ISR_EVENT_CYCLES 150                  // Whole interrupt handling an event
+#define ISR_IDLE_RELOAD_CYCLES 56             // Up to the reload without an event
+#define ISR_IDLE_CYCLES 70                    // Whole interrupt without an event
+#define SPIN_CYCLES 16                        // One round of the wait() loop
+#define SLAVE_ADDR 0x5A
+#define BLOCK_LEN 43                          // KEYPAD_BLOCK_LEN of keys.cpp
+
+static uint64_t now = 0;  // CPU cycles
+
+unsigned long micros() {
+  return now / (CPU_HZ / 1000000UL);
+}
+
+/**
+ * @brief Register file of the simulated slave, auto-incrementing like the MPR121.
+ */
+static struct {
+  uint8_t regs[256];
+  uint8_t ptr;
+  bool stuck;  // Holds SCL low after its address: no event ever completes
+} slave;
+
+/**
+ * @brief Simulated TWI master: every command raises TWINT some cycles later.
+ */
+static struct {
+  bool armed;
+  uint64_t at;
+  uint8_t status;
+  uint8_t data;
+  bool owned;        // Between START and STOP
+  bool address;      // Next byte is SLA+R/W
+  bool pointer;      // Next written byte is the register pointer
+  bool selected;
+  uint32_t starts, repeated, stops;
+} twi;
+
+static void complete(uint64_t cycles, uint8_t status) {
+  twi.armed = true;
+  twi.at = now + cycles;
+  twi.status = status;
+}
+
+static void spin(uint64_t cycles);
+static bool irqEnabled = true;
+
+struct SimPort {
+  static const bool interruptDriven = false;
+  static void start() {
+    twi.starts++;
+    if (twi.owned) twi.repeated++;
+    complete(START_CYCLES, twi.owned ? I2C_ASYNC_REP_START : I2C_ASYNC_START);
+    twi.owned = twi.address = true;
+  }
+  static void stop() {
+    twi.stops++;
+    twi.owned = twi.armed = false;
+  }
+  static void send(uint8_t b) {
+    if (twi.address) {
+      twi.address = false;
+      twi.pointer = true;
+      twi.selected = (b >> 1) == SLAVE_ADDR;
+      twi.armed = false;
+      if (slave.stuck) return;
+      if (b & 1) complete(BYTE_CYCLES, twi.selected ? I2C_ASYNC_MR_SLA_ACK : I2C_ASYNC_MR_SLA_NACK);
+      else complete(BYTE_CYCLES, twi.selected ? I2C_ASYNC_MT_SLA_ACK : I2C_ASYNC_MT_SLA_NACK);
+      return;
+    }
+    if (twi.pointer) slave.ptr = b;
+    else slave.regs[slave.ptr++] = b;
+    twi.pointer = false;
+    complete(BYTE_CYCLES, I2C_ASYNC_MT_DATA_ACK);
+  }
+  static void receive(bool ack) {
+    twi.data = slave.regs[slave.ptr++];
+    complete(BYTE_CYCLES, ack ? I2C_ASYNC_MR_DATA_ACK : I2C_ASYNC_MR_DATA_NACK);
+  }
+  static uint8_t data() { return twi.data; }
+  static uint8_t status() { return twi.status; }
+  static bool pending() { return twi.armed && now >= twi.at; }
+  static void reset() {
+    twi.armed = twi.owned = false;
+  }
+  static uint8_t lock() {
+    uint8_t was = irqEnabled;
+    irqEnabled = false;
+    return was;
+  }
+  static void unlock(uint8_t was) { irqEnabled = was; }
+  static uint32_t micros() {
+    spin(SPIN_CYCLES);
+    return ::micros();
+  }
+};
+
+static Adafruit_I2CAsyncEngine<SimPort> engine;
+
+/**
+ * @brief Stepping timer: compare match when the counter reaches STEP_CYCLES.
+ */
+static struct {
+  bool on;
+  uint64_t zero;     // Cycle at which the counter was (or would have been) 0
+  uint64_t isrCycles;
+} timer;
+
+/**
+ * @brief keypadStepper() of keys.cpp.
+ */
+static void stepper(bool run) {
+  timer.on = run;
+  timer.zero = now - (STEP_CYCLES - STEP_RETRY);
+}
+
+/**
+ * @brief Run the CPU for some cycles, taking the stepping interrupt when due.
+ */
+static void spin(uint64_t cycles) {
+  uint64_t end = now + cycles;
+  while (timer.on && irqEnabled && timer.zero + STEP_CYCLES <= end) {
+    if (now < timer.zero + STEP_CYCLES) now = timer.zero + STEP_CYCLES;
+    uint64_t fired = now;
+    irqEnabled = false;
+    now += ISR_ENTRY_CYCLES;
+    bool handled = engine.step();
+    irqEnabled = true;
+    // ISR(TIMER3_COMPA_vect) reloads TCNT3
+    if (handled) timer.zero = fired + ISR_RELOAD_CYCLES - STEP_LEAD;
+    else timer.zero = fired + ISR_IDLE_RELOAD_CYCLES - (STEP_CYCLES - STEP_RETRY);
+    uint64_t cost = handled ? ISR_EVENT_CYCLES : ISR_IDLE_CYCLES;
+    now = fired + cost;
+    end += cost;  // The interrupted work resumes afterwards
+    timer.isrCycles += cost;
+  }
+  if (now < end) now = end;
+}
+
+/**
+ * @brief Fill a write-then-read transaction.
+ */
+static void prepare(Adafruit_I2CTransaction &t, uint8_t addr, uint8_t reg, uint8_t *buffer,
+                    uint16_t len) {
+  t = Adafruit_I2CTransaction();
+  t.addr = addr;
+  t.inline_data[0] = reg;
+  t.write_buffer = t.inline_data;
+  t.write_len = 1;
+  t.read_buffer = buffer;
+  t.read_len = len;
+}
+
+static bool blockMatches(const uint8_t *buffer, uint8_t reg, uint16_t len) {
+  for (uint16_t i = 0; i < len; i++) {
+    if (buffer[i] != slave.regs[(uint8_t)(reg + i)]) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Block reads, chaining, NACK recovery and a full queue.
+ */
+static void testTransfers(bool stepped) {
+  engine.setStepper(stepped ? stepper : nullptr);
+  uint8_t a[BLOCK_LEN], b[8], c[4];
+  Adafruit_I2CTransaction ta, tb, tc;
+
+  // One block read
+  prepare(ta, SLAVE_ADDR, 0x00, a, BLOCK_LEN);
+  uint32_t stops = twi.stops;
+  CHECK(engine.submit(&ta));
+  CHECK(engine.wait(&ta));
+  CHECK(blockMatches(a, 0x00, BLOCK_LEN));
+  CHECK(twi.stops == stops + 1);
+  CHECK(!engine.busy() && !timer.on);
+
+  // Two reads chain with a repeated START, one STOP at the end
+  prepare(ta, SLAVE_ADDR, 0x10, a, 20);
+  prepare(tb, SLAVE_ADDR, 0x40, b, 8);
+  uint32_t starts = twi.starts, repeated = twi.repeated;
+  stops = twi.stops;
+  CHECK(engine.submit(&ta) && engine.submit(&tb));
+  CHECK(engine.wait(&tb) && ta.state == I2C_ASYNC_DONE);
+  CHECK(blockMatches(a, 0x10, 20) && blockMatches(b, 0x40, 8));
+  CHECK(twi.starts - starts == 4 && twi.repeated - repeated == 3);
+  CHECK(twi.stops == stops + 1);
+  Adafruit_BusTraceEntry first, second;
+  CHECK(BusTrace.get(BusTrace.count() - 2, first) && BusTrace.get(BusTrace.count() - 1, second));
+  CHECK((first.flags & BUSIO_TRACE_NOSTOP) && !(second.flags & BUSIO_TRACE_NOSTOP));
+
+  // A NACKed address fails with a STOP, the next transaction still runs
+  prepare(ta, SLAVE_ADDR + 1, 0x00, a, 2);
+  prepare(tb, SLAVE_ADDR, 0x20, b, 4);
+  CHECK(engine.submit(&ta) && engine.submit(&tb));
+  CHECK(!engine.wait(&ta) && ta.state == I2C_ASYNC_FAILED);
+  CHECK(engine.wait(&tb) && blockMatches(b, 0x20, 4));
+
+  // The queue holds I2C_ASYNC_QUEUE transactions
+  Adafruit_I2CTransaction q[I2C_ASYNC_QUEUE];
+  uint8_t data[I2C_ASYNC_QUEUE][2];
+  uint8_t sreg = SimPort::lock();  // Nothing moves while filling it
+  for (uint8_t i = 0; i < I2C_ASYNC_QUEUE; i++) {
+    prepare(q[i], SLAVE_ADDR, i, data[i], 2);
+    CHECK(engine.submit(&q[i]));
+  }
+  prepare(tc, SLAVE_ADDR, 0, c, 2);
+  CHECK(!engine.submit(&tc));
+  SimPort::unlock(sreg);
+  engine.flush();
+  for (uint8_t i = 0; i < I2C_ASYNC_QUEUE; i++) {
+    CHECK(q[i].state == I2C_ASYNC_DONE && blockMatches(data[i], i, 2));
+  }
+  CHECK(!engine.busy() && !timer.on);
+}
+
+/**
+ * @brief A slave holding the bus: wait() times out and fails the whole queue.
+ */
+static void testTimeout(bool stepped) {
+  engine.setStepper(stepped ? stepper : nullptr);
+  uint8_t a[4], b[4];
+  Adafruit_I2CTransaction ta, tb;
+  slave.stuck = true;
+  prepare(ta, SLAVE_ADDR, 0, a, 4);
+  prepare(tb, SLAVE_ADDR, 4, b, 4);
+  CHECK(engine.submit(&ta) && engine.submit(&tb));
+  uint64_t started = now;
+  CHECK(!engine.wait(&ta, 2000));
+  CHECK(now - started >= 2000 * (CPU_HZ / 1000000UL));
+  CHECK(ta.state == I2C_ASYNC_FAILED && tb.state == I2C_ASYNC_FAILED);
+  CHECK(!engine.busy() && !timer.on);
+  Adafruit_BusTraceEntry last;
+  CHECK(BusTrace.get(BusTrace.count() - 1, last) && last.status == BUSIO_TRACE_TIMEOUT);
+  slave.stuck = false;
+
+  // The bus works again afterwards
+  prepare(ta, SLAVE_ADDR, 0, a, 4);
+  CHECK(engine.submit(&ta) && engine.wait(&ta) && blockMatches(a, 0, 4));
+}
+
+/**
+ * @brief Cycles from startKeyScan() to the end of keyHandler()'s wait.
+ *
+ * @work: Cycles of loop work between the two (readSensors()).
+ */
+static uint64_t scan(bool stepped, uint64_t work) {
+  engine.setStepper(stepped ? stepper : nullptr);
+  uint8_t block[BLOCK_LEN];
+  Adafruit_I2CTransaction t;
+  prepare(t, SLAVE_ADDR, 0x00, block, BLOCK_LEN);
+  uint64_t started = now;
+  CHECK(engine.submit(&t));
+  spin(work);
+  CHECK(engine.wait(&t));
+  CHECK(blockMatches(block, 0x00, BLOCK_LEN));
+  return now - started;
+}
+
+/**
+ * @brief The transfer hides under the loop work once it is stepped.
+ */
+static void testOverlap() {
+  uint64_t transfer = scan(false, 0);
+  printf("keypad block read alone: %.0f us\n", transfer / 16.0);
+  printf("%10s %12s %12s %12s\n", "work (us)", "polled (us)", "stepped (us)", "isr (us)");
+  const uint64_t works[] = {0, 2000, 8000, transfer, 2 * transfer};
+  for (uint8_t i = 0; i < sizeof(works) / sizeof(works[0]); i++) {
+    uint64_t w = works[i];
+    uint64_t polled = scan(false, w);
+    timer.isrCycles = 0;
+    uint64_t stepped = scan(true, w);
+    printf("%10.0f %12.0f %12.0f %12.0f\n", w / 16.0, polled / 16.0, stepped / 16.0,
+           timer.isrCycles / 16.0);
+    // Polled, only the START moves before the wait
+    CHECK(polled + START_CYCLES + SPIN_CYCLES >= w + transfer);
+    // Stepped, the longer of the two plus the interrupts and one timer period
+    uint64_t longer = w > transfer ? w : transfer;
+    CHECK(stepped <= longer + timer.isrCycles + STEP_CYCLES + 2 * SPIN_CYCLES);
+    // With enough work to cover it, only the interrupt time of the transfer is left
+    if (w >= transfer) CHECK(stepped + transfer <= polled + timer.isrCycles + STEP_CYCLES);
+  }
+}
+
+int main() {
+  for (uint16_t i = 0; i < 256; i++) slave.regs[i] = (uint8_t)(i * 7 + 3);
+  testTransfers(false);
+  testTransfers(true);
+  testTimeout(false);
+  testTimeout(true);
+  testOverlap();
+  return checkResult();
+}
@@ -0,0 +1,143 @@
+/* midi_test.cpp - Host test of the key notes midi.cpp sends
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Runs handleSignals() of midi.cpp on touch masks, every 2 ms, and
+ * records the note ons and offs of the keys cable. Two keys play the same
+ * note, as scale lock snapping or clamping at the ends of the MIDI range
+ * make them: the note starts once, keeps sounding while either key is
+ * held, and stops with the last one, whatever the order of the releases.
+ */
+
+#include "keys.h"
+#include "layout.h"
+#include "midi.h"
+#include "sampler.h"
+#include "voice.h"
+#include "MIDIUSB.h"
+#include "check.h"
+
+#define SCAN_US 2000
+#define SHARED_NOTE 60
+#define KEY_A 3
+#define KEY_B 4
+#define KEY_OTHER 7
+
+uint16_t sampled[NUM_SAMPLED];
+
+static unsigned long now = 0;  // Microseconds
+
+unsigned long millis() {
+  return now / 1000;
+}
+
+unsigned long micros() {
+  return now;
+}
+
+uint16_t readElectrode(uint8_t) {
+  return 0;
+}
+
+static int ons[128];  // Note ons per pitch on the keys cable
+static int offs[128];
+
+void MIDI_::sendMIDI(midiEventPacket_t e) {
+  if (e.header >> 4 != MIDI_CABLE_KEYS) return;
+  if ((e.header & 0x0F) == NOTE_ON) ons[e.byte2]++;
+  else if ((e.header & 0x0F) == NOTE_OFF) offs[e.byte2]++;
+}
+
+static KeyInfo k;
+
+/**
+ * @brief Scan with a touch mask for a while.
+ */
+static void hold(uint16_t touched, unsigned long us) {
+  k.touched = touched;
+  for (unsigned long end = now + us; now < end; now += SCAN_US) handleSignals(k);
+}
+
+/**
+ * @brief Whether the shared note sounds (more ons than offs).
+ */
+static bool sounding(uint8_t note) {
+  return ons[note] > offs[note];
+}
+
+/**
+ * @brief Two keys on one note, released in either order or together.
+ */
+static void testSharedNote() {
+  uint16_t a = _BV(KEY_A), b = _BV(KEY_B);
+  const uint16_t releases[][2] = {{a, 0}, {b, 0}, {0, 0}};  // Still held after the first release
+  for (uint8_t r = 0; r < 3; r++) {
+    memset(ons, 0, sizeof(ons));
+    memset(offs, 0, sizeof(offs));
+    hold(a, 20000);
+    CHECK(ons[SHARED_NOTE] == 1);
+    hold(a | b, 20000);
+    CHECK(ons[SHARED_NOTE] == 1);  // Already sounding
+    hold(releases[r][0], 40000);
+    if (releases[r][0]) {
+      // The other key still holds the note
+      CHECK(offs[SHARED_NOTE] == 0 && sounding(SHARED_NOTE));
+      hold(0, 40000);
+    }
+    CHECK(ons[SHARED_NOTE] == 1 && offs[SHARED_NOTE] == 1);
+  }
+
+  // A key joins again while the other one releases: the note goes on
+  memset(ons, 0, sizeof(ons));
+  memset(offs, 0, sizeof(offs));
+  hold(a, 20000);
+  hold(0, 4000);  // Release pending
+  hold(b, 40000);
+  CHECK(sounding(SHARED_NOTE));
+  hold(0, 40000);
+  CHECK(!sounding(SHARED_NOTE) && offs[SHARED_NOTE] == 1);
+}
+
+/**
+ * @brief Keys on other notes are not held back by a shared one.
+ */
+static void testOtherNote() {
+  memset(ons, 0, sizeof(ons));
+  memset(offs, 0, sizeof(offs));
+  hold(_BV(KEY_A) | _BV(KEY_OTHER), 20000);
+  hold(_BV(KEY_A), 40000);
+  CHECK(ons[noteTable[KEY_OTHER]] == 1 && offs[noteTable[KEY_OTHER]] == 1);
+  CHECK(sounding(SHARED_NOTE));
+  hold(0, 40000);
+  CHECK(!sounding(SHARED_NOTE));
+}
+
+int main() {
+  for (uint8_t i = 0; i < NUM_KEYS; i++) {
+    noteTable[i] = 48 + 2 * i;
+    k.filtered[i] = 100;
+    k.baseline[i] = 200;
+  }
+  noteTable[KEY_A] = SHARED_NOTE;
+  noteTable[KEY_B] = SHARED_NOTE;
+  testSharedNote();
+  testOtherNote();
+  return checkResult();
+}
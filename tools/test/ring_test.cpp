@@ -0,0 +1,184 @@
+/* ring_test.cpp - Host stress test of the SPSC ring (MIDIUSB_Ring.h)
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Checks the full/empty edges and wraparound of SPSCRing on one thread,
+ * then runs a producer thread (standing in for the ADC or USB interrupt)
+ * against a consumer thread (the loop) through millions of index wraps:
+ *  - lossless: the producer retries when full, the consumer must see every
+ *    value once and in order, through every push and pop variant;
+ *  - lossy: the producer drops when full like the ISRs do, the consumer
+ *    must see strictly increasing values and nothing but the drops missing.
+ * The threads yield where they would spin, so this also runs on one core.
+ */
+
+// Two cores need a hardware fence where one AVR core only needs the compiler barrier
+#define SPSC_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#include "MIDIUSB_Ring.h"
+#include "check.h"
+#include <thread>
+
+#define STRESS_VALUES 4000000UL
+
+/**
+ * @brief Single threaded edges: empty, full, partial batches and spans at the wrap.
+ */
+static void testEdges() {
+  static SPSCRing<uint32_t, 8> r;
+  uint32_t v = 0;
+  CHECK(r.capacity() == 8);
+  CHECK(r.empty() && r.available() == 0 && r.space() == 8);
+  CHECK(!r.pop(v) && !r.peek(v));
+
+  for (uint32_t i = 0; i < 8; i++) CHECK(r.push(i));
+  CHECK(!r.push(99));
+  CHECK(r.available() == 8 && r.space() == 0);
+  CHECK(r.peek(v) && v == 0);
+  CHECK(r.pop(v) && v == 0);
+
+  uint32_t batch[8] = {8, 9, 10};
+  CHECK(r.pushMany(batch, 3) == 1);  // Only one slot was free
+  uint32_t out[8];
+  CHECK(r.popMany(out, 8) == 8);
+  for (uint32_t i = 0; i < 8; i++) CHECK(out[i] == i + 1);
+  CHECK(r.empty() && r.popMany(out, 8) == 0);
+
+  // Indices now sit at 9: the span stops at the end of the slots
+  uint32_t *span;
+  CHECK(r.writeSpan(span) == 7);
+  for (uint32_t i = 0; i < 7; i++) span[i] = 100 + i;
+  r.commit(7);
+  CHECK(r.writeSpan(span) == 1);
+  span[0] = 107;
+  r.commit(1);
+  CHECK(r.writeSpan(span) == 0 && r.space() == 0);
+  for (uint32_t i = 0; i < 8; i++) CHECK(r.pop(v) && v == 100 + i);
+
+  // The 8-bit indices wrap every 256 elements
+  for (uint32_t i = 0; i < 1000; i++) {
+    CHECK(r.push(i) && r.pop(v) && v == i);
+  }
+  r.push(1);
+  r.clear();
+  CHECK(r.empty() && r.space() == 8);
+}
+
+/**
+ * @brief Every value arrives once and in order, whichever call moved it.
+ */
+template <uint8_t N>
+static void testLossless() {
+  static SPSCRing<uint32_t, N> r;
+  uint32_t errors = 0;
+
+  std::thread producer([] {
+    uint32_t next = 0, round = 0;
+    while (next < STRESS_VALUES) {
+      if (!r.space()) std::this_thread::yield();
+      switch (round++ % 3) {
+        case 0:
+          if (r.push(next)) next++;
+          break;
+        case 1: {
+          uint32_t batch[5];
+          uint8_t n = 1 + round % 5;
+          for (uint8_t i = 0; i < n; i++) batch[i] = next + i;
+          next += r.pushMany(batch, next + n > STRESS_VALUES ? 1 : n);
+          break;
+        }
+        default: {
+          uint32_t *span;
+          uint8_t n = r.writeSpan(span);
+          if (n > STRESS_VALUES - next) n = STRESS_VALUES - next;
+          for (uint8_t i = 0; i < n; i++) span[i] = next + i;
+          r.commit(n);
+          next += n;
+        }
+      }
+    }
+  });
+
+  uint32_t expected = 0, round = 0;
+  while (expected < STRESS_VALUES) {
+    if (r.empty()) std::this_thread::yield();
+    uint32_t out[7];
+    uint8_t n = 0;
+    if (round++ & 1) {
+      uint32_t peeked;
+      if (r.peek(peeked)) {
+        if (!r.pop(out[0]) || out[0] != peeked) errors++;
+        n = 1;
+      }
+    } else {
+      n = r.popMany(out, 1 + round % 7);
+    }
+    for (uint8_t i = 0; i < n; i++) {
+      if (out[i] != expected) errors++;
+      expected = out[i] + 1;
+    }
+  }
+  producer.join();
+  CHECK(errors == 0);
+  CHECK(r.empty());
+  printf("lossless N=%u: %lu values, %lu out of order\n", N, (unsigned long)STRESS_VALUES,
+         (unsigned long)errors);
+}
+
+/**
+ * @brief A producer that drops when full: only dropped values may be missing.
+ */
+static void testLossy() {
+  static SPSCRing<uint32_t, 8> r;
+  static volatile bool done = false;
+  uint32_t dropped = 0;
+
+  std::thread producer([&dropped] {
+    for (uint32_t i = 1; i <= STRESS_VALUES; i++) {
+      if (!r.push(i)) dropped++;
+      if (i % 13 == 0) std::this_thread::yield();  // Bursts of conversions, then the loop runs
+    }
+    done = true;
+  });
+
+  uint32_t last = 0, received = 0, disorder = 0, v;
+  for (;;) {
+    bool finished = done;
+    std::this_thread::yield();
+    while (r.pop(v)) {
+      if (v <= last) disorder++;
+      last = v;
+      received++;
+    }
+    if (finished && r.empty()) break;
+  }
+  producer.join();
+  CHECK(disorder == 0);
+  CHECK(received + dropped == STRESS_VALUES);
+  printf("lossy N=8: %lu received, %lu dropped, %lu out of order\n", (unsigned long)received,
+         (unsigned long)dropped, (unsigned long)disorder);
+}
+
+int main() {
+  testEdges();
+  testLossless<8>();
+  testLossless<128>();
+  testLossy();
+  return checkResult();
+}
@@ -0,0 +1,95 @@
+/* sensors_test.cpp - Host test of the sensor filter stage
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Drives a smoothed bend channel through sensors.cpp: single spikes are
+ * ignored, a step of more than SPIKE_THRESHOLD is followed after one held
+ * back sample, small steps are smoothed. The divider conversion table
+ * agrees with the division it replaces, for every reading of both boards.
+ */
+
+#include "sensors.h"
+#include "sampler.h"
+#include "board.h"
+#include "tuning.h"
+#include "utils.h"
+#include "check.h"
+
+uint16_t sampled[NUM_SAMPLED];
+
+uint16_t readElectrode(uint8_t) {
+  return 0;
+}
+
+/**
+ * @brief ADC reading of a divider resistance (inverse of rawToOhms()).
+ */
+static uint16_t ohmsToRaw(uint32_t r) {
+  return (uint32_t)analogResolution * Board::R0 / (r + Board::R0);
+}
+
+/**
+ * @brief Scan with the RIGHT bend sensor at a resistance, its filtered output.
+ */
+static uint16_t scan(uint32_t r) {
+  sampled[RIGHT] = ohmsToRaw(r);
+  readSensors();
+  return sensors.out[RIGHT];
+}
+
+/**
+ * @brief rawToOhms() of board B against R0 * (resolution - raw) / raw.
+ */
+template <class B>
+static void checkOhmsTable() {
+  for (uint16_t raw = 0; raw < analogResolution; raw++) {
+    uint32_t r = raw ? (uint32_t)B::R0 * (analogResolution - raw) / raw : 0xFFFFFFFF;
+    CHECK(rawToOhms<B>(raw) == (r < 0xFFFF ? r : 0xFFFF));
+  }
+}
+
+int main() {
+  checkOhmsTable<ClothV1>();
+  checkOhmsTable<ClothV1Low>();
+  for (uint8_t i = 0; i < NUM_SAMPLED; i++) sampled[i] = ohmsToRaw(600);
+  setupSensors();
+  uint16_t rest = scan(600);
+
+  // A single spike is ignored
+  CHECK(scan(200) == rest);
+  CHECK(scan(600) == rest);
+
+  // A real step is followed once the second sample agrees
+  CHECK(scan(200) == rest);
+  uint16_t stepped = scan(210);
+  CHECK(stepped < 200 + SPIKE_THRESHOLD && stepped >= 200 - DEAD_ZONE);
+  for (uint8_t n = 0; n < 50; n++) stepped = scan(210);
+  CHECK(stepped >= 210 - DEAD_ZONE && stepped <= 210 + DEAD_ZONE);
+
+  // Alternating spikes in both directions never agree
+  for (uint8_t n = 0; n < 10; n++) {
+    CHECK(scan(n & 1 ? 20 : 600) == stepped);
+  }
+
+  // Small steps are smoothed toward the reading
+  uint16_t out = scan(260);
+  CHECK(out > stepped && out < 260);
+  return checkResult();
+}
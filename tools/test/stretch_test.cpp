@@ -0,0 +1,212 @@
+/* stretch_test.cpp - Host test of the stretch expression
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Steps the stretch expression every 2 ms:
+ *  - stepStretch() on a ramp from rest to full stretch and back, with
+ *    holds between: the rate has the sign of the ramp (negative while
+ *    stretching) and its slope within RATE_TOLERANCE, settles where its
+ *    EMA stalls on a hold, and the amount spans 0 to 16383, back to 0
+ *    exactly;
+ *  - serviceStretch() through midi.cpp, for every STRETCH_OUT_* output and
+ *    both sources, on the same ramp with uniform noise on the reading: the
+ *    messages per second while held (once settled) and while ramping are
+ *    reported, and the output ends exactly at its rest value once the
+ *    sensor is back.
+ */
+
+#include "stretch.h"
+#include "keys.h"
+#include "midi.h"
+#include "sampler.h"
+#include "sensors.h"
+#include "MIDIUSB.h"
+#include "check.h"
+
+#define STEP_MS 2
+#define REST_R 20000
+#define FULL_R 10000
+#define RAMP_MS 1000  // 10000 Ω/s
+#define HOLD_MS 1000
+#define NOISE_R 20  // Uniform +-NOISE_R
+#define RATE_TOLERANCE 10  // %
+
+uint16_t sampled[NUM_SAMPLED];
+
+static unsigned long nowUs = 0;
+
+unsigned long millis() {
+  return nowUs / 1000;
+}
+
+unsigned long micros() {
+  return nowUs;
+}
+
+uint16_t readElectrode(uint8_t) {
+  return 0;
+}
+
+static unsigned messages;  // Stretch messages on the expression cable
+static uint16_t lastSent;  // Their last value (7 or 14 bit)
+
+void MIDI_::sendMIDI(midiEventPacket_t e) {
+  if (e.header >> 4 != MIDI_CABLE_EXPRESSION) return;
+  switch (e.header & 0x0F) {
+    case 0x0B:
+      if (e.byte2 != stretchCC) return;
+      lastSent = e.byte3;
+      break;
+    case CIN_PITCH_BEND: lastSent = e.byte2 | e.byte3 << 7; break;
+    case CIN_CHANNEL_PRESSURE: lastSent = e.byte2; break;
+    default: return;
+  }
+  messages++;
+}
+
+static uint32_t seed = 1;
+
+/**
+ * @brief Uniform noise of +-NOISE_R (LCG, repeatable).
+ */
+static int noise() {
+  seed = seed * 1103515245 + 12345;
+  return (int)((seed >> 16) % (2 * NOISE_R + 1)) - NOISE_R;
+}
+
+#define SETTLE_MS 500  // The filters follow a change of slope within this
+#define RAMP_TOTAL_MS (3 * HOLD_MS + 2 * RAMP_MS)
+
+/**
+ * @brief Phase of the test ramp at a time: rest, ramp down to full
+ * stretch, hold, ramp back up, rest.
+ *
+ * @since: Receives the time since the phase started.
+ * @return 0 rest, 1 ramp down, 2 hold, 3 ramp up, 4 rest.
+ */
+static uint8_t phase(uint32_t ms, uint32_t &since) {
+  static const uint32_t length[] = {HOLD_MS, RAMP_MS, HOLD_MS, RAMP_MS};
+  uint8_t p = 0;
+  for (; p < 4 && ms >= length[p]; p++) ms -= length[p];
+  since = ms;
+  return p;
+}
+
+/**
+ * @brief Reading of the test sensor at a time of the ramp.
+ */
+static uint16_t ramp(uint32_t ms) {
+  uint32_t since;
+  switch (phase(ms, since)) {
+    case 1: return REST_R - (uint32_t)(REST_R - FULL_R) * since / RAMP_MS;
+    case 2: return FULL_R;
+    case 3: return FULL_R + (uint32_t)(REST_R - FULL_R) * since / RAMP_MS;
+    default: return REST_R;
+  }
+}
+
+/**
+ * @brief Rate and amount of stepStretch() on the ramp, without noise.
+ */
+static void testStep() {
+  StretchState s = {};
+  int32_t expected = (int32_t)(REST_R - FULL_R) * 1000 / RAMP_MS;
+  int16_t minRate = 0, maxRate = 0;
+  uint16_t maxAmount = 0;
+  for (uint32_t ms = 0; ms < RAMP_TOTAL_MS; ms += STEP_MS) {
+    stepStretch(s, ramp(ms), FULL_R, REST_R, (uint16_t)ms);
+    if (s.amount > maxAmount) maxAmount = s.amount;
+    uint32_t since;
+    uint8_t p = phase(ms, since);
+    if (since < SETTLE_MS) continue;
+    if (p == 1 || p == 3) {
+      // Stretching lowers the resistance: negative rate
+      CHECK(p == 1 ? s.rate < 0 : s.rate > 0);
+      int32_t err = (p == 1 ? -s.rate : s.rate) - expected;
+      CHECK(err * 100 <= expected * RATE_TOLERANCE && -err * 100 <= expected * RATE_TOLERANCE);
+      if (s.rate < minRate) minRate = s.rate;
+      if (s.rate > maxRate) maxRate = s.rate;
+    } else if (since == HOLD_MS - STEP_MS) {
+      // End of a hold: the rate settled where its EMA stalls
+      CHECK(s.rate > -(1 << STRETCH_RATE_SHIFT) && s.rate < (1 << STRETCH_RATE_SHIFT));
+    }
+  }
+  printf("ramp of %ld Ω/s: rate %d..%d Ω/s, amount up to %u\n", (long)expected, minRate, maxRate,
+         maxAmount);
+  CHECK(maxAmount == 16383);
+  CHECK(s.amount == 0);
+}
+
+/**
+ * @brief Messages of one output and source on the noisy ramp.
+ */
+static void testOutput(uint8_t output, uint8_t source, const char *name) {
+  // A fresh state: the sensor was at rest, nothing sent yet
+  stretchOutput = STRETCH_OUT_NONE;
+  serviceStretch(0);
+  sensors.minR[S] = (uint32_t)FULL_R << 16;
+  sensors.maxR[S] = (uint32_t)REST_R << 16;
+  stretchOutput = output;
+  stretchSource = source;
+  uint16_t rest = output == STRETCH_OUT_PITCHBEND ? STRETCH_BEND_CENTER : 0;
+  messages = 0;
+  lastSent = rest;
+  unsigned held = 0, slope = 0;
+  uint32_t heldMs = 0, slopeMs = 0;
+  for (uint32_t ms = 0; ms < RAMP_TOTAL_MS; ms += STEP_MS) {
+    nowUs = ms * 1000;
+    sensors.R[S] = ramp(ms) + noise();
+    unsigned before = messages;
+    serviceStretch((uint16_t)ms);
+    flushMidi();
+    uint32_t since;
+    uint8_t p = phase(ms, since);
+    if (p == 1 || p == 3) {
+      slope += messages - before;
+      slopeMs += STEP_MS;
+    } else if (since >= SETTLE_MS) {
+      held += messages - before;
+      heldMs += STEP_MS;
+    }
+  }
+  // The sensor is back at rest, without noise
+  for (uint32_t ms = RAMP_TOTAL_MS; ms < RAMP_TOTAL_MS + HOLD_MS; ms += STEP_MS) {
+    sensors.R[S] = REST_R;
+    serviceStretch((uint16_t)ms);
+    flushMidi();
+  }
+  printf("%-22s %6.1f msgs/s held, %6.1f msgs/s ramping, ends at %u\n", name,
+         held * 1000.0 / heldMs, slope * 1000.0 / slopeMs, lastSent);
+  CHECK(lastSent == rest);
+  CHECK(source == STRETCH_SRC_RATE || slope > 0);  // A steady rate is one value
+  // Still and noisy: the change thresholds keep the output quiet
+  CHECK(held * 1000 / heldMs <= 10);
+}
+
+int main() {
+  testStep();
+  testOutput(STRETCH_OUT_CC, STRETCH_SRC_AMOUNT, "CC, amount");
+  testOutput(STRETCH_OUT_PITCHBEND, STRETCH_SRC_AMOUNT, "pitch bend, amount");
+  testOutput(STRETCH_OUT_PRESSURE, STRETCH_SRC_AMOUNT, "pressure, amount");
+  testOutput(STRETCH_OUT_CC, STRETCH_SRC_RATE, "CC, rate");
+  testOutput(STRETCH_OUT_PITCHBEND, STRETCH_SRC_RATE, "pitch bend, rate");
+  testOutput(STRETCH_OUT_PRESSURE, STRETCH_SRC_RATE, "pressure, rate");
+  return checkResult();
+}
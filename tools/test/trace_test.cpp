@@ -0,0 +1,172 @@
+/* trace_test.cpp - Replay sensor traces through the firmware's gesture recognition
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Replays the traces in tools/test/traces through sensors.cpp and
+ * gesture.cpp and compares the gesture events with the ones the trace
+ * expects.
+ *
+ * A trace is a CSV as written by keycloth_capture.py export (columns us
+ * and adc0..adc3 are used, others ignored), with '#' comment lines; a line
+ *   # events: <crumple|stretch> <ON|OFF|HOLD>...
+ * gives the expected event sequence of a gesture.
+ */
+
+#include "sensors.h"
+#include "sampler.h"
+#include "gesture.h"
+#include "tuning.h"
+#include "check.h"
+#include <string>
+#include <vector>
+
+#define TRACES "traces"
+#define MAX_LINE 1024
+
+uint16_t sampled[NUM_SAMPLED];
+
+uint16_t readElectrode(uint8_t) {
+  return 0;
+}
+
+/**
+ * @brief As gestureConfig in midi.cpp (the note does not matter here).
+ */
+static const GestureConfig gestureConfig[NUM_GESTURES] = {
+  {CRUMPLE_ENTER_R, CRUMPLE_EXIT_R, MIDDLE_THRESHOLD, 15, 500, 0},
+  {STRETCH_ENTER_R, STRETCH_EXIT_R, MIDDLE_THRESHOLD, 15, 500, 0},
+};
+
+static const char *const gestureNames[NUM_GESTURES] = {"crumple", "stretch"};
+static const char *const eventNames[] = {"NONE", "ON", "OFF", "HOLD"};
+
+/**
+ * @brief One trace: scans and the expected events per gesture.
+ */
+struct Trace {
+  std::vector<uint32_t> us;
+  std::vector<std::vector<uint16_t> > adc;
+  std::string expected[NUM_GESTURES];
+  bool checked[NUM_GESTURES];
+};
+
+static bool load(const std::string &path, Trace &t) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) return false;
+  char line[MAX_LINE];
+  int column[1 + NUM_SAMPLED];  // CSV column of us, adc0..
+  bool header = false;
+  for (uint8_t g = 0; g < NUM_GESTURES; g++) t.checked[g] = false;
+  while (fgets(line, sizeof(line), f)) {
+    std::string s(line);
+    while (!s.empty() && (s.back() == '\n' || s.back() == '\r')) s.pop_back();
+    if (s.empty()) continue;
+    if (s[0] == '#') {
+      size_t at = s.find("events:");
+      if (at == std::string::npos) continue;
+      char name[16];
+      int used = 0;
+      if (sscanf(s.c_str() + at + 7, " %15s %n", name, &used) < 1) continue;
+      for (uint8_t g = 0; g < NUM_GESTURES; g++) {
+        if (std::string(name) == gestureNames[g]) {
+          t.expected[g] = s.substr(at + 7 + used);
+          t.checked[g] = true;
+        }
+      }
+      continue;
+    }
+    // Split the line
+    std::vector<std::string> cells;
+    size_t start = 0;
+    for (size_t comma; (comma = s.find(',', start)) != std::string::npos; start = comma + 1) {
+      cells.push_back(s.substr(start, comma - start));
+    }
+    cells.push_back(s.substr(start));
+    if (!header) {
+      for (uint8_t i = 0; i <= NUM_SAMPLED; i++) {
+        std::string want = i ? "adc" + std::to_string(i - 1) : "us";
+        column[i] = -1;
+        for (size_t c = 0; c < cells.size(); c++) {
+          if (cells[c] == want) column[i] = c;
+        }
+        if (column[i] < 0) {
+          fprintf(stderr, "%s: no column %s\n", path.c_str(), want.c_str());
+          fclose(f);
+          return false;
+        }
+      }
+      header = true;
+      continue;
+    }
+    t.us.push_back(strtoul(cells[column[0]].c_str(), NULL, 10));
+    std::vector<uint16_t> adc(NUM_SAMPLED);
+    for (uint8_t i = 0; i < NUM_SAMPLED; i++) adc[i] = atoi(cells[column[1 + i]].c_str());
+    t.adc.push_back(adc);
+  }
+  fclose(f);
+  return header && !t.us.empty();
+}
+
+/**
+ * @brief Replay a trace, the gestures' events as "ON OFF ..." per gesture.
+ */
+static void replay(const Trace &t, std::string events[NUM_GESTURES]) {
+  GestureInfo gestures[NUM_GESTURES] = {};
+  memcpy(sampled, &t.adc[0][0], sizeof(sampled));
+  setupSensors();
+  for (size_t n = 0; n < t.us.size(); n++) {
+    memcpy(sampled, &t.adc[n][0], sizeof(sampled));
+    readSensors();
+    // As handleGesture() in midi.cpp: gestures exclude each other
+    for (uint8_t i = 0; i < NUM_SENSORS; i++) {
+      const SensorConfig &c = sensorConfig[i];
+      if (c.emit != EMIT_GESTURE) continue;
+      bool blocked = false;
+      for (uint8_t j = 0; j < NUM_GESTURES; j++) {
+        if (j != c.param && gestures[j].state != GESTURE_REST) blocked = true;
+      }
+      uint8_t e = stepGesture(gestures[c.param], gestureConfig[c.param], sensors.R[i],
+                              (uint16_t)(t.us[n] / 1000), blocked);
+      if (e == GESTURE_NONE) continue;
+      if (!events[c.param].empty()) events[c.param] += " ";
+      events[c.param] += eventNames[e];
+    }
+  }
+}
+
+int main() {
+  // The traces live next to this file
+  std::string dir = __FILE__;
+  dir = dir.substr(0, dir.rfind('/') + 1) + TRACES + "/";
+  static const char *const traces[] = {"stretch.csv"};
+  for (const char *name : traces) {
+    Trace t;
+    bool loaded = load(dir + name, t);
+    CHECK(loaded);
+    if (!loaded) continue;
+    std::string events[NUM_GESTURES];
+    replay(t, events);
+    for (uint8_t g = 0; g < NUM_GESTURES; g++) {
+      printf("%s %s: %s\n", name, gestureNames[g], events[g].c_str());
+      if (t.checked[g]) CHECK(events[g] == t.expected[g]);
+    }
+  }
+  return checkResult();
+}
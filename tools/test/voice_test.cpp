@@ -0,0 +1,158 @@
+/* voice_test.cpp - Host test of the key voices: trills, glitches and panic
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Drives stepVoices() with touch masks at the scan rate and checks the
+ * note on and off edges:
+ *  - a 20 Hz trill (25 ms on, 25 ms off) between two keys plays every
+ *    note, each within VOICE_ATTACK_MS (on) or VOICE_RELEASE_MS (off) plus
+ *    one scan of its edge, across the 16-bit millisecond wrap;
+ *  - single-scan glitches play nothing: a touch shorter than
+ *    VOICE_ATTACK_MS starts no note, a release shorter than
+ *    VOICE_RELEASE_MS neither stops nor restarts the sounding one;
+ *  - after the panic path (notes released, resetVoices()) held keys
+ *    attack again and released ones stay quiet.
+ */
+
+#include "voice.h"
+#include "check.h"
+
+#define SCAN_MS 2
+#define KEY_A 2
+#define KEY_B 9
+
+static VoiceState v;
+static uint16_t nowMs;
+static uint16_t sounding;  // Keys with a note on and no note off since
+static unsigned ons, offs;
+static bool doubled;  // A note on of a sounding key, or a note off of a silent one
+
+/**
+ * @brief Scan with a touch mask for a while, recording the edges.
+ *
+ * @onAt: Receives the time of the last note on, if any.
+ * @offAt: Receives the time of the last note off, if any.
+ */
+static void hold(uint16_t touched, uint16_t ms, uint16_t *onAt = nullptr, uint16_t *offAt = nullptr) {
+  for (uint16_t end = nowMs + ms; nowMs != end; nowMs += SCAN_MS) {
+    uint16_t on, off;
+    stepVoices(v, touched, nowMs, on, off);
+    if ((on & sounding) || (off & ~sounding)) doubled = true;
+    sounding = (sounding | on) & ~off;
+    ons += __builtin_popcount(on);
+    offs += __builtin_popcount(off);
+    if (on && onAt) *onAt = nowMs;
+    if (off && offAt) *offAt = nowMs;
+  }
+}
+
+/**
+ * @brief All voices idle, the clock at ms, the counts cleared.
+ */
+static void start(uint16_t ms) {
+  resetVoices(v);
+  nowMs = ms;
+  sounding = 0;
+  ons = offs = 0;
+  doubled = false;
+}
+
+/**
+ * @brief 20 Hz trill between two keys.
+ */
+static void testTrill() {
+  start(0xFF00);  // Wraps during the trill
+  uint16_t a = _BV(KEY_A), b = _BV(KEY_B);
+  uint16_t worstOn = 0, worstOff = 0;
+  for (uint8_t n = 0; n < 40; n++) {
+    uint16_t edge = nowMs, onAt = edge - 1, offAt = edge - 1;
+    hold(n & 1 ? b : a, 26, &onAt, &offAt);  // 25 ms, rounded up to whole scans
+    CHECK(onAt != (uint16_t)(edge - 1));
+    if ((uint16_t)(onAt - edge) > worstOn) worstOn = onAt - edge;
+    if (n) {
+      CHECK(offAt != (uint16_t)(edge - 1));
+      if ((uint16_t)(offAt - edge) > worstOff) worstOff = offAt - edge;
+    }
+  }
+  hold(0, 20);
+  printf("20 Hz trill: %u note ons, %u note offs, on after %u ms, off after %u ms at most\n",
+         ons, offs, worstOn, worstOff);
+  CHECK(ons == 40 && offs == 40 && !sounding && !doubled);
+  CHECK(worstOn <= VOICE_ATTACK_MS + SCAN_MS);
+  CHECK(worstOff <= VOICE_RELEASE_MS + SCAN_MS);
+}
+
+/**
+ * @brief Touches and releases of a single scan.
+ */
+static void testGlitches() {
+  uint16_t a = _BV(KEY_A);
+  start(0);
+  // Touch glitches, shorter than VOICE_ATTACK_MS: no note
+  for (uint8_t n = 0; n < 10; n++) {
+    hold(a, SCAN_MS);
+    hold(0, 10);
+  }
+  CHECK(ons == 0 && offs == 0);
+
+  // Release glitches of a sounding note, shorter than VOICE_RELEASE_MS (and
+  // VOICE_ATTACK_MS): it keeps sounding, no retrigger
+  hold(a, 10);
+  CHECK(ons == 1);
+  for (uint8_t n = 0; n < 10; n++) {
+    hold(0, SCAN_MS);
+    hold(a, 10);
+  }
+  CHECK(ons == 1 && offs == 0 && sounding == a);
+  hold(0, 20);
+  CHECK(offs == 1 && !sounding && !doubled);
+}
+
+/**
+ * @brief Voices after a panic.
+ */
+static void testPanic() {
+  uint16_t a = _BV(KEY_A), b = _BV(KEY_B);
+  start(100);
+  hold(a | b, 10);
+  CHECK(ons == 2);
+  // handleSignals(): all notes off, then the voices return to idle
+  sounding = 0;
+  resetVoices(v);
+  ons = 0;
+  // Still held: attack again; released: nothing
+  hold(a, 10);
+  CHECK(ons == 1 && sounding == a && !doubled);
+  hold(0, 20);
+  CHECK(offs == 1 && !sounding);
+  // A panic during a pending attack drops it, the held key starts over
+  hold(b, SCAN_MS);
+  resetVoices(v);
+  uint16_t edge = nowMs, onAt = edge;
+  hold(b, 10, &onAt);
+  CHECK((uint16_t)(onAt - edge) >= VOICE_ATTACK_MS && sounding == b);
+}
+
+int main() {
+  testTrill();
+  testGlitches();
+  testPanic();
+  return checkResult();
+}
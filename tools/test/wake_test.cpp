@@ -0,0 +1,337 @@
+/* wake_test.cpp - Host test of the idle to touch wake-up of the keypad
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Runs Adafruit_MPR121 against a model of the chip on the I2C calls, and
+ * the wake-up of power.cpp and keys.cpp on a simulated clock:
+ *  - idle, the chip samples every 2^IDLE_KEYPAD_ESI ms and the loop reads
+ *    the touch status every IDLE_POLL_MS;
+ *  - the scan that finds a touch starts the attack of its voice, then
+ *    wakes up, which writes the awake sample period (a stop and restart of
+ *    the chip, as setKeypadSamplePeriod() does);
+ *  - awake, the loop scans every AWAKE_LOOP_US until the note starts.
+ * With the baselines kept across the restart every touch plays, and the
+ * latency from touch to note on is reported. Reloaded (CL=10, the restart
+ * before), the touch becomes its own baseline and the note is lost; the
+ * same holds for a hand hovering over the proximity channel. With the
+ * proximity channel off its data and baseline read 0.
+ *
+ * The model: the touch status of an enabled channel is set when the
+ * baseline exceeds the data by more than the touch threshold and cleared
+ * below the release threshold, once per sample period. The baseline
+ * follows rising data at once (the fast rising filter of begin()) and
+ * ignores falling data (the falling filters take far longer than a
+ * replay). Stop mode clears the touch status; restarting with CL=10 loads
+ * the baselines with the 5 high bits of the data, CL=00 keeps them.
+ */
+
+#include <Adafruit_MPR121.h>
+#include "keys.h"
+#include "power.h"
+#include "voice.h"
+#include "check.h"
+
+#define KEYPAD_CONFIG2 0x20  // As keys.cpp
+#define AWAKE_LOOP_US 1730  // keycloth.ino loop() awake, as estimated in arp_test.cpp
+#define UNTOUCHED_DATA 700
+#define TOUCHED_DATA 640
+#define PROX_DATA 600
+#define HOVER_DATA 580
+#define TEST_KEY 5
+
+static unsigned long now = 0;  // Microseconds
+
+unsigned long micros() {
+  return now;
+}
+
+unsigned long millis() {
+  return now / 1000;
+}
+
+/**
+ * @brief The MPR121, on its registers.
+ */
+struct Mpr121Model {
+  uint8_t regs[0x81];
+  uint16_t data[13];  // Electrode data, set by the test
+  uint16_t baseline[13];
+  uint16_t status;
+  unsigned long nextSampleUs;
+  unsigned long samples;  // Sample periods run, for the conversion rate
+
+  void reset() {
+    memset(regs, 0, sizeof(regs));
+    regs[MPR121_CONFIG1] = 0x10;
+    regs[MPR121_CONFIG2] = 0x24;
+    memset(baseline, 0, sizeof(baseline));
+    status = 0;
+  }
+
+  bool running() { return regs[MPR121_ECR] & 0x3F; }
+
+  unsigned long periodUs() { return 1000UL << (regs[MPR121_CONFIG2] & 0x07); }
+
+  /**
+   * @brief Run the sample periods up to now.
+   */
+  void runUntil(unsigned long us) {
+    if (!running()) return;
+    for (; nextSampleUs <= us; nextSampleUs += periodUs()) sample();
+  }
+
+  void sample() {
+    samples++;
+    for (uint8_t c = 0; c < 13; c++) {
+      bool enabled = c < 12 ? c < (regs[MPR121_ECR] & 0x0F) : (regs[MPR121_ECR] & 0x30);
+      if (!enabled) continue;
+      uint8_t touch = c < 12 ? regs[MPR121_TOUCHTH_0 + 2 * c] : regs[MPR121_PROXTOUCHTH];
+      uint8_t release = c < 12 ? regs[MPR121_RELEASETH_0 + 2 * c] : regs[MPR121_PROXRELEASETH];
+      int delta = (int)baseline[c] - (int)data[c];
+      if (delta > touch) status |= 1 << c;
+      else if (delta < release) status &= ~(1 << c);
+      if (!(status & (1 << c)) && data[c] > baseline[c]) baseline[c] = data[c];
+    }
+  }
+
+  void write(uint8_t reg, uint8_t value) {
+    if (reg == MPR121_SOFTRESET) {
+      if (value == 0x63) reset();
+      return;
+    }
+    if (reg == MPR121_ECR) {
+      bool start = !running() && (value & 0x3F);
+      regs[reg] = value;
+      if (!running()) status = 0;
+      if (start) {
+        for (uint8_t c = 0; c < 13 && (value & 0x80); c++) {
+          baseline[c] = (value & 0x40) ? data[c] : data[c] & 0x3E0;
+        }
+        nextSampleUs = now + periodUs();
+      }
+      return;
+    }
+    regs[reg] = value;
+  }
+
+  uint8_t read(uint8_t reg) {
+    if (reg == MPR121_TOUCHSTATUS_L) return status & 0xFF;
+    if (reg == MPR121_TOUCHSTATUS_H) return status >> 8;
+    if (reg >= MPR121_FILTDATA_0L && reg < MPR121_BASELINE_0) {
+      uint16_t d = data[(reg - MPR121_FILTDATA_0L) / 2];
+      return (reg & 1) ? d >> 8 : d & 0xFF;
+    }
+    if (reg >= MPR121_BASELINE_0 && reg < MPR121_BASELINE_0 + 13) {
+      return baseline[reg - MPR121_BASELINE_0] >> 2;
+    }
+    return regs[reg];
+  }
+};
+
+static Mpr121Model chip;
+
+// The bus calls Adafruit_MPR121 ends in, on the model
+Adafruit_I2CDevice::Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire)
+    : _addr(addr), _wire(theWire), _begun(false), _maxBufferSize(32) {}
+
+bool Adafruit_I2CDevice::begin(bool) {
+  _begun = true;
+  return true;
+}
+
+bool Adafruit_I2CDevice::write(const uint8_t *buffer, size_t len, bool,
+                               const uint8_t *prefix_buffer, size_t prefix_len) {
+  if (prefix_len != 1) return false;
+  chip.runUntil(now);
+  for (size_t i = 0; i < len; i++) chip.write(prefix_buffer[0] + i, buffer[i]);
+  return true;
+}
+
+bool Adafruit_I2CDevice::write_then_read(const uint8_t *write_buffer, size_t write_len,
+                                         uint8_t *read_buffer, size_t read_len, bool) {
+  if (write_len != 1) return false;
+  chip.runUntil(now);
+  for (size_t i = 0; i < read_len; i++) read_buffer[i] = chip.read(write_buffer[0] + i);
+  return true;
+}
+
+bool Adafruit_I2CDevice::write_then_read_async(const uint8_t *, size_t, uint8_t *, size_t,
+                                               Adafruit_I2CTransaction &,
+                                               busio_i2c_async_callback_t) {
+  return false;
+}
+
+bool Adafruit_I2CDevice::wait(Adafruit_I2CTransaction &) {
+  return false;
+}
+
+// Adafruit_BusIO_Register links against SPI too, the test never uses it
+bool Adafruit_SPIDevice::write(const uint8_t *, size_t, const uint8_t *, size_t) {
+  return false;
+}
+
+bool Adafruit_SPIDevice::write_then_read(const uint8_t *, size_t, uint8_t *, size_t, uint8_t) {
+  return false;
+}
+
+void delay(unsigned long ms) {
+  now += ms * 1000;
+  chip.runUntil(now);
+}
+
+static Adafruit_MPR121 cap;
+
+/**
+ * @brief Advance the clock, the chip sampling on its own.
+ */
+static void run(unsigned long us) {
+  now += us;
+  chip.runUntil(now);
+}
+
+/**
+ * @brief A freshly started chip with nothing touched, the device idle.
+ *
+ * @keepBaselines: Going idle restarts the chip with CL=00, and so does
+ * every later restart.
+ */
+static void startIdle(bool proximity, bool keepBaselines) {
+  now = 0;
+  chip.samples = 0;
+  for (uint8_t c = 0; c < 12; c++) chip.data[c] = UNTOUCHED_DATA;
+  chip.data[MPR121_PROXIMITY_CHANNEL] = PROX_DATA;
+  CHECK(cap.begin(MPR121_I2CADDR_DEFAULT, nullptr));
+  if (proximity) cap.setProximity(KEYPAD_PROX_ELECTRODES, PROX_TOUCH_THRESHOLD, PROX_RELEASE_THRESHOLD);
+  run(20000);  // Rising baselines settle
+  cap.writeRegister(MPR121_CONFIG2, KEYPAD_CONFIG2 | IDLE_KEYPAD_ESI, keepBaselines);
+  run(IDLE_POLL_MS * 1000UL);
+}
+
+/**
+ * @brief Replay a touch at touchUs into the idle device.
+ *
+ * @keepBaselines: Restart the chip with CL=00 at the wake-up.
+ * @return Touch to note on latency (us), 0 if the note was lost.
+ */
+static unsigned long replayWake(unsigned long touchUs, bool keepBaselines) {
+  startIdle(false, keepBaselines);
+  unsigned long start = now;
+  unsigned long touchAt = start + touchUs;
+  unsigned long nextScan = start + IDLE_POLL_MS * 1000UL;
+  VoiceState v = {};
+  bool idle = true;
+  for (now = start; now < touchAt + 100000UL; now += 10) {
+    if (now == touchAt) chip.data[TEST_KEY] = TOUCHED_DATA;
+    chip.runUntil(now);
+    if (now < nextScan) continue;
+    if (idle && !(cap.readRegister16(MPR121_TOUCHSTATUS_L) & (KEY_MASK | MPR121_PROXIMITY_BIT))) {
+      nextScan += IDLE_POLL_MS * 1000UL;
+      continue;
+    }
+    uint16_t on, off;
+    stepVoices(v, cap.touched(), millis(), on, off);
+    if (on & _BV(TEST_KEY)) return now - touchAt;
+    if (idle) {
+      // serviceIdle(): awake, setKeypadSamplePeriod(KEYPAD_ESI)
+      idle = false;
+      cap.writeRegister(MPR121_CONFIG2, KEYPAD_CONFIG2 | KEYPAD_ESI, keepBaselines);
+    }
+    nextScan = now + AWAKE_LOOP_US;
+  }
+  return 0;
+}
+
+/**
+ * @brief Touches at every phase of the idle scan and chip sampling.
+ */
+static void testWakeTouch() {
+  unsigned long sum = 0, max = 0, n = 0, lost = 0, lostBefore = 0;
+  for (unsigned long t = 0; t < 2 * IDLE_POLL_MS * 1000UL; t += 250) {
+    unsigned long latency = replayWake(t, true);
+    if (!latency) lost++;
+    sum += latency;
+    if (latency > max) max = latency;
+    n++;
+    if (!replayWake(t, false)) lostBefore++;
+  }
+  printf("wake touch: note on after %lu us mean, %lu us max; %lu of %lu lost (%lu reloading baselines)\n",
+         sum / n, max, lost, n, lostBefore);
+  CHECK(lost == 0);
+  CHECK(lostBefore == n);
+  // Idle sampling, one idle poll and the attack
+  CHECK(max <= (8UL + IDLE_POLL_MS + VOICE_ATTACK_MS) * 1000UL + AWAKE_LOOP_US);
+}
+
+/**
+ * @brief A hovering hand wakes the device and stays near, its baseline untouched.
+ */
+static void testWakeProximity(bool keepBaselines) {
+  startIdle(true, keepBaselines);
+  uint16_t baseline = cap.baselineData(MPR121_PROXIMITY_CHANNEL);
+  chip.data[MPR121_PROXIMITY_CHANNEL] = HOVER_DATA;
+  run(2 * IDLE_POLL_MS * 1000UL);
+  CHECK(cap.proximity());
+  cap.writeRegister(MPR121_CONFIG2, KEYPAD_CONFIG2 | KEYPAD_ESI, keepBaselines);
+  run(10000);
+  if (keepBaselines) {
+    CHECK(cap.proximity());
+    CHECK(cap.baselineData(MPR121_PROXIMITY_CHANNEL) == baseline);
+  } else {
+    CHECK(!cap.proximity());
+  }
+}
+
+/**
+ * @brief The proximity channel reads 0 while it is disabled.
+ */
+static void testProximityOff() {
+  startIdle(true, true);
+  CHECK(cap.filteredData(MPR121_PROXIMITY_CHANNEL) == PROX_DATA);
+  CHECK(cap.baselineData(MPR121_PROXIMITY_CHANNEL) == (PROX_DATA & ~3));
+  startIdle(false, true);
+  CHECK(cap.filteredData(MPR121_PROXIMITY_CHANNEL) == 0);
+  CHECK(cap.baselineData(MPR121_PROXIMITY_CHANNEL) == 0);
+}
+
+/**
+ * @brief Chip conversions and loop scans per second, idle and awake.
+ */
+static void reportRates() {
+  startIdle(true, true);
+  unsigned long idleSamples = chip.samples;
+  run(1000000);
+  idleSamples = chip.samples - idleSamples;
+  cap.writeRegister(MPR121_CONFIG2, KEYPAD_CONFIG2 | KEYPAD_ESI, true);
+  unsigned long awakeSamples = chip.samples;
+  run(1000000);
+  awakeSamples = chip.samples - awakeSamples;
+  printf("sample periods/s: %lu idle, %lu awake; loop scans/s: %lu idle, %lu awake\n",
+         idleSamples, awakeSamples, 1000UL / IDLE_POLL_MS, 1000000UL / AWAKE_LOOP_US);
+  CHECK(awakeSamples == idleSamples << (IDLE_KEYPAD_ESI - KEYPAD_ESI));
+}
+
+int main() {
+  testWakeTouch();
+  testWakeProximity(true);
+  testWakeProximity(false);
+  testProximityOff();
+  reportRates();
+  return checkResult();
+}
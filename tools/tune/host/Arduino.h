@@ -0,0 +1,72 @@
+/* Arduino.h - Host stand-in for the Arduino core, enough to build the
+   firmware's signal processing on a PC (see tools/keycloth_tune.py and
+   tools/keycloth_test.py). Programs define the clock functions they use. */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _BV(bit) (1 << (bit))
+#define HEX 16
+#define B10000000 0x80  // binary.h, the one constant the libraries use
+
+typedef uint8_t byte;
+typedef enum { LSBFIRST = 0, MSBFIRST = 1 } BitOrder;
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+
+/**
+ * @brief Arduino's map(), returning out_min for an empty input range where
+ * the AVR division would not trap.
+ */
+static inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  if (in_max == in_min) return out_min;
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+/**
+ * @brief Byte sink of Serial and friends.
+ */
+class Print {
+public:
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+};
+
+/**
+ * @brief Print with the formatting the libraries use.
+ */
+class Stream : public Print {
+public:
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(unsigned long n, int base = 10) {
+    char digits[33], *p = digits + sizeof(digits);
+    *--p = 0;
+    do {
+      *--p = "0123456789ABCDEF"[n % base];
+      n /= base;
+    } while (n);
+    return print(p);
+  }
+  size_t println(void) { return print("\r\n"); }
+};
+
+extern Stream &Serial;  // Defined by the programs that print
+
+// Leonardo analog pins
+static const uint8_t A0 = 18;
+static const uint8_t A1 = 19;
+static const uint8_t A2 = 20;
+static const uint8_t A3 = 21;
+
+#endif
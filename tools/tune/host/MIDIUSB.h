@@ -0,0 +1,40 @@
+/* MIDIUSB.h - Host stand-in for the USB MIDI device, enough to build
+   midi.cpp on a PC. Nothing comes in, and programs define
+   MIDI_::sendMIDI() to see what goes out. */
+
+#ifndef MIDIUSB_h
+#define MIDIUSB_h
+
+#include "Arduino.h"
+
+typedef struct {
+  uint8_t header;
+  uint8_t byte1;
+  uint8_t byte2;
+  uint8_t byte3;
+} midiEventPacket_t;
+
+uint8_t MIDI_cableCount(void);
+
+/**
+ * @brief The MIDI interface, always connected and never receiving.
+ */
+class MIDI_ {
+public:
+  uint8_t readMany(midiEventPacket_t *, uint8_t) { return 0; }
+  void flush(void) {}
+  void sendMIDI(midiEventPacket_t event);
+};
+
+/**
+ * @brief The USB device, configured from the start.
+ */
+class USBDevice_ {
+public:
+  bool configured() { return true; }
+};
+
+extern MIDI_ MidiUSB;
+extern USBDevice_ USBDevice;
+
+#endif
@@ -0,0 +1,18 @@
+/* SPI.h - Host stand-in, the host builds do not touch the bus but the
+   BusIO headers name it */
+
+#ifndef _SPI_H_INCLUDED
+#define _SPI_H_INCLUDED
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPISettings;
+class SPIClass;
+extern SPIClass SPI;
+
+#endif
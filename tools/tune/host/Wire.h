@@ -0,0 +1,12 @@
+/* Wire.h - Host stand-in, the host builds do not touch the bus but the
+   BusIO headers name it */
+
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "Arduino.h"
+
+class TwoWire;
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,15 @@
+/* pgmspace.h - Host stand-in for avr/pgmspace.h: flash is ordinary memory
+   on a PC, so PROGMEM data is read directly. */
+
+#ifndef __PGMSPACE_H_
+#define __PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define memcpy_P memcpy
+
+#endif
@@ -0,0 +1,47 @@
+/* stubs.cpp - Host stand-ins for the firmware around midi.cpp: the sketch
+   variables and the modules the replay does not run (keys, layout,
+   arpeggiator, SysEx, power). Layout changes and the arpeggiator stay off,
+   noteTable is whatever the program puts there. */
+
+#include "MIDIUSB.h"
+#include "midi.h"
+#include "arp.h"
+#include "layout.h"
+#include "power.h"
+#include "sysex.h"
+
+// keycloth.ino
+int channel = Board::midiChannel;
+int layout = LAYOUT_CLOTH;
+int arpMode = ARP_OFF;
+uint8_t stretchOutput = STRETCH_OUT_NONE;
+uint8_t stretchSource = STRETCH_SRC_AMOUNT;
+uint8_t stretchCC = 11;
+uint16_t stretchRateFull = 2000;
+
+MIDI_ MidiUSB;
+USBDevice_ USBDevice;
+
+// keys.cpp
+uint16_t minCap[NUM_KEYS];
+KeyInfo::KeyInfo() : touched(0), played(0), errors(0), near(false) {}
+
+// layout.cpp
+uint8_t noteTable[NUM_KEYS];
+void applyLayout() {}
+void selectLayout(uint8_t) {}
+bool layoutPending() { return false; }
+
+// arp.cpp
+void arpLayoutChanged() {}
+void arpKeys(uint16_t, const int[]) {}
+void arpService() {}
+void arpClock() {}
+void arpStart(bool) {}
+void arpStop() {}
+
+// sysex.cpp
+void handleSysEx(const uint8_t *, uint8_t) {}
+
+// power.cpp
+void notePlayed() {}
@@ -0,0 +1,368 @@
+/* tune_host.cpp - Replay captured scans through the firmware's signal processing
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Worker of tools/keycloth_tune.py, linked with the firmware's
+ * sensors.cpp, gesture.cpp, voice.cpp, stretch.cpp and midi.cpp, and the
+ * host stand-ins of the rest (host/stubs.cpp).
+ *
+ * Usage: tune_host <data file> [dither], then one candidate per stdin line:
+ *   touch release crumpleEnter crumpleExit stretchEnter stretchExit alpha spike deadZone
+ * answered by one line:
+ *   missed false matched latency_us cc
+ *
+ * The data file (little endian, written by keycloth_tune.py) holds
+ * segments of scans with their reference events:
+ *   "KCTN" <u8 version> <u8 electrodes> <u8 sampled> <u16 segments>
+ *   per segment: <u32 scans> <u32 events>
+ *     per scan:  <u32 us> <u16 filtered[electrodes]> <u16 baseline[electrodes]> <u16 adc[sampled]>
+ *     per event: <u8 channel> <u32 on scan> <u32 off scan>
+ * Channels 0..NUM_KEYS-1 are keys, then one per gesture (GESTURE_*).
+ *
+ * With a dither, every segment is replayed a second time with that many
+ * counts of extra noise on the captured values, so thresholds right at
+ * the edge of the captured noise score worse than ones with a margin.
+ * Latency and control changes are only counted on the captured values.
+ */
+
+#include "keys.h"
+#include "sensors.h"
+#include "sampler.h"
+#include "gesture.h"
+#include "layout.h"
+#include "midi.h"
+#include "MIDIUSB.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <vector>
+
+#define TUNE_VERSION 1
+#define TUNE_EARLY_US 50000  // A detection may precede its reference onset by this much
+
+int32_t tuneSmoothAlpha = tuneDefaultAlpha;
+int32_t tuneSpikeThreshold = tuneDefaultSpike;
+int32_t tuneDeadZone = tuneDefaultDeadZone;
+
+uint16_t sampled[NUM_SAMPLED];
+
+static uint32_t nowUs;  // Time of the scan being replayed
+
+unsigned long millis() {
+  return nowUs / 1000;
+}
+
+unsigned long micros() {
+  return nowUs;
+}
+
+/**
+ * @brief No capacitive sensor channels are captured.
+ */
+uint16_t readElectrode(uint8_t) {
+  return 0;
+}
+
+/**
+ * @brief One captured scan.
+ */
+struct Scan {
+  uint32_t us;
+  uint16_t filtered[NUM_KEYS];
+  uint16_t baseline[NUM_KEYS]; /**< 10 bits */
+  uint16_t adc[NUM_SAMPLED];
+};
+
+/**
+ * @brief Reference event, scan indices.
+ */
+struct Event {
+  uint8_t channel;
+  uint32_t on;
+  uint32_t off;
+};
+
+struct Segment {
+  std::vector<Scan> scans;
+  std::vector<Event> events;
+};
+
+/**
+ * @brief Values searched by the tool.
+ */
+struct Candidate {
+  int touch, release;
+  int crumpleEnter, crumpleExit;
+  int stretchEnter, stretchExit;
+  int alpha, spike, deadZone;
+};
+
+/**
+ * @brief Score of a candidate, summed over all segments.
+ */
+struct Result {
+  uint32_t missed; /**< Reference events without a detection */
+  uint32_t falseHits; /**< Detections outside a reference event, or repeated */
+  uint32_t matched; /**< Reference events detected */
+  int64_t latencyUs; /**< Sum of detection - reference onset over matched events */
+  uint32_t cc; /**< Expression messages sent (control changes, bends, pressure) */
+};
+
+#define NUM_CHANNELS (NUM_KEYS + NUM_GESTURES)
+
+static std::vector<Segment> segments;
+static int dither = 0;
+static uint32_t noiseState;
+
+// What midi.cpp sends, while a segment replays
+static std::vector<uint32_t> detected[NUM_CHANNELS];
+static uint32_t scanIndex;
+static uint32_t expressionSent;
+
+/**
+ * @brief Collect the note ons and expression messages midi.cpp sends.
+ *
+ * The replay sets noteTable and the gesture notes to the channel numbers,
+ * so a note on names the key or gesture that played it.
+ */
+void MIDI_::sendMIDI(midiEventPacket_t e) {
+  uint8_t cable = e.header >> 4, cin = e.header & 0x0F;
+  if (cin == NOTE_ON && cable == MIDI_CABLE_KEYS && e.byte2 < NUM_KEYS) {
+    detected[e.byte2].push_back(scanIndex);
+  } else if (cin == NOTE_ON && cable == MIDI_CABLE_DRUMS && e.byte2 < NUM_GESTURES) {
+    detected[NUM_KEYS + e.byte2].push_back(scanIndex);
+  } else if (cable == MIDI_CABLE_EXPRESSION) {
+    expressionSent++;
+  }
+}
+
+/**
+ * @brief Pseudo-random offset of up to +-dither (same sequence every replay).
+ */
+static int noise() {
+  noiseState = noiseState * 1103515245 + 12345;
+  return (int)((noiseState >> 16) % (2 * dither + 1)) - dither;
+}
+
+static bool readBytes(FILE *f, void *p, size_t n) {
+  return fread(p, 1, n, f) == n;
+}
+
+static uint32_t readU32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t readU16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+/**
+ * @brief Load the data file.
+ */
+static bool load(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t head[9];
+  if (!readBytes(f, head, sizeof(head)) || memcmp(head, "KCTN", 4) || head[4] != TUNE_VERSION) {
+    fclose(f);
+    return false;
+  }
+  uint8_t electrodes = head[5], slots = head[6];
+  if (electrodes < NUM_KEYS || slots != NUM_SAMPLED) {
+    fprintf(stderr, "capture has %d electrodes and %d inputs, firmware %d and %d\n",
+            electrodes, slots, NUM_KEYS, NUM_SAMPLED);
+    fclose(f);
+    return false;
+  }
+  segments.resize(readU16(head + 7));
+  std::vector<uint8_t> row(4 + 2 * (2 * electrodes + slots));
+  for (Segment &seg : segments) {
+    uint8_t counts[8];
+    if (!readBytes(f, counts, sizeof(counts))) break;
+    seg.scans.resize(readU32(counts));
+    seg.events.resize(readU32(counts + 4));
+    for (Scan &s : seg.scans) {
+      if (!readBytes(f, row.data(), row.size())) break;
+      s.us = readU32(&row[0]);
+      for (uint8_t i = 0; i < NUM_KEYS; i++) {
+        s.filtered[i] = readU16(&row[4 + 2 * i]);
+        s.baseline[i] = readU16(&row[4 + 2 * (electrodes + i)]);
+      }
+      for (uint8_t i = 0; i < NUM_SAMPLED; i++) s.adc[i] = readU16(&row[4 + 2 * (2 * electrodes + i)]);
+    }
+    for (Event &e : seg.events) {
+      uint8_t rec[9];
+      if (!readBytes(f, rec, sizeof(rec))) break;
+      e.channel = rec[0];
+      e.on = readU32(rec + 1);
+      e.off = readU32(rec + 5);
+    }
+  }
+  bool ok = !ferror(f) && !feof(f);
+  fclose(f);
+  return ok;
+}
+
+/**
+ * @brief Match the detections of a segment to its reference events.
+ *
+ * A detection matches the first unmatched reference event of its channel
+ * it falls into (from TUNE_EARLY_US before the onset to the release);
+ * every other detection is a false trigger.
+ */
+static void score(const Segment &seg, const std::vector<uint32_t> *detected, bool noisy, Result &r) {
+  for (uint8_t ch = 0; ch < NUM_CHANNELS; ch++) {
+    std::vector<const Event *> refs;
+    for (const Event &e : seg.events) {
+      if (e.channel == ch) refs.push_back(&e);
+    }
+    size_t next = 0, matched = 0;
+    bool taken = false;  // refs[next] already matched
+    for (uint32_t d : detected[ch]) {
+      uint32_t us = seg.scans[d].us - seg.scans[0].us;
+      while (next < refs.size() && seg.scans[refs[next]->off].us - seg.scans[0].us < us) {
+        next++;
+        taken = false;
+      }
+      if (next < refs.size() && !taken &&
+          us + TUNE_EARLY_US >= seg.scans[refs[next]->on].us - seg.scans[0].us) {
+        matched++;
+        if (!noisy) r.latencyUs += (int64_t)seg.scans[d].us - seg.scans[refs[next]->on].us;
+        taken = true;
+      } else {
+        r.falseHits++;
+      }
+    }
+    if (!noisy) r.matched += matched;
+    r.missed += refs.size() - matched;
+  }
+}
+
+/**
+ * @brief Replay a segment like the firmware loop: readSensors(), then
+ * handleSignals() with the keys.
+ *
+ * Touch detection runs in the MPR121, so it is emulated here: a key
+ * touches when its baseline exceeds the filtered data by more than the
+ * touch threshold and releases below the release threshold.
+ */
+static void replay(const Segment &seg, const Candidate &c, bool noisy, Result &r) {
+  gestureConfig[GESTURE_CRUMPLE].enterR = c.crumpleEnter;
+  gestureConfig[GESTURE_CRUMPLE].exitR = c.crumpleExit;
+  gestureConfig[GESTURE_STRETCH].enterR = c.stretchEnter;
+  gestureConfig[GESTURE_STRETCH].exitR = c.stretchExit;
+  for (uint8_t g = 0; g < NUM_GESTURES; g++) gestureConfig[g].note = g;
+  for (uint8_t i = 0; i < NUM_KEYS; i++) noteTable[i] = i;
+  KeyInfo k;
+  expressionSent = 0;
+
+  if (seg.scans.empty()) return;
+  noiseState = 1;
+  memcpy(sampled, seg.scans[0].adc, sizeof(sampled));
+  setupSensors();
+  for (uint32_t n = 0; n < seg.scans.size(); n++) {
+    const Scan &s = seg.scans[n];
+    nowUs = s.us;
+    scanIndex = n;
+    for (uint8_t i = 0; i < NUM_SAMPLED; i++) {
+      int v = s.adc[i] + (noisy ? noise() : 0);
+      sampled[i] = v < 1 ? 1 : (v > 1023 ? 1023 : v);
+    }
+    readSensors();
+
+    for (uint8_t i = 0; i < NUM_KEYS; i++) {
+      int delta = (int)s.baseline[i] - s.filtered[i] + (noisy ? noise() : 0);
+      if (k.touched & _BV(i)) {
+        if (delta < c.release) k.touched &= ~_BV(i);
+      } else if (delta > c.touch) {
+        k.touched |= _BV(i);
+      }
+      k.filtered[i] = s.filtered[i];
+      k.baseline[i] = s.baseline[i];
+    }
+    handleSignals(k);
+  }
+  if (!noisy) r.cc += expressionSent;
+  score(seg, detected, noisy, r);
+}
+
+/**
+ * @brief Replay a segment in a child process, so the file statics of the
+ * firmware (voices, gestures, filters, sent notes) start fresh.
+ *
+ * @return False if the child failed.
+ */
+static bool replayFresh(const Segment &seg, const Candidate &c, bool noisy, Result &r) {
+  int fds[2];
+  if (pipe(fds) < 0) return false;
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    Result part = {};
+    replay(seg, c, noisy, part);
+    bool ok = write(fds[1], &part, sizeof(part)) == sizeof(part);
+    _exit(ok ? 0 : 1);
+  }
+  close(fds[1]);
+  Result part;
+  bool ok = pid > 0 && read(fds[0], &part, sizeof(part)) == sizeof(part);
+  close(fds[0]);
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) ok = false;
+  if (!ok) return false;
+  r.missed += part.missed;
+  r.falseHits += part.falseHits;
+  r.matched += part.matched;
+  r.latencyUs += part.latencyUs;
+  r.cc += part.cc;
+  return true;
+}
+
+/**
+ * @brief Score a candidate over all segments.
+ */
+static void evaluate(const Candidate &c) {
+  tuneSmoothAlpha = c.alpha;
+  tuneSpikeThreshold = c.spike;
+  tuneDeadZone = c.deadZone;
+  Result r = {};
+  bool ok = true;
+  for (const Segment &seg : segments) {
+    ok = ok && replayFresh(seg, c, false, r);
+    if (dither) ok = ok && replayFresh(seg, c, true, r);
+  }
+  if (ok) printf("%u %u %u %lld %u\n", r.missed, r.falseHits, r.matched, (long long)r.latencyUs, r.cc);
+  else printf("error\n");
+  fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3 || !load(argv[1])) {
+    fprintf(stderr, "usage: tune_host <data file written by keycloth_tune.py> [dither]\n");
+    return 1;
+  }
+  if (argc == 3) dither = atoi(argv[2]);
+  Candidate c;
+  while (scanf("%d %d %d %d %d %d %d %d %d", &c.touch, &c.release, &c.crumpleEnter, &c.crumpleExit,
+               &c.stretchEnter, &c.stretchExit, &c.alpha, &c.spike, &c.deadZone) == 9) {
+    evaluate(c);
+  }
+  return 0;
+}
@@ -0,0 +1,48 @@
+/* tune_host.h - Forced include of the tuning harness
+
+   Copyright (C) 2025 Alexia Pagkopoulou
+
+    This file is part of KeyCloth.
+
+    KeyCloth is free software: you can redistribute it and/or modify it
+    under the terms of the GNU General Public License as published by the
+    Free Software Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    KeyCloth is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along
+    with KeyCloth. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TUNE_HOST_H
+#define TUNE_HOST_H
+
+/**
+ * Compiled in front of every firmware file (-include), so the filter
+ * constants of tuning.h become variables a candidate sets without a
+ * rebuild. The thresholds are runtime values in the firmware already.
+ */
+#include <stdint.h>
+#include "tuning.h"
+
+extern int32_t tuneSmoothAlpha;
+extern int32_t tuneSpikeThreshold;
+extern int32_t tuneDeadZone;
+
+// The tuning.h values, taken before the macros are redirected
+static const int32_t tuneDefaultAlpha = SMOOTH_ALPHA;
+static const int32_t tuneDefaultSpike = SPIKE_THRESHOLD;
+static const int32_t tuneDefaultDeadZone = DEAD_ZONE;
+
+#undef SMOOTH_ALPHA
+#undef SPIKE_THRESHOLD
+#undef DEAD_ZONE
+#define SMOOTH_ALPHA tuneSmoothAlpha
+#define SPIKE_THRESHOLD tuneSpikeThreshold
+#define DEAD_ZONE tuneDeadZone
+
+#endif